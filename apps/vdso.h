@@ -0,0 +1,113 @@
+/// @file vdso.h
+/// @brief Userspace accessors of the read-only data page maintained by the
+/// kernel, which answer time and identity queries without system calls.
+
+#pragma once
+
+/// Where the kernel maps the page (VDSO_DATA_START in kernel.h).
+#define VDSO_DATA_ADDRESS 0xFF800000
+
+/// @brief The data page, it must match `vdso_data_t` in the kernel
+/// (include/kernel/system/vdso.h).
+typedef struct vdso_data_t {
+  /// Sequence counter of the updates, odd while the kernel writes.
+  volatile unsigned int seq;
+  /// The number of ticks since the system started.
+  unsigned int ticks;
+  /// The number of ticks per second.
+  unsigned int ticks_per_second;
+  /// Seconds since the Epoch, at the last tick.
+  unsigned int wall_base;
+  /// Low 32 bits of the TSC at the last tick.
+  unsigned int tsc_lo;
+  /// High 32 bits of the TSC at the last tick.
+  unsigned int tsc_hi;
+  /// Scale of the TSC to nanoseconds, 0 if it cannot be used.
+  unsigned int tsc_mult;
+  /// Shift of the TSC scale.
+  unsigned int tsc_shift;
+  /// PID of the running process.
+  int pid;
+  /// PID of the parent of the running process.
+  int ppid;
+} vdso_data_t;
+
+/// @brief Returns the data page.
+static inline const vdso_data_t *__vdso_data(void) {
+  return (const vdso_data_t *)VDSO_DATA_ADDRESS;
+}
+
+/// @brief Takes a consistent copy of the page, retrying if the kernel updated
+/// it in the meanwhile (e.g., the timer interrupted us).
+/// @param copy Where the page is copied.
+static inline void __vdso_read(vdso_data_t *copy) {
+  const vdso_data_t *data = __vdso_data();
+  unsigned int seq;
+  do {
+    seq = data->seq;
+    __asm__ __volatile__("" ::: "memory");
+    copy->ticks            = data->ticks;
+    copy->ticks_per_second = data->ticks_per_second;
+    copy->wall_base        = data->wall_base;
+    copy->tsc_lo           = data->tsc_lo;
+    copy->tsc_hi           = data->tsc_hi;
+    copy->tsc_mult         = data->tsc_mult;
+    copy->tsc_shift        = data->tsc_shift;
+    copy->pid              = data->pid;
+    copy->ppid             = data->ppid;
+    __asm__ __volatile__("" ::: "memory");
+  } while ((seq & 1) || (seq != data->seq));
+}
+
+/// @brief Same as getpid(), without entering the kernel.
+static inline int vdso_getpid(void) {
+  vdso_data_t copy;
+  __vdso_read(&copy);
+  return copy.pid;
+}
+
+/// @brief Same as getppid(), without entering the kernel.
+static inline int vdso_getppid(void) {
+  vdso_data_t copy;
+  __vdso_read(&copy);
+  return copy.ppid;
+}
+
+/// @brief Returns the number of ticks since the system started.
+static inline unsigned int vdso_ticks(void) {
+  vdso_data_t copy;
+  __vdso_read(&copy);
+  return copy.ticks;
+}
+
+/// @brief Same as time(), without entering the kernel.
+static inline unsigned int vdso_time(unsigned int *t) {
+  vdso_data_t copy;
+  __vdso_read(&copy);
+  if (t) {
+    *t = copy.wall_base;
+  }
+  return copy.wall_base;
+}
+
+/// @brief Returns the nanoseconds since the system started, with the
+/// resolution of the TSC if the kernel calibrated it, of the tick otherwise.
+static inline unsigned long long vdso_clock_ns(void) {
+  vdso_data_t copy;
+  unsigned int lo, hi;
+  __vdso_read(&copy);
+  unsigned int tick_ns = 1000000000U / copy.ticks_per_second;
+  unsigned long long ns = (unsigned long long)copy.ticks * tick_ns;
+  if (copy.tsc_mult) {
+    __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+    unsigned long long delta = (((unsigned long long)hi << 32) | lo) -
+                               (((unsigned long long)copy.tsc_hi << 32) |
+                                copy.tsc_lo);
+    // Keep the product inside 64 bits, the delta is below a tick anyway.
+    if (delta >> 32) {
+      delta = 0xFFFFFFFFULL;
+    }
+    ns += ((delta & 0xFFFFFFFFULL) * copy.tsc_mult) >> copy.tsc_shift;
+  }
+  return ns;
+}
@@ -201,6 +201,22 @@ static inline void pause() {
   ASM("pause");
 }
 
+/// @brief Reads a model specific register.
+/// @param msr The index of the register.
+/// @param lo  Where to store the low 32 bits of the value.
+/// @param hi  Where to store the high 32 bits of the value.
+static inline void rdmsr(uint32_t msr, uint32_t *lo, uint32_t *hi) {
+  __asm__ __volatile__("rdmsr" : "=a"(*lo), "=d"(*hi) : "c"(msr));
+}
+
+/// @brief Writes a model specific register.
+/// @param msr The index of the register.
+/// @param lo  The low 32 bits of the value.
+/// @param hi  The high 32 bits of the value.
+static inline void wrmsr(uint32_t msr, uint32_t lo, uint32_t hi) {
+  __asm__ __volatile__("wrmsr" : : "c"(msr), "a"(lo), "d"(hi));
+}
+
 // == Memory clobbers =========================================================
 // Memory clobber implies a fence, and it also impacts how the compiler treats
 // potential data aliases. A memory clobber says that the asm block modifies
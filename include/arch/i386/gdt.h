@@ -3,7 +3,12 @@
 #include <kernel/types.h>
 
 //! maximum amount of descriptors allowed
-#define MAX_DESCRIPTORS 6
+#define MAX_DESCRIPTORS 7
+
+//! index of the user mode thread-local storage descriptor
+#define GDT_TLS_INDEX 6
+//! selector of the thread-local storage descriptor (RPL 3)
+#define GDT_TLS_SELECTOR ((GDT_TLS_INDEX << 3) | 3)
 
 /***	 gdt descriptor access bit flags.	***/
 
@@ -68,4 +73,8 @@ void gdt_init();
 void gdt_set_descriptor(uint32_t i, uint64_t base, uint64_t limit,
 			uint8_t access, uint8_t grand);
 
+//! sets the base of the thread-local storage descriptor, the new base is seen
+//! once %gs is loaded again (on the way back to user mode)
+void gdt_set_tls(uint32_t base);
+
 extern void gdt_load(uint32_t);
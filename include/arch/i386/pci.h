@@ -217,6 +217,7 @@ typedef enum {
 
 #define PCI_TYPE_BRIDGE 0x060400 ///< TODO: Document.
 #define PCI_TYPE_SATA   0x010600 ///< TODO: Document.
+#define PCI_TYPE_AHCI   0x010601 ///< SATA controller, AHCI 1.0 interface.
 
 #define PCI_ADDRESS_PORT 0xCF8  ///< TODO: Document.
 #define PCI_VALUE_PORT   0xCFC  ///< TODO: Document.
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <kernel/types.h>
+
+#define MSR_IA32_SYSENTER_CS  0x174 ///< Kernel code segment of SYSENTER.
+#define MSR_IA32_SYSENTER_ESP 0x175 ///< Kernel stack of SYSENTER.
+#define MSR_IA32_SYSENTER_EIP 0x176 ///< Kernel entry point of SYSENTER.
+
+/// The CPUID (EAX=1) EDX bit which advertises SYSENTER/SYSEXIT.
+#define CPUID_EDX_SEP (1U << 11)
+
+/// Value stored in the `err_code` of the frames built by the SYSENTER entry
+/// (irq.S), so that they are left with SYSEXIT rather than with iret.
+#define SYSENTER_FRAME_MAGIC 0x5E000080
+
+/// @brief Enables the SYSENTER entry, if the CPU supports it.
+/// @details
+/// SYSEXIT derives the user selectors from the kernel code segment, in this
+/// order: kernel CS (0x08), kernel SS (0x10), user CS (0x1b), user SS (0x23),
+/// which is the layout of our GDT. System calls made with `int $0x80` keep
+/// working in any case.
+void sysenter_init(void);
+
+/// @brief Sets the kernel stack used by the SYSENTER entry.
+/// @param kesp Kernel stack address, the same given to the TSS.
+void sysenter_set_stack(uint32_t kesp);
@@ -22,18 +22,22 @@
 /// @param value the value we need to analyze.
 /// @return the position of the first zero bit.
 static inline int find_first_zero(unsigned long value) {
-  for (int i = 0; i < 32; ++i)
-    if (!bit_check(value, i))
-      return i;
-  return 0;
+  unsigned long bit;
+  if (!~value)
+    return 0;
+  // Bit Scan Forward on the complement, finds the lowest zero bit.
+  __asm__("bsf %1, %0" : "=r"(bit) : "rm"(~value));
+  return bit;
 }
 
 /// @brief Finds the first bit not zero, starting from the less significative bit.
 /// @param value the value we need to analyze.
 /// @return the position of the first non-zero bit.
 static inline int find_first_non_zero(unsigned long value) {
-  for (int i = 0; i < 32; ++i)
-    if (bit_check(value, i))
-      return i;
-  return 0;
+  unsigned long bit;
+  if (!value)
+    return 0;
+  // Bit Scan Forward, finds the lowest set bit.
+  __asm__("bsf %1, %0" : "=r"(bit) : "rm"(value));
+  return bit;
 }
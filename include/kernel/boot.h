@@ -39,6 +39,8 @@ typedef struct boot_info_t {
   uint32_t highest_address;
   uint32_t addressable_size;
 
+  /// Physical address of the first module (the initrd), 0 if not loaded.
+  uint32_t module_start;
   /// Address after the modules.
   uint32_t module_end;
 
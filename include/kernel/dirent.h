@@ -1,6 +1,7 @@
 #pragma once
 
 #include <kernel/types.h>
+#include <kernel/stat.h>
 
 /// File types for `d_type'.
 enum {
@@ -42,3 +43,9 @@ typedef struct dirent_t {
   unsigned short d_type; ///< type of the directory entry.
   char d_name[NAME_MAX]; ///< Filename (null-terminated)
 } dirent_t;
+
+/// Directory entry, together with the information about the file.
+typedef struct direntplus_t {
+  dirent_t d_ent; ///< The directory entry.
+  stat_t d_stat; ///< The information about the file.
+} direntplus_t;
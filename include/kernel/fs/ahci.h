@@ -0,0 +1,205 @@
+/// Copyright (c) 2022-2025 Minh Hai Dao (barrydevp)
+
+#pragma once
+
+#include <kernel/types.h>
+#include <kernel/fs/vfs.h>
+#include <kernel/fs/block.h>
+
+#define AHCI_MAX_PORTS    32 ///< The number of ports of an HBA.
+#define AHCI_MAX_SLOTS    32 ///< The number of command slots of a port.
+#define AHCI_PRDT_ENTRIES 248 ///< A command table with its PRDT fills a page.
+#define AHCI_MAX_SECTORS  256 ///< Maximum sectors per command.
+#define AHCI_BOUNCE_SIZE  (AHCI_MAX_SECTORS * BLOCK_SECTOR_SIZE) ///< Size of a bounce buffer.
+
+#define AHCI_SIG_ATA 0x00000101 ///< Signature of a SATA drive.
+
+#define AHCI_IDENT_LBA28       60  ///< IDENTIFY words of the 28 bit LBA sector count.
+#define AHCI_IDENT_QUEUE_DEPTH 75  ///< IDENTIFY word of the maximum queue depth, minus one.
+#define AHCI_IDENT_SATA_CAPS   76  ///< IDENTIFY word of the SATA capabilities, bit 8 is NCQ.
+#define AHCI_IDENT_LBA48       100 ///< IDENTIFY words of the 48 bit LBA sector count.
+
+/// @brief Bits of the HBA Global Host Control register.
+typedef enum {
+  ahci_ghc_hr = 0,  ///< HBA reset.
+  ahci_ghc_ie = 1,  ///< Interrupt enable.
+  ahci_ghc_ae = 31, ///< AHCI enable.
+} ahci_ghc_t;
+
+/// @brief Bits of the Port Command and Status register.
+typedef enum {
+  ahci_cmd_st  = 0,  ///< Start processing the command list.
+  ahci_cmd_sud = 1,  ///< Spin-up device.
+  ahci_cmd_pod = 2,  ///< Power on device.
+  ahci_cmd_fre = 4,  ///< FIS receive enable.
+  ahci_cmd_fr  = 14, ///< FIS receive running.
+  ahci_cmd_cr  = 15, ///< Command list running.
+} ahci_port_cmd_t;
+
+/// @brief Bits of the Port Interrupt Status and Enable registers.
+typedef enum {
+  ahci_is_dhrs = 0,  ///< Device to host register FIS received.
+  ahci_is_pss  = 1,  ///< PIO setup FIS received.
+  ahci_is_dss  = 2,  ///< DMA setup FIS received.
+  ahci_is_sdbs = 3,  ///< Set device bits FIS received (NCQ completion).
+  ahci_is_dps  = 5,  ///< A PRD with the interrupt bit has been processed.
+  ahci_is_ifs  = 27, ///< Interface fatal error.
+  ahci_is_hbds = 28, ///< Host bus data error.
+  ahci_is_hbfs = 29, ///< Host bus fatal error.
+  ahci_is_tfes = 30, ///< Task file error.
+} ahci_port_is_t;
+
+/// @brief The registers of a port, memory mapped.
+typedef volatile struct hba_port_t {
+  uint32_t clb;       ///< 0x00, command list base address, 1K aligned.
+  uint32_t clbu;      ///< 0x04, command list base address upper 32 bits.
+  uint32_t fb;        ///< 0x08, FIS base address, 256 byte aligned.
+  uint32_t fbu;       ///< 0x0C, FIS base address upper 32 bits.
+  uint32_t is;        ///< 0x10, interrupt status.
+  uint32_t ie;        ///< 0x14, interrupt enable.
+  uint32_t cmd;       ///< 0x18, command and status.
+  uint32_t rsv0;      ///< 0x1C, reserved.
+  uint32_t tfd;       ///< 0x20, task file data.
+  uint32_t sig;       ///< 0x24, signature.
+  uint32_t ssts;      ///< 0x28, SATA status (SCR0:SStatus).
+  uint32_t sctl;      ///< 0x2C, SATA control (SCR2:SControl).
+  uint32_t serr;      ///< 0x30, SATA error (SCR1:SError).
+  uint32_t sact;      ///< 0x34, SATA active (SCR3:SActive), NCQ tags.
+  uint32_t ci;        ///< 0x38, command issue.
+  uint32_t sntf;      ///< 0x3C, SATA notification (SCR4:SNotification).
+  uint32_t fbs;       ///< 0x40, FIS-based switch control.
+  uint32_t rsv1[11];  ///< 0x44 ~ 0x6F, reserved.
+  uint32_t vendor[4]; ///< 0x70 ~ 0x7F, vendor specific.
+} hba_port_t;
+
+/// @brief The registers of the Host Bus Adapter, memory mapped at ABAR.
+typedef volatile struct hba_mem_t {
+  uint32_t cap;     ///< 0x00, host capability.
+  uint32_t ghc;     ///< 0x04, global host control.
+  uint32_t is;      ///< 0x08, interrupt status, one bit per port.
+  uint32_t pi;      ///< 0x0C, ports implemented.
+  uint32_t vs;      ///< 0x10, version.
+  uint32_t ccc_ctl; ///< 0x14, command completion coalescing control.
+  uint32_t ccc_pts; ///< 0x18, command completion coalescing ports.
+  uint32_t em_loc;  ///< 0x1C, enclosure management location.
+  uint32_t em_ctl;  ///< 0x20, enclosure management control.
+  uint32_t cap2;    ///< 0x24, host capabilities extended.
+  uint32_t bohc;    ///< 0x28, BIOS/OS handoff control and status.
+  uint8_t rsv[0xA0 - 0x2C];         ///< 0x2C ~ 0x9F, reserved.
+  uint8_t vendor[0x100 - 0xA0];     ///< 0xA0 ~ 0xFF, vendor specific.
+  hba_port_t ports[AHCI_MAX_PORTS]; ///< 0x100 ~ 0x10FF, port registers.
+} hba_mem_t;
+
+/// @brief An entry of the command list, it describes a command table.
+typedef struct ahci_cmd_header_t {
+  /// Bits 0-4 are the FIS length in dwords, bit 6 is set when the device is
+  /// written, bit 10 clears the busy flag upon R_OK.
+  uint16_t flags;
+  /// Physical region descriptor table length in entries.
+  uint16_t prdtl;
+  /// Physical region descriptor byte count transferred.
+  volatile uint32_t prdbc;
+  /// Command table base address, 128 byte aligned.
+  uint32_t ctba;
+  /// Command table base address upper 32 bits.
+  uint32_t ctbau;
+  /// Reserved.
+  uint32_t rsv[4];
+} ahci_cmd_header_t;
+
+/// @brief An entry of the PRDT of a command table.
+typedef struct ahci_prdt_t {
+  /// Data base address, word aligned.
+  uint32_t dba;
+  /// Data base address upper 32 bits.
+  uint32_t dbau;
+  /// Reserved.
+  uint32_t rsv;
+  /// Bits 0-21 are the byte count minus one (4M max, must be even), bit 31
+  /// requests an interrupt once the region has been transferred.
+  uint32_t dbc;
+} ahci_prdt_t;
+
+/// @brief A command table, the FIS of the command and its PRDT.
+typedef struct ahci_cmd_table_t {
+  /// The command FIS.
+  uint8_t cfis[64];
+  /// The ATAPI command.
+  uint8_t acmd[16];
+  /// Reserved.
+  uint8_t rsv[48];
+  /// The physical region descriptor table.
+  ahci_prdt_t prdt[AHCI_PRDT_ENTRIES];
+} ahci_cmd_table_t;
+
+/// @brief Register FIS, from the host to the device.
+typedef struct fis_reg_h2d_t {
+  uint8_t fis_type; ///< FIS_TYPE_REG_H2D (0x27).
+  uint8_t flags;    ///< Bits 0-3 are the port multiplier, bit 7 is set for a command.
+  uint8_t command;  ///< Command register.
+  uint8_t featurel; ///< Feature register, 7:0.
+  uint8_t lba0;     ///< LBA register, 7:0.
+  uint8_t lba1;     ///< LBA register, 15:8.
+  uint8_t lba2;     ///< LBA register, 23:16.
+  uint8_t device;   ///< Device register.
+  uint8_t lba3;     ///< LBA register, 31:24.
+  uint8_t lba4;     ///< LBA register, 39:32.
+  uint8_t lba5;     ///< LBA register, 47:40.
+  uint8_t featureh; ///< Feature register, 15:8.
+  uint8_t countl;   ///< Count register, 7:0.
+  uint8_t counth;   ///< Count register, 15:8.
+  uint8_t icc;      ///< Isochronous command completion.
+  uint8_t control;  ///< Control register.
+  uint8_t rsv[4];   ///< Reserved.
+} fis_reg_h2d_t;
+
+/// @brief Commands sent through the AHCI ports.
+typedef enum {
+  ahci_command_identify    = 0xEC, ///< Identify Device.
+  ahci_command_read_ext    = 0x25, ///< Read DMA (48 bit LBA).
+  ahci_command_write_ext   = 0x35, ///< Write DMA (48 bit LBA).
+  ahci_command_read_fpdma  = 0x60, ///< Read FPDMA Queued (NCQ).
+  ahci_command_write_fpdma = 0x61, ///< Write FPDMA Queued (NCQ).
+} ahci_command_t;
+
+/// @brief Stores information about a drive attached to an AHCI port.
+typedef struct ahci_port_t {
+  /// Name of the device.
+  char name[NAME_MAX];
+  /// Path of the device.
+  char path[PATH_MAX];
+  /// The index of the port.
+  unsigned index;
+  /// The registers of the port.
+  hba_port_t *regs;
+  /// The command list, followed by the received FIS area in the same page.
+  ahci_cmd_header_t *cmd_list;
+  /// The command table of each slot.
+  ahci_cmd_table_t *tables[AHCI_MAX_SLOTS];
+  /// The bounce buffer of each slot, allocated the first time it is needed.
+  uint8_t *bounce[AHCI_MAX_SLOTS];
+  /// The request in flight on each slot.
+  block_request_t *slots[AHCI_MAX_SLOTS];
+  /// The number of usable slots.
+  unsigned nslots;
+  /// The slots with a command in flight.
+  volatile uint32_t issued;
+  /// The slots whose command goes through their bounce buffer.
+  uint32_t bounced;
+  /// If the drive is driven with native command queuing.
+  bool_t ncq;
+  /// The device identity data, as returned by IDENTIFY DEVICE.
+  uint16_t identity[256];
+  /// Device root file.
+  vfs_file_t *fs_root;
+  /// The block device, with the queue of requests.
+  block_device_t block;
+} ahci_port_t;
+
+/// @brief Initializes the AHCI driver.
+/// @return 0 on success, 1 on error.
+int ahci_init();
+
+/// @brief De-initializes the AHCI driver.
+/// @return 0 on success, 1 on error.
+int ahci_finalize();
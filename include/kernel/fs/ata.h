@@ -2,9 +2,17 @@
 
 #include <kernel/types.h>
 #include <kernel/fs/vfs.h>
+#include <kernel/fs/block.h>
+#include <kernel/memory/vmm.h>
+#include <kernel/process/wait.h>
+#include <kernel/spinlock.h>
 
-#define ATA_SECTOR_SIZE 512 ///< The sector size.
-#define ATA_DMA_SIZE    512 ///< The size of the DMA area.
+#define ATA_SECTOR_SIZE  512 ///< The sector size.
+#define ATA_DMA_PAGES    32  ///< The number of pages of the DMA area.
+#define ATA_DMA_SIZE     (ATA_DMA_PAGES * PAGE_SIZE) ///< The size of the DMA area.
+#define ATA_DMA_SECTORS  (ATA_DMA_SIZE / ATA_SECTOR_SIZE) ///< Maximum sectors per command.
+#define ATA_PRDT_ENTRIES (PAGE_SIZE / 8) ///< The PRDT fills a page.
+#define ATA_POLL_LIMIT   100000 ///< Status reads before a command gives up.
 ///
 /// @brief ATA Error Bits
 typedef enum {
@@ -70,6 +78,8 @@ typedef enum {
   ata_dma_command_write = 0xCA, ///< Write DMA with retries (28 bit LBA).
   ata_dma_command_write_no_retry =
     0xCB, ///< Write DMA without retries (28 bit LBA).
+  ata_dma_command_read_ext  = 0x25, ///< Read DMA (48 bit LBA).
+  ata_dma_command_write_ext = 0x35, ///< Write DMA (48 bit LBA).
 } ata_dma_command_t;
 
 /// @brief ATA identity commands.
@@ -184,6 +194,23 @@ typedef struct prdt_t {
   unsigned short end_of_table;
 } prdt_t;
 
+struct ata_device_t;
+
+/// @brief The state of an IDE channel, shared by its master and slave
+/// drives which use the same registers and Bus Master engine.
+typedef struct ata_channel_t {
+  /// Protects the channel.
+  spinlock_t lock;
+  /// The drive with a DMA transfer in flight, NULL when the channel is idle.
+  struct ata_device_t *volatile active;
+  /// The request being transferred.
+  block_request_t *request;
+  /// If the transfer goes through the DMA area of the drive.
+  bool_t bounced;
+  /// Tasks waiting for the channel to become idle.
+  wait_queue_head_t wait;
+} ata_channel_t;
+
 /// @brief Stores information about an ATA device.
 typedef struct ata_device_t {
   /// Name of the device.
@@ -261,16 +288,21 @@ typedef struct ata_device_t {
     /// aligned, contiguous in physical memory, and cannot cross a 64K boundary.
     unsigned prdt;
   } bmr;
-  /// Pointer to the first entry of the PRDT.
+  /// Pointer to the first entry of the PRDT, it has ATA_PRDT_ENTRIES entries.
   prdt_t *dma_prdt;
   /// Physical address of the first entry of the PRDT.
   uintptr_t dma_prdt_phys;
-  /// Pointer to the DMA memory area.
+  /// Pointer to the DMA memory area, it is virtually contiguous but its pages
+  /// can be scattered in physical memory.
   uint8_t *dma_start;
-  /// Physical address of the DMA memory area.
+  /// Physical address of the first page of the DMA memory area.
   uintptr_t dma_start_phys;
+  /// The channel the drive is attached to.
+  ata_channel_t *channel;
   /// Device root file.
   vfs_file_t *fs_root;
+  /// The block device, with the queue of requests.
+  block_device_t block;
 } ata_device_t;
 
 /// @brief Initializes the ATA drivers.
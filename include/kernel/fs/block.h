@@ -0,0 +1,231 @@
+/// Copyright (c) 2022-2025 Minh Hai Dao (barrydevp)
+
+#pragma once
+
+#include <kernel/types.h>
+#include <kernel/list_head.h>
+#include <kernel/spinlock.h>
+#include <kernel/fs/vfs_types.h>
+
+#define BLOCK_SECTOR_SIZE  512 ///< The size of a sector of a block device.
+#define BLOCK_QUEUED       1   ///< The driver completes the request later.
+#define BLOCK_HIST_BUCKETS 24  ///< Buckets of the latency histograms.
+/// Worst case length of the statistics of a single device.
+#define BLOCK_STATS_DEVICE_MAX (160 + 2 * (10 + BLOCK_HIST_BUCKETS * 11))
+
+struct bio_t;
+struct block_request_t;
+struct block_device_t;
+
+/// @brief Function called when a bio completes.
+typedef void (*bio_end_io_t)(struct bio_t *bio);
+
+/// @brief A block I/O: a run of contiguous sectors and the buffer holding
+/// them, the unit of work submitted to the block layer.
+typedef struct bio_t {
+  /// The first sector.
+  uint32_t sector;
+  /// The number of sectors.
+  uint32_t count;
+  /// The buffer, it is virtually contiguous.
+  char *buffer;
+  /// If the data goes to the device.
+  bool_t write;
+  /// The result of the I/O, 0 on success or a negative errno value.
+  int status;
+  /// Called once the I/O completes (optional).
+  bio_end_io_t end_io;
+  /// Data of the submitter, for the completion function.
+  void *private;
+  /// Entry inside the list of bios of the request.
+  list_head list;
+} bio_t;
+
+/// @brief A request sent to the driver, it contains one or more bios for
+/// contiguous sectors, in sector order.
+typedef struct block_request_t {
+  /// The first sector.
+  uint32_t sector;
+  /// The number of sectors.
+  uint32_t count;
+  /// If the data goes to the device.
+  bool_t write;
+  /// The list of bios.
+  list_head bios;
+  /// Entry inside the device queue.
+  list_head list;
+  /// Timer tick when the request was queued.
+  unsigned long queued;
+  /// Timer tick when the request was sent to the driver.
+  unsigned long dispatched;
+} block_request_t;
+
+/// @brief Performs a request, by transferring the sectors of all its bios.
+/// @param dev the device.
+/// @param req the request.
+/// @return 0 on success, a negative errno value otherwise, or BLOCK_QUEUED
+/// if the request is in flight and the driver will call block_end_request.
+typedef int (*block_submit_t)(struct block_device_t *dev,
+                              block_request_t *req);
+
+/// @brief I/O statistics of a block device, the arrays with two entries are
+/// indexed by the direction: 0 for reads, 1 for writes.
+typedef struct block_stats_t {
+  /// The number of completed requests.
+  unsigned long ops[2];
+  /// The number of bios merged into a queued request.
+  unsigned long merges[2];
+  /// The number of transferred sectors.
+  unsigned long sectors[2];
+  /// The number of failed requests.
+  unsigned long errors[2];
+  /// Timer ticks spent by the requests in the queue.
+  unsigned long queue_ticks[2];
+  /// Timer ticks spent by the requests inside the driver.
+  unsigned long service_ticks[2];
+  /// Histogram of the time in queue, bucket `i` counts the requests which
+  /// waited between 2^i and 2^(i+1) microseconds (bucket 0 starts from 0).
+  unsigned long queue_hist[BLOCK_HIST_BUCKETS];
+  /// Histogram of the service time, with the same buckets.
+  unsigned long service_hist[BLOCK_HIST_BUCKETS];
+} block_stats_t;
+
+/// @brief Tells the driver that a batch of requests has been submitted.
+/// @param dev the device.
+typedef void (*block_commit_t)(struct block_device_t *dev);
+
+/// @brief A block device and its queue of requests.
+typedef struct block_device_t {
+  /// Name of the device.
+  char name[NAME_MAX];
+  /// The number of sectors of the device.
+  uint32_t sector_count;
+  /// The maximum number of sectors of a request.
+  uint32_t max_sectors;
+  /// The maximum number of requests in flight, 0 is the same as 1.
+  unsigned queue_depth;
+  /// The number of requests in flight.
+  volatile unsigned inflight;
+  /// The driver function performing the requests.
+  block_submit_t submit;
+  /// Called once the queue has been run, if some requests were submitted
+  /// (optional). Drivers which only queue the requests in submit start the
+  /// device here, once per batch.
+  block_commit_t commit;
+  /// Data of the driver.
+  void *data;
+  /// The VFS file of the device.
+  vfs_file_t *file;
+  /// The queued requests, sorted by sector.
+  list_head queue;
+  /// The sector following the last request, where the elevator is.
+  uint32_t head;
+  /// While greater than zero, requests are only queued.
+  unsigned plugged;
+  /// Protects the queue.
+  spinlock_t lock;
+  /// The I/O statistics.
+  block_stats_t stats;
+  /// Entry inside the list of block devices.
+  list_head list;
+} block_device_t;
+
+/// @brief Keeps track of a group of bios submitted together.
+typedef struct block_batch_t {
+  /// The number of bios yet to complete.
+  unsigned pending;
+  /// The first error reported by the bios, or 0.
+  int status;
+} block_batch_t;
+
+/// @brief Registers a block device.
+/// @param dev the device, `name`, `sector_count`, `max_sectors`, `submit`,
+/// `data` and `file` must be already set.
+/// @return 0 on success, a negative errno value otherwise.
+int block_register(block_device_t *dev);
+
+/// @brief Finds the block device associated with a VFS file.
+/// @param file the VFS file of the device.
+/// @return the block device, or NULL.
+block_device_t *block_get_device(vfs_file_t *file);
+
+/// @brief Prints the statistics of all the block devices, as in
+/// `/proc/diskstats`.
+/// @param buffer the buffer where the text is written.
+/// @param bufsize the size of the buffer.
+/// @return the length of the text.
+size_t block_print_stats(char *buffer, size_t bufsize);
+
+/// @brief Returns the size of the buffer needed by block_print_stats to print
+/// the statistics of all the registered block devices.
+/// @return the size of the buffer, terminator included.
+size_t block_stats_size(void);
+
+/// @brief Initializes a bio.
+/// @param bio the bio.
+/// @param sector the first sector.
+/// @param count the number of sectors.
+/// @param buffer the buffer.
+/// @param write if the data goes to the device.
+void bio_init(bio_t *bio, uint32_t sector, uint32_t count, char *buffer,
+              bool_t write);
+
+/// @brief Submits a bio, its `end_io` is called once it completes.
+/// @param dev the device.
+/// @param bio the bio.
+/// @details The bio is merged with adjacent queued requests when possible,
+/// and the queue is run right away unless the device is plugged.
+void block_submit_bio(block_device_t *dev, bio_t *bio);
+
+/// @brief Holds the requests in the queue, so that they can be merged.
+/// @param dev the device.
+void block_plug(block_device_t *dev);
+
+/// @brief Releases the queue, and runs it if nobody else holds it.
+/// @param dev the device.
+void block_unplug(block_device_t *dev);
+
+/// @brief Sends the queued requests to the driver, in elevator order, until
+/// the queue is empty or the driver is full, then commits them.
+/// @param dev the device.
+void block_run_queue(block_device_t *dev);
+
+/// @brief Completes a request the driver had accepted with BLOCK_QUEUED, it
+/// can be called from an IRQ handler.
+/// @param dev the device.
+/// @param req the request, it is freed.
+/// @param status 0 on success, a negative errno value otherwise.
+void block_end_request(block_device_t *dev, block_request_t *req, int status);
+
+/// @brief Initializes a batch.
+/// @param batch the batch.
+void block_batch_init(block_batch_t *batch);
+
+/// @brief Adds a bio to the batch, it must be submitted afterwards.
+/// @param batch the batch.
+/// @param bio the bio, its `end_io` and `private` are overwritten.
+void block_batch_add(block_batch_t *batch, bio_t *bio);
+
+/// @brief Waits for all the bios of the batch.
+/// @param dev the device.
+/// @param batch the batch.
+/// @return 0 on success, the first error otherwise.
+int block_batch_wait(block_device_t *dev, block_batch_t *batch);
+
+/// @brief Reads from the device, the range does not need to be aligned.
+/// @param dev the device.
+/// @param buffer the buffer where we store the data.
+/// @param offset the offset, in bytes.
+/// @param size the size, in bytes.
+/// @return the amount we read, or a negative errno value.
+ssize_t block_read(block_device_t *dev, char *buffer, off_t offset,
+                   size_t size);
+
+/// @brief Writes to the device, the range does not need to be aligned.
+/// @param dev the device.
+/// @param buffer the data to write.
+/// @param offset the offset, in bytes.
+/// @param size the size, in bytes.
+/// @return the amount we wrote, or a negative errno value.
+ssize_t block_write(block_device_t *dev, const char *buffer, off_t offset,
+                    size_t size);
@@ -2,6 +2,7 @@
 
 #include <kernel/types.h>
 #include <kernel/fs/vfs.h>
+#include <kernel/fs/block.h>
 #include <kernel/spinlock.h>
 
 // clang-format off
@@ -285,6 +286,8 @@ typedef struct ext2_dirent_t {
 typedef struct ext2_filesystem_t {
   /// Pointer to the block device.
   vfs_file_t *block_device;
+  /// The block layer device behind `block_device`, NULL if there is none.
+  block_device_t *block;
   /// Device superblock, contains important information.
   ext2_superblock_t superblock;
   /// Block Group Descriptor / Block groups.
@@ -372,6 +375,8 @@ static int ext2_fstat(vfs_file_t *file, stat_t *stat);
 static int ext2_ioctl(vfs_file_t *file, int request, void *data);
 static int ext2_getdents(vfs_file_t *file, dirent_t *dirp, off_t doff,
                          size_t count);
+static int ext2_getdentsplus(vfs_file_t *file, direntplus_t *dirp, off_t doff,
+                             size_t count);
 
 static int ext2_mkdir(const char *path, mode_t mode);
 static int ext2_rmdir(const char *path);
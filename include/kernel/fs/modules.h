@@ -1,6 +1,7 @@
 #pragma once
 
 #include <kernel/fs/vfs.h>
+#include <kernel/boot.h>
 
 /// @brief Initialize the zero/null device.
 /// @return 0 on success, 1 on failure.
@@ -9,3 +10,9 @@ int zero_init();
 /// @brief Initialize the random device.
 /// @return 0 on success, 1 on failure.
 int random_init();
+
+/// @brief Initialize the initrd block device (`/dev/initrd`), i.e., the
+///        first module loaded by the bootloader.
+/// @param boot_info the information provided by the bootloader.
+/// @return 0 on success, 1 if there is no initrd or on failure.
+int initrd_init(boot_info_t *boot_info);
@@ -0,0 +1,55 @@
+/// Copyright (c) 2022-2025 Minh Hai Dao (barrydevp)
+
+#pragma once
+
+#include <kernel/types.h>
+#include <kernel/kernel.h>
+#include <kernel/fs/vfs_types.h>
+#include <kernel/fs/block.h>
+
+#define RAMDISK_MAX_DEVICES 8   ///< Maximum number of RAM disks.
+#define RAMDISK_MAX_SECTORS 256 ///< Maximum sectors per request.
+
+#ifndef RAMDISK_COUNT
+#define RAMDISK_COUNT 1 ///< Number of RAM disks created at boot.
+#endif
+
+#ifndef RAMDISK_SIZE
+#define RAMDISK_SIZE (4 * MB) ///< Size of the RAM disks created at boot.
+#endif
+
+/// @brief Requests understood by the RAM disks `ioctl`.
+typedef enum {
+  /// Creates a new RAM disk, `data` points to its size in bytes (size_t),
+  /// returns the index N of the new /dev/ramN.
+  ramdisk_ioctl_create = 0x5201,
+  /// Stores the size in bytes of the RAM disk in `data` (size_t).
+  ramdisk_ioctl_get_size = 0x5202,
+} ramdisk_ioctl_t;
+
+/// @brief A block device backed by kernel memory.
+typedef struct ramdisk_device_t {
+  /// Name of the device.
+  char name[NAME_MAX];
+  /// Path of the device.
+  char path[PATH_MAX];
+  /// The memory holding the data.
+  char *start;
+  /// The size of the device.
+  size_t size;
+  /// Device root file.
+  vfs_file_t *fs_root;
+  /// The block device, with the queue of requests.
+  block_device_t block;
+} ramdisk_device_t;
+
+/// @brief Creates a RAM disk, mounted as /dev/ramN.
+/// @param size the size in bytes, rounded up to a whole sector.
+/// @return the index N of the device, or a negative errno value.
+int ramdisk_create(size_t size);
+
+/// @brief Creates the RAM disks requested at boot.
+/// @param count the number of devices.
+/// @param size the size of each device, in bytes.
+/// @return 0 on success, 1 on failure.
+int ramdisk_init(unsigned count, size_t size);
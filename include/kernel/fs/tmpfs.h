@@ -0,0 +1,18 @@
+/// Copyright (c) 2022-2025 Minh Hai Dao (barrydevp)
+
+#pragma once
+
+#include <kernel/fs/vfs_types.h>
+
+/// @brief Initialize the tmpfs filesystem.
+/// @return 0 on success, 1 on failure.
+/// @details Once registered, a tmpfs can be mounted with
+///   `do_mount(TMPFS, path, args)`, where `args` is either NULL or a string
+///   in the form `size=<n>[k|m]` which limits the amount of file data the
+///   filesystem can hold. Without it, the limit is half of the physical
+///   memory.
+int tmpfs_init();
+
+/// @brief Clean up the tmpfs filesystem.
+/// @return 0 on success, 1 on failure.
+int tmpfs_cleanup();
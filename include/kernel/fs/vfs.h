@@ -81,6 +81,18 @@ off_t vfs_lseek(vfs_file_t *file, off_t offset, int whence);
 ///         appropriately.
 int vfs_getdents(vfs_file_t *file, dirent_t *dirp, off_t off, size_t count);
 
+/// Provide access to the directory entries, together with the information
+/// concerning each of them (as returned by stat).
+/// @param file  The directory for which we accessing the entries.
+/// @param dirp  The buffer where de data should be placed.
+/// @param off   The offset from which we start reading the entries.
+/// @param count The size of the buffer.
+/// @return On success, the number of bytes read is returned.  On end of
+///         directory, 0 is returned.  On error, -1 is returned, and errno is set
+///         appropriately.
+int vfs_getdentsplus(vfs_file_t *file, direntplus_t *dirp, off_t off,
+                     size_t count);
+
 /// @brief Perform the I/O control operation specified by REQUEST on FD.
 ///   One argument may follow; its presence and type depend on REQUEST.
 /// @param file     The file for which we are executing the operations.
@@ -165,6 +177,12 @@ int vfs_init_task(struct task_struct *task);
 /// @return 0 on fail, 1 on success.
 int vfs_dup_task(struct task_struct *new_task, struct task_struct *old_task);
 
+/// @brief Makes new_task use the same file descriptor list of old_task.
+/// @param new_task The task which shares the file descriptor list.
+/// @param old_task The task which owns the file descriptor list.
+/// @return 0 on fail, 1 on success.
+int vfs_share_task(struct task_struct *new_task, struct task_struct *old_task);
+
 /// @brief Destroy the file descriptor list for the given task.
 /// @param task The task for which we destroy the file descriptor list.
 /// @return 0 on fail, 1 on success.
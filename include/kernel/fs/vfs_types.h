@@ -8,6 +8,7 @@
 /// Supported FS types
 #define EXT2 "ext2"
 #define PROCFS "procfs" 
+#define TMPFS "tmpfs"
 
 #define PATH_SEPARATOR '/' ///< The character used as path separator.
 #define PATH_SEPARATOR_STRING "/" ///< The string used as path separator.
@@ -25,6 +26,9 @@ typedef int (*vfs_rmdir_callback)(const char *);
 typedef vfs_file_t *(*vfs_creat_callback)(const char *, mode_t);
 /// Function used to read the entries of a directory.
 typedef int (*vfs_getdents_callback)(vfs_file_t *, dirent_t *, off_t, size_t);
+/// Function used to read the entries of a directory, with their information.
+typedef int (*vfs_getdentsplus_callback)(vfs_file_t *, direntplus_t *, off_t,
+                                         size_t);
 /// Function used to open a file (or directory).
 typedef vfs_file_t *(*vfs_open_callback)(const char *, int, mode_t);
 /// Function used to remove a file.
@@ -87,6 +91,8 @@ typedef struct vfs_file_operations_t {
   vfs_ioctl_callback ioctl_f;
   /// Read entries inside the directory.
   vfs_getdents_callback getdents_f;
+  /// Read entries inside the directory, together with their information.
+  vfs_getdentsplus_callback getdentsplus_f;
 } vfs_file_operations_t;
 
 /// @brief Data structure that contains information about the mounted filesystems.
@@ -125,6 +131,15 @@ struct vfs_file_t {
   vfs_file_operations_t *fs_operations;
   /// Offset for read operations.
   size_t f_pos;
+  /// Position reached by the last directory read, used to resume getdents.
+  struct {
+    /// Number of entries provided before the saved position.
+    uint32_t entry;
+    /// The index of the block inside the directory.
+    uint32_t block_index;
+    /// The offset of the next entry inside the block.
+    uint32_t block_offset;
+  } dir_pos;
   /// The number of links.
   uint32_t nlink;
   /// List to hold all active files associated with a specific entry in a filesystem.
@@ -154,3 +169,14 @@ typedef struct vfs_file_descriptor_t {
   /// Flags for file opening modes.
   int flags_mask;
 } vfs_file_descriptor_t;
+
+/// @brief The table of the open file descriptors, shared by the tasks created
+/// with CLONE_FILES.
+typedef struct files_struct_t {
+  /// Number of tasks using the table.
+  int count;
+  /// The current opened file descriptors.
+  vfs_file_descriptor_t *fd_list;
+  /// The maximum supported number of file descriptors.
+  int max_fd;
+} files_struct_t;
@@ -0,0 +1,175 @@
+/// Copyright (c) 2022-2025 Minh Hai Dao (barrydevp)
+
+#pragma once
+
+#include <kernel/types.h>
+#include <kernel/fs/vfs.h>
+#include <kernel/fs/block.h>
+
+#define VIRTIO_VENDOR_ID        0x1AF4 ///< PCI vendor of the virtio devices.
+#define VIRTIO_BLK_DEVICE_ID    0x1001 ///< PCI device of the transitional virtio-blk.
+#define VIRTIO_BLK_MAX_DEVICES  4      ///< The number of devices we drive.
+#define VIRTIO_BLK_QUEUE_DEPTH  8      ///< Maximum requests in flight.
+#define VIRTIO_BLK_MAX_SECTORS  256    ///< Maximum sectors per request.
+#define VIRTIO_BLK_BOUNCE_SIZE  (VIRTIO_BLK_MAX_SECTORS * BLOCK_SECTOR_SIZE) ///< Size of a bounce buffer.
+
+/// @brief Registers of the legacy virtio PCI interface, in the I/O space
+/// pointed by BAR0.
+typedef enum {
+  virtio_reg_device_features = 0x00, ///< [R  ] Features of the device (32-bit).
+  virtio_reg_guest_features  = 0x04, ///< [R/W] Features we accept (32-bit).
+  virtio_reg_queue_address   = 0x08, ///< [R/W] Page frame of the selected queue (32-bit).
+  virtio_reg_queue_size      = 0x0C, ///< [R  ] Size of the selected queue (16-bit).
+  virtio_reg_queue_select    = 0x0E, ///< [R/W] Selects a queue (16-bit).
+  virtio_reg_queue_notify    = 0x10, ///< [  W] Notifies a queue (16-bit).
+  virtio_reg_device_status   = 0x12, ///< [R/W] Device status (8-bit).
+  virtio_reg_isr_status      = 0x13, ///< [R  ] ISR status, cleared on read (8-bit).
+  virtio_reg_config          = 0x14, ///< [R/W] Device specific configuration.
+} virtio_reg_t;
+
+/// @brief Bits of the device status.
+typedef enum {
+  virtio_status_acknowledge = 0x01, ///< We found the device.
+  virtio_status_driver      = 0x02, ///< We know how to drive it.
+  virtio_status_driver_ok   = 0x04, ///< The driver is ready.
+  virtio_status_failed      = 0x80, ///< We gave up on the device.
+} virtio_status_t;
+
+/// @brief Features of a virtio-blk device.
+typedef enum {
+  virtio_blk_f_seg_max  = 2, ///< Maximum segments of a request in `seg_max`.
+  virtio_blk_f_ro       = 5, ///< The device is read-only.
+} virtio_blk_feature_t;
+
+/// @brief Configuration of a virtio-blk device, at virtio_reg_config.
+typedef enum {
+  virtio_blk_config_capacity = 0x00, ///< Capacity in sectors (64-bit).
+  virtio_blk_config_seg_max  = 0x0C, ///< Maximum segments per request (32-bit).
+} virtio_blk_config_t;
+
+/// @brief Types of virtio-blk requests.
+typedef enum {
+  virtio_blk_t_in  = 0, ///< Read from the device.
+  virtio_blk_t_out = 1, ///< Write to the device.
+} virtio_blk_type_t;
+
+#define VRING_DESC_F_NEXT     1 ///< The descriptor continues in `next`.
+#define VRING_DESC_F_WRITE    2 ///< The device writes the buffer.
+#define VRING_USED_F_NO_NOTIFY 1 ///< The device does not need to be notified.
+
+/// @brief A descriptor of the virtqueue, it points to a buffer.
+typedef struct vring_desc_t {
+  /// Physical address of the buffer, low 32 bits.
+  uint32_t addr;
+  /// Physical address of the buffer, high 32 bits.
+  uint32_t addr_hi;
+  /// Length of the buffer.
+  uint32_t len;
+  /// VRING_DESC_F_* flags.
+  uint16_t flags;
+  /// The following descriptor, if VRING_DESC_F_NEXT is set.
+  uint16_t next;
+} vring_desc_t;
+
+/// @brief The ring where we make descriptor chains available to the device.
+typedef struct vring_avail_t {
+  /// Flags, unused.
+  uint16_t flags;
+  /// Where we put the next entry, it only grows.
+  uint16_t idx;
+  /// The head of each chain, `size` entries.
+  uint16_t ring[];
+} vring_avail_t;
+
+/// @brief An entry of the used ring.
+typedef struct vring_used_elem_t {
+  /// The head of the chain.
+  uint32_t id;
+  /// The number of bytes written by the device.
+  uint32_t len;
+} vring_used_elem_t;
+
+/// @brief The ring where the device returns the chains it consumed.
+typedef struct vring_used_t {
+  /// VRING_USED_F_* flags.
+  uint16_t flags;
+  /// Where the device puts the next entry, it only grows.
+  uint16_t idx;
+  /// The completed chains, `size` entries.
+  vring_used_elem_t ring[];
+} vring_used_t;
+
+/// @brief Header of a virtio-blk request, read by the device.
+typedef struct virtio_blk_outhdr_t {
+  /// The type of the request.
+  uint32_t type;
+  /// Reserved.
+  uint32_t ioprio;
+  /// The first sector, low 32 bits.
+  uint32_t sector;
+  /// The first sector, high 32 bits.
+  uint32_t sector_hi;
+} virtio_blk_outhdr_t;
+
+/// @brief Memory of a slot seen by the device: the request header, and the
+/// status written back by the device.
+typedef struct virtio_blk_slot_t {
+  /// The header.
+  virtio_blk_outhdr_t hdr;
+  /// The status, 0 on success.
+  volatile uint8_t status;
+} virtio_blk_slot_t;
+
+/// @brief Stores information about a virtio-blk device.
+typedef struct virtio_blk_device_t {
+  /// Name of the device.
+  char name[NAME_MAX];
+  /// Path of the device.
+  char path[PATH_MAX];
+  /// The PCI device.
+  uint32_t pci;
+  /// The base of the I/O registers.
+  unsigned io_base;
+  /// The IRQ line.
+  int irq;
+  /// The number of descriptors of the virtqueue.
+  unsigned size;
+  /// The descriptor table.
+  vring_desc_t *desc;
+  /// The available ring.
+  vring_avail_t *avail;
+  /// The used ring.
+  vring_used_t *used;
+  /// The next entry of the used ring we look at.
+  uint16_t last_used;
+  /// The number of requests in flight at once.
+  unsigned nslots;
+  /// The number of descriptors owned by each slot, they are contiguous.
+  unsigned slot_descs;
+  /// The headers and statuses of the slots.
+  virtio_blk_slot_t *slots;
+  /// Physical address of the slots.
+  uintptr_t slots_phys;
+  /// The request in flight on each slot.
+  block_request_t *requests[VIRTIO_BLK_QUEUE_DEPTH];
+  /// The bounce buffer of each slot, allocated the first time it is needed.
+  uint8_t *bounce[VIRTIO_BLK_QUEUE_DEPTH];
+  /// The slots with a request in flight.
+  uint32_t issued;
+  /// The slots whose request goes through their bounce buffer.
+  uint32_t bounced;
+  /// If the device is read-only.
+  bool_t read_only;
+  /// Device root file.
+  vfs_file_t *fs_root;
+  /// The block device, with the queue of requests.
+  block_device_t block;
+} virtio_blk_device_t;
+
+/// @brief Initializes the virtio-blk driver.
+/// @return 0 on success, 1 on error.
+int virtio_blk_init();
+
+/// @brief De-initializes the virtio-blk driver.
+/// @return 0 on success, 1 on error.
+int virtio_blk_finalize();
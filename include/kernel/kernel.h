@@ -36,6 +36,20 @@ extern void *_kernel_end;
 #define USER_START        0x0
 #define USER_END          KERNEL_HIGHER_HALF
 #define FRAMEBUFFER_START KERNEL_HEAP_END
+// The initial ramdisk loaded by the bootloader is mapped here, it cannot be
+// larger than the window.
+#define INITRD_START 0xF4000000
+#define INITRD_END   0xFF000000 // 176MB
+// Memory mapped device registers are mapped here.
+#define MMIO_START INITRD_END
+#define MMIO_END   0xFF7F0000 // 8MB - 64KB
+// Frames which are not permanently mapped (e.g. the pages of tmpfs) are
+// mapped here, one page per slot, while the kernel accesses them.
+#define KMAP_START MMIO_END
+#define KMAP_END   0xFF800000 // 64KB
+// The data page shared with userspace (see vdso.h) is mapped here, alone in
+// its page table, the only one of the kernel half which userspace can read.
+#define VDSO_DATA_START KMAP_END
 // Page table mapping virtual space is used for temporarily map
 // page table. That is useful when we need to access two page directory
 // at a time. e.g. copy two pdir (accessing one by recursive map and one
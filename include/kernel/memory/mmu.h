@@ -42,6 +42,11 @@ mm_struct_t *mmu_clone_process_image(mm_struct_t *mm);
 ///
 void mmu_destroy_process_image(mm_struct_t *mm);
 
+/// @brief Releases the memory of a task, which is destroyed when no other
+/// task (created with CLONE_VM) uses it.
+/// @param mm The memory of the task.
+void mmu_put_process_image(mm_struct_t *mm);
+
 ///
 void *sbrk(size_t bytes);
 
@@ -33,6 +33,7 @@
 // since some first bits of them have the same meaning
 #define PML_KERNEL_ACCESS 0x03
 #define PML_USER_ACCESS 0x07
+#define PML_USER_READONLY 0x05
 #define LARGE_PAGE_BIT 0x08
 #define PML_DIR_VADDR 0xFFFF0000
 #define PML_COW_BIT 0x200
@@ -154,6 +155,8 @@ typedef struct mm_struct_t {
   page_directory_t *pgd;
   /// Number of memory area.
   int map_count;
+  /// Number of tasks using the memory (the threads created with CLONE_VM).
+  int mm_users;
   /// List of mm_struct.
   list_head mm_list;
   /// CODE start.
@@ -196,6 +199,10 @@ uintptr_t vmm_r_get_phy_addr(uintptr_t virtAddr);
 void vmm_map_range(uintptr_t virtAddr, uintptr_t physAddr, uint32_t size,
                   uint32_t flags);
 void vmm_unmap_range(uintptr_t virtAddr, uint32_t size);
+void *vmm_map_mmio(uintptr_t physAddr, uint32_t size);
+void *vmm_alloc_dma(uint32_t size, uintptr_t *physAddr);
+void *vmm_kmap(uintptr_t physAddr);
+void vmm_kunmap(void *virtAddr);
 void vmm_allocate_range(uintptr_t virtAddr, uint32_t size, uint32_t flags);
 void vmm_deallocate_range(uintptr_t virtAddr, uint32_t size);
 
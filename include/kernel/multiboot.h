@@ -12,6 +12,7 @@ struct multiboot_info {
   struct multiboot_tag_basic_meminfo *multiboot_meminfo;
   struct multiboot_tag_mmap *multiboot_mmap;
   struct multiboot_tag_framebuffer *multiboot_framebuffer;
+  struct multiboot_tag_module *multiboot_module;
 };
 
 extern struct multiboot_info mboot;
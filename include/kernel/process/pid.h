@@ -0,0 +1,58 @@
+/// @file pid.h
+/// @brief Process identifiers allocation, and lookup of the tasks by pid,
+/// process group and session.
+/// @copyright (c) 2014-2022 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include <kernel/types.h>
+#include <kernel/list_head.h>
+
+/// The number of process identifiers, pids go from 1 to PID_MAX - 1.
+#define PID_MAX 32768
+
+/// The number of buckets of each hash table.
+#define PIDHASH_SIZE 256
+
+/// @brief The identifiers through which a task can be found.
+typedef enum pid_type_t {
+  PIDTYPE_PID,  ///< The process identifier.
+  PIDTYPE_PGID, ///< The process group identifier.
+  PIDTYPE_SID,  ///< The session identifier.
+  PIDTYPE_MAX   ///< The number of identifiers.
+} pid_type_t;
+
+struct task_struct;
+
+/// @brief Initializes the pid allocator and the hash tables.
+void pid_init(void);
+
+/// @brief Allocates an unused process identifier.
+/// @return the pid, or -EAGAIN if they are all in use.
+pid_t pid_alloc(void);
+
+/// @brief Releases a process identifier, so that it can be given again.
+/// @param pid the pid.
+void pid_free(pid_t pid);
+
+/// @brief Makes the task reachable through its pid, process group and session.
+/// @param task the task.
+void pid_hash_add(struct task_struct *task);
+
+/// @brief Removes the task from the hash tables.
+/// @param task the task.
+void pid_hash_del(struct task_struct *task);
+
+/// @brief Changes the process group or the session of a task.
+/// @param task the task.
+/// @param type PIDTYPE_PGID or PIDTYPE_SID.
+/// @param nr the new identifier.
+void pid_hash_change(struct task_struct *task, pid_type_t type, pid_t nr);
+
+/// @brief Finds a task by one of its identifiers.
+/// @param type the kind of identifier.
+/// @param nr the identifier.
+/// @return the task with the given pid, or a member of the given process
+/// group or session; NULL if there is none.
+struct task_struct *pid_find_task(pid_type_t type, pid_t nr);
@@ -1,3 +1,5 @@
+#pragma once
+
 // Priority of a process goes from 0..MAX_PRIO-1, valid RT
 // priority is 0..MAX_RT_PRIO-1, and SCHED_NORMAL/SCHED_BATCH
 // tasks are in the range MAX_RT_PRIO..MAX_PRIO-1. Priority
@@ -8,6 +8,51 @@
 #include <kernel/types.h>
 #include <kernel/list_head.h>
 #include <kernel/process/task.h>
+#include <kernel/process/prio.h>
+#include <kernel/rbtree.h>
+
+/// @defgroup SchedPolicies Scheduling policies
+/// @brief The policy of a task selects its scheduling class.
+/// @{
+#define SCHED_NORMAL   0 ///< Time-sharing, with the fair scheduler.
+#define SCHED_FIFO     1 ///< Real-time, first-come first-served within a priority.
+#define SCHED_RR       2 ///< Real-time, round-robin within a priority.
+#define SCHED_BATCH    3 ///< Like SCHED_NORMAL, for non-interactive tasks.
+#define SCHED_IDLE     5 ///< Runs only when nothing else is runnable.
+#define SCHED_DEADLINE 6 ///< Earliest deadline first, periodic or not.
+/// @}
+
+/// The number of words of the bitmap of a priority array.
+#define PRIO_BITMAP_SIZE ((MAX_RT_PRIO + 31) / 32)
+
+/// @brief The runnable real-time tasks, with a FIFO list for each priority,
+/// and a bitmap telling which lists are not empty.
+typedef struct prio_array_t {
+  /// Number of tasks inside the array.
+  size_t nr_active;
+  /// Bit `prio` is set when `queue[prio]` is not empty.
+  unsigned long bitmap[PRIO_BITMAP_SIZE];
+  /// The lists of tasks, one for each real-time priority.
+  list_head queue[MAX_RT_PRIO];
+} prio_array_t;
+
+/// @brief The runnable tasks of the fair scheduler, ordered by vruntime.
+typedef struct cfs_rq_t {
+  /// Number of tasks inside the tree.
+  size_t nr_running;
+  /// The smallest vruntime among the runnable tasks, it never decreases.
+  time_t min_vruntime;
+  /// The tree of tasks, the leftmost has the smallest vruntime.
+  rb_root_cached tasks_timeline;
+} cfs_rq_t;
+
+/// @brief The runnable deadline tasks, ordered by absolute deadline.
+typedef struct dl_rq_t {
+  /// Number of tasks inside the tree.
+  size_t nr_running;
+  /// The tree of tasks, the leftmost is the most urgent.
+  rb_root_cached root;
+} dl_rq_t;
 
 /// @brief Structure that contains information about live processes.
 typedef struct runqueue_t {
@@ -17,14 +62,47 @@ typedef struct runqueue_t {
   size_t num_periodic;
   /// Queue of processes.
   list_head queue;
+  /// The runnable processes of the deadline class.
+  dl_rq_t dl;
+  /// The runnable processes of the real-time class (SCHED_FIFO, SCHED_RR).
+  prio_array_t rt;
+  /// The runnable processes of the fair class (SCHED_NORMAL, SCHED_BATCH).
+  cfs_rq_t cfs;
+  /// The runnable processes of the idle class, in round-robin.
+  list_head idle;
   /// The current running process.
   task_struct *curr;
+  /// The task of the idle class which runs when nothing else is runnable.
+  task_struct *idle_task;
+  /// Set when the scheduler has to run on the way back to user mode.
+  bool_t need_resched;
 } runqueue_t;
 
+/// @brief A scheduling class, it keeps the runnable tasks of some policies.
+/// @details Classes are stacked by priority: a class is asked for a task only
+/// when the classes above it have none. Each class keeps its own runnable
+/// tasks, and a task belongs to a single class at a time.
+typedef struct sched_class_t {
+  /// Name of the class.
+  const char *name;
+  /// The class with the next lower priority, NULL for the last one.
+  const struct sched_class_t *next;
+  /// Adds the task to the runnable ones, if it is not already there.
+  void (*enqueue_task)(runqueue_t *runqueue, task_struct *process);
+  /// Removes the task, returns 1 if it was among the runnable ones.
+  int (*dequeue_task)(runqueue_t *runqueue, task_struct *process);
+  /// Returns the next task of the class, NULL if the class has none.
+  task_struct *(*pick_next_task)(runqueue_t *runqueue);
+  /// Charges the current task for the time it has just run.
+  void (*task_tick)(runqueue_t *runqueue, task_struct *process);
+} sched_class_t;
+
 /// @brief Structure that describes scheduling parameters.
 typedef struct sched_param_t {
   /// Static execution priority.
   int sched_priority;
+  /// Scheduling policy (SCHED_NORMAL, SCHED_FIFO, ...).
+  int sched_policy;
   /// Expected period of the task
   time_t period;
   /// Absolute deadline
@@ -38,14 +116,19 @@ typedef struct sched_param_t {
 /// @brief Initialize the scheduler.
 void scheduler_init();
 
-/// @brief  Returns a non-decreasing unique process id.
-/// @return Process identifier (PID).
-uint32_t scheduler_getpid();
-
 /// @brief Returns the pointer to the current active process.
 /// @return Pointer to the current process.
 task_struct *scheduler_get_current_process();
 
+/// @brief Makes the given kernel task the idle task, it joins the idle class
+/// and it is picked when no other task is runnable.
+/// @param process The idle task.
+void scheduler_init_idle(task_struct *process);
+
+/// @brief Returns the pointer to the idle task.
+/// @return Pointer to the idle task, NULL if it has not been created yet.
+task_struct *scheduler_get_idle_process();
+
 /// @brief Returns the maximum vruntime of all the processes in running state.
 /// @return A maximum vruntime value.
 time_t scheduler_get_maximum_vruntime();
@@ -67,6 +150,34 @@ void scheduler_enqueue_task(task_struct *process);
 /// @param process Process that has to be activated.
 void scheduler_dequeue_task(task_struct *process);
 
+/// @brief Adds the given process to the runnable ones, if it is not already
+/// there.
+/// @param process Process that can now run.
+void scheduler_enqueue_runnable(task_struct *process);
+
+/// @brief Removes the given process from the runnable ones.
+/// @param process Process that cannot run anymore.
+/// @return 1 if the process was among the runnable ones, 0 otherwise.
+int scheduler_dequeue_runnable(task_struct *process);
+
+/// @brief Asks the scheduler to run on the way back to user mode, because the
+/// current process may not be the one which should run anymore.
+void scheduler_set_need_resched();
+
+/// @brief Tells if the scheduler has to run on the way back to user mode.
+/// @return 1 if it has to run, 0 otherwise.
+int scheduler_need_resched();
+
+/// @brief Puts the process to sleep, it leaves the runnable processes until it
+/// is woken up.
+/// @param process The process.
+/// @param state   The new state (TASK_UNINTERRUPTIBLE, TASK_STOPPED, ...).
+void scheduler_block_task(task_struct *process, long state);
+
+/// @brief Sets the scheduling class of the process, from its policy.
+/// @param process The process, which must not be among the runnable ones.
+void scheduler_set_sched_class(task_struct *process);
+
 /// @brief The RR implementation of the scheduler.
 /// @param f The context of the process.
 void scheduler_run(pt_regs *f);
@@ -93,14 +204,14 @@ task_struct *scheduler_pick_next_task(runqueue_t *runqueue);
 
 /// @brief Set new scheduling settings for the given process.
 /// @param pid   ID of the process we are manipulating.
-/// @param param New parameters.
-/// @return 1 on success, -1 on error.
+/// @param param New parameters, the policy selects the scheduling class.
+/// @return 1 on success, a negative errno value on error.
 int sys_sched_setparam(pid_t pid, const sched_param_t *param);
 
 /// @brief Gets the scheduling settings for the given process.
 /// @param pid   ID of the process we are manipulating.
 /// @param param Where we store the parameters.
-/// @return 1 on success, -1 on error.
+/// @return 1 on success, -ESRCH if there is no such process.
 int sys_sched_getparam(pid_t pid, sched_param_t *param);
 
 /// @brief Puts the process on wait until its next period starts.
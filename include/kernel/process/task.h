@@ -11,6 +11,9 @@
 #include <kernel/termios.h>
 #include <kernel/system/signal.h>
 #include <kernel/memory/vmm.h>
+#include <kernel/rbtree.h>
+#include <kernel/process/pid.h>
+#include <kernel/process/wait.h>
 
 /// The maximum length of a name for a task_struct.
 #define TASK_NAME_MAX_LENGTH 100
@@ -18,6 +21,12 @@
 /// The default dimension of the stack of a process (1 MByte).
 #define DEFAULT_STACK_SIZE 0x100000
 
+#define CSIGNAL       0x000000ff ///< Signal mask to be sent at exit.
+#define CLONE_VM      0x00000100 ///< The child shares the memory of the parent.
+#define CLONE_FILES   0x00000400 ///< The child shares the file descriptor table.
+#define CLONE_SIGHAND 0x00000800 ///< The child shares the signal handlers.
+#define CLONE_SETTLS  0x00080000 ///< The child gets its own thread-local storage.
+
 /// @brief This structure is used to track the statistics of a process.
 /// @details
 /// While the other variables also play a role in
@@ -32,6 +41,10 @@
 typedef struct sched_entity_t {
   /// Static execution priority.
   int prio;
+  /// Scheduling policy, which selects the scheduling class.
+  int policy;
+  /// Ticks left before a SCHED_RR task yields to the ones with its priority.
+  time_t time_slice;
 
   /// Start execution time.
   time_t start_runtime;
@@ -43,6 +56,8 @@ typedef struct sched_entity_t {
   time_t sum_exec_runtime;
   /// Weighted execution time.
   time_t vruntime;
+  /// Node inside the tree of the fair scheduler.
+  rb_node run_node;
 
   /// Expected period of the task
   time_t period;
@@ -58,6 +73,10 @@ typedef struct sched_entity_t {
   bool_t is_under_analysis;
   /// Beginning of next period
   time_t next_period;
+  /// Node inside the tree of the real-time scheduler.
+  rb_node dl_node;
+  /// The timer which releases the task at its next period.
+  struct timer_list *period_timer;
   /// Worst case execution time
   time_t worst_case_exec;
   /// Processor utilization factor
@@ -74,6 +93,8 @@ typedef struct thread_struct_t {
   bool_t fpu_enabled;
   /// Data structure used to save FPU registers.
   savefpu fpu_register;
+  /// Base of the thread-local storage segment, selected by %gs.
+  uint32_t tls;
 } thread_struct_t;
 
 /// @brief this is our task object. Every process in the system has this, and
@@ -93,22 +114,34 @@ typedef struct task_struct {
   // -1 unrunnable, 0 runnable, >0 stopped.
   /// The current state of the process:
   __volatile__ long state;
-  /// The current opened file descriptors
-  vfs_file_descriptor_t *fd_list;
-  /// The maximum supported number of file descriptors
-  int max_fd;
+  /// The table of the opened file descriptors.
+  files_struct_t *files;
   /// Pointer to process's parent.
   struct task_struct *parent;
   /// List head for scheduling purposes.
   list_head run_list;
+  /// Entries inside the hash tables of pids, process groups and sessions.
+  list_head pid_links[PIDTYPE_MAX];
+  /// Entry inside the wait queue where the task sleeps, see `sleep_on`.
+  wait_queue_entry_t wait;
+  /// Entry inside the runnable processes of the real-time or idle class.
+  list_head prio_list;
   /// List of children traced by the process.
   list_head children;
   /// List of siblings, namely processes created by parent process.
   list_head sibling;
+  /// Children which exited, and wait to be reaped by `waitpid`.
+  list_head zombies;
+  /// Entry inside the list of zombies of the parent.
+  list_head zombie_node;
+  /// Where the process waits for its children to exit.
+  wait_queue_head_t wait_chldexit;
   /// The context of the processors.
   thread_struct_t thread;
   /// For scheduling algorithms.
   sched_entity_t se;
+  /// The scheduling class keeping the task, when it is runnable.
+  const struct sched_class_t *sched_class;
   /// Exit code of the process. (parameter of _exit() system call).
   int exit_code;
   /// The name of the task (Added for debug purpose).
@@ -123,7 +156,7 @@ typedef struct task_struct {
   /// Address of the LIBC sigreturn function.
   uint32_t sigreturn_addr;
   /// Pointer to the process’s signal handler descriptor
-  sighand_t sighand;
+  sighand_t *sighand;
   /// Mask of blocked signals.
   sigset_t blocked;
   /// Temporary mask of blocked signals (used by the rt_sigtimedwait() system call)
@@ -132,6 +165,9 @@ typedef struct task_struct {
   sigset_t saved_sigmask;
   /// Data structure storing the private pending signals
   sigpending_t pending;
+  /// Set when signals are queued (or unblocked), so that the way back to user
+  /// mode looks for them with do_signal.
+  bool_t sigpending;
 
   /// Timer for alarm syscall.
   struct timer_list *real_timer;
@@ -172,4 +208,9 @@ int tasking_init();
 /// @return Pointer to init process.
 task_struct *process_create_init(const char *path);
 
+/// @brief Create the idle task, a kernel task which halts the CPU, with
+///        interrupts enabled, whenever no other task is runnable.
+/// @return Pointer to the idle task.
+task_struct *process_create_idle();
+
 task_struct *create_task_test(const char *name);
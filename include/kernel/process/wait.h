@@ -99,6 +99,10 @@ void add_wait_queue(wait_queue_head_t *head, wait_queue_entry_t *wq);
 /// @param wq   The entry we remove from the waiting queue.
 void remove_wait_queue(wait_queue_head_t *head, wait_queue_entry_t *wq);
 
+/// @brief Wakes up all the entries of the waiting queue, and removes them.
+/// @param head The head of the waiting queue.
+void wake_up_all(wait_queue_head_t *head);
+
 /// @brief The default wake function, a wrapper for try_to_wake_up.
 /// @param wait The pointer to the wait queue.
 /// @param mode The type of wait (TASK_INTERRUPTIBLE or TASK_UNINTERRUPTIBLE).
@@ -106,10 +110,21 @@ void remove_wait_queue(wait_queue_head_t *head, wait_queue_entry_t *wq);
 /// @return 1 on success, 0 on failure.
 int default_wake_function(wait_queue_entry_t *wait, unsigned mode, int sync);
 
-/// @brief Sets the state of the current process to TASK_UNINTERRUPTIBLE
-///        and inserts it into the specified wait queue.
+/// @brief Sets the state of the current process to TASK_UNINTERRUPTIBLE,
+///        removes it from the runnable processes, and inserts it into the
+///        specified wait queue.
 ///
 /// @param wq Waitqueue where to sleep.
 /// @return Pointer to the entry inside the wq representing the
-///         sleeping process.
+///         sleeping process, it is part of the task and it is not allocated.
+///         NULL if the process already sleeps on a wait queue.
 wait_queue_entry_t *sleep_on(wait_queue_head_t *wq);
+
+/// @brief Same as sleep_on, but the process sleeps in TASK_INTERRUPTIBLE, and
+///        a signal wakes it up. It must be called from a system call which
+///        then returns -ERESTART, the signal turns it into -EINTR.
+///
+/// @param wq Waitqueue where to sleep.
+/// @return Pointer to the entry inside the wq representing the
+///         sleeping process, it is part of the task and it is not allocated.
+wait_queue_entry_t *sleep_on_interruptible(wait_queue_head_t *wq);
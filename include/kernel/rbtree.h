@@ -0,0 +1,138 @@
+/// @file rbtree.h
+/// @brief Red-black tree, whose nodes are embedded inside the structures
+/// they order (like list_head).
+/// @copyright (c) 2014-2022 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include <kernel/types.h>
+
+#define RB_RED   0 ///< The node is red.
+#define RB_BLACK 1 ///< The node is black.
+
+/// @brief A node of the red-black tree.
+typedef struct rb_node {
+  /// @brief The parent node, the node itself when it is not inside a tree.
+  struct rb_node *parent;
+  /// @brief The left child, with smaller keys.
+  struct rb_node *left;
+  /// @brief The right child, with greater or equal keys.
+  struct rb_node *right;
+  /// @brief The color of the node.
+  int color;
+} rb_node;
+
+/// @brief The root of a red-black tree.
+typedef struct rb_root {
+  /// @brief The root node.
+  rb_node *node;
+} rb_root;
+
+/// @brief The root of a red-black tree, which also keeps its leftmost node.
+typedef struct rb_root_cached {
+  /// @brief The tree.
+  rb_root root;
+  /// @brief The node with the smallest key.
+  rb_node *leftmost;
+} rb_root_cached;
+
+/// @brief Get the struct for this node.
+/// @param ptr    The &rb_node pointer.
+/// @param type   The type of the struct this is embedded in.
+/// @param member The name of the rb_node within the struct.
+#define rb_entry(ptr, type, member) container_of(ptr, type, member)
+
+/// @brief Initializes a node, which is not inside a tree.
+/// @param node The node.
+static inline void rb_node_init(rb_node *node) {
+  node->parent = node;
+  node->left   = NULL;
+  node->right  = NULL;
+  node->color  = RB_RED;
+}
+
+/// @brief Tests whether the node is outside of any tree.
+/// @param node The node.
+/// @return 1 if the node is not inside a tree, 0 otherwise.
+static inline int rb_node_empty(const rb_node *node) {
+  return node->parent == node;
+}
+
+/// @brief Initializes an empty tree.
+/// @param root The root of the tree.
+static inline void rb_root_init(rb_root_cached *root) {
+  root->root.node = NULL;
+  root->leftmost  = NULL;
+}
+
+/// @brief Links a new node in the place found while descending the tree,
+/// the tree must be rebalanced afterwards with rb_insert_color.
+/// @param node   The new node.
+/// @param parent The node which becomes its parent, NULL for the root.
+/// @param link   The child pointer of the parent (or the root) to set.
+static inline void rb_link_node(rb_node *node, rb_node *parent, rb_node **link) {
+  node->parent = parent;
+  node->left   = NULL;
+  node->right  = NULL;
+  node->color  = RB_RED;
+  *link        = node;
+}
+
+/// @brief Rebalances the tree after a node has been linked.
+/// @param node The linked node.
+/// @param root The root of the tree.
+void rb_insert_color(rb_node *node, rb_root *root);
+
+/// @brief Removes a node from the tree, and rebalances it.
+/// @param node The node.
+/// @param root The root of the tree.
+void rb_erase(rb_node *node, rb_root *root);
+
+/// @brief Returns the node with the smallest key.
+/// @param root The root of the tree.
+/// @return The node, NULL if the tree is empty.
+rb_node *rb_first(const rb_root *root);
+
+/// @brief Returns the node with the greatest key.
+/// @param root The root of the tree.
+/// @return The node, NULL if the tree is empty.
+rb_node *rb_last(const rb_root *root);
+
+/// @brief Returns the node which follows the given one.
+/// @param node The node.
+/// @return The next node, NULL if it is the last one.
+rb_node *rb_next(const rb_node *node);
+
+/// @brief Returns the node which precedes the given one.
+/// @param node The node.
+/// @return The previous node, NULL if it is the first one.
+rb_node *rb_prev(const rb_node *node);
+
+/// @brief Rebalances the tree after a node has been linked, updating the
+/// cached leftmost node.
+/// @param node     The linked node.
+/// @param root     The root of the tree.
+/// @param leftmost If the node has been linked as the leftmost one.
+static inline void rb_insert_color_cached(rb_node *node, rb_root_cached *root,
+                                          int leftmost) {
+  if (leftmost)
+    root->leftmost = node;
+  rb_insert_color(node, &root->root);
+}
+
+/// @brief Removes a node from the tree, updating the cached leftmost node.
+/// @param node The node.
+/// @param root The root of the tree.
+static inline void rb_erase_cached(rb_node *node, rb_root_cached *root) {
+  if (root->leftmost == node)
+    root->leftmost = rb_next(node);
+  rb_erase(node, &root->root);
+}
+
+/// @brief Returns the node with the smallest key, in constant time.
+/// @param root The root of the tree.
+/// @return The node, NULL if the tree is empty.
+static inline rb_node *rb_first_cached(const rb_root_cached *root) {
+  return root->leftmost;
+}
@@ -266,6 +266,15 @@ int do_signal(struct pt_regs *f);
 /// @return 1 on success, 0 on failure.
 int signals_init();
 
+/// @brief Allocates a signal handler descriptor, with the default actions.
+/// @return The descriptor, used by one task, NULL on failure.
+sighand_t *sighand_alloc(void);
+
+/// @brief Releases a signal handler descriptor, which is freed when no other
+/// task (created with CLONE_SIGHAND) uses it.
+/// @param sighand The descriptor.
+void sighand_put(sighand_t *sighand);
+
 /// @brief Send signal to one specific process.
 /// @param pid The PID of the process.
 /// @param sig The signal to be sent.
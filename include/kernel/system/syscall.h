@@ -187,6 +187,15 @@ char *sys_getcwd(char *buf, size_t size);
 ///         the new process to the old process.
 pid_t sys_fork(pt_regs *f);
 
+/// @brief Creates a child process, which can share the memory (a thread), the
+///        file descriptors and the signal handlers of the calling process.
+/// @param f CPU registers when calling this function: the flags in ebx, the
+///          stack of the child in ecx, and the base of its thread-local
+///          storage in esi.
+/// @return Return a negative errno for errors, 0 to the new process, and the
+///         process ID of the new process to the old process.
+pid_t sys_clone(pt_regs *f);
+
 /// @brief Stat the file at the given path.
 /// @param path Path to the file for which we are retrieving the statistics.
 /// @param buf  Buffer where we are storing the statistics.
@@ -228,6 +237,17 @@ int sys_creat(const char *path, mode_t mode);
 ///         appropriately.
 int sys_getdents(int fd, dirent_t *dirp, unsigned int count);
 
+/// Provide access to the directory entries, together with the information
+/// concerning each of them, saving a stat per entry.
+/// @param fd    The file descriptor of the directory for which we accessing
+///              the entries.
+/// @param dirp  The buffer where de data should be placed.
+/// @param count The size of the buffer.
+/// @return On success, the number of bytes read is returned.  On end of
+///         directory, 0 is returned.  On error, -1 is returned, and errno is set
+///         appropriately.
+int sys_getdentsplus(int fd, direntplus_t *dirp, unsigned int count);
+
 /// @brief Returns the current time.
 /// @param time Where the time should be stored.
 /// @return The current time.
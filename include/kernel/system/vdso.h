@@ -0,0 +1,51 @@
+/// @file   vdso.h
+/// @brief  Read-only data page shared by the kernel with every process.
+/// @copyright (c) 2014-2022 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include <kernel/types.h>
+#include <kernel/process/task.h>
+
+/// @brief The data page, mapped read-only at VDSO_DATA_START in every
+/// process (the layout is mirrored by apps/vdso.h).
+/// @details
+/// The page is written only by the kernel: `seq` is odd while an update is
+/// in progress, so readers retry until they see the same even value before
+/// and after reading the other fields.
+typedef struct vdso_data_t {
+  /// Sequence counter of the updates.
+  volatile uint32_t seq;
+  /// The number of ticks since the system started.
+  uint32_t ticks;
+  /// The number of ticks per second.
+  uint32_t ticks_per_second;
+  /// Seconds since the Epoch, read from the RTC at the last tick.
+  uint32_t wall_base;
+  /// Low 32 bits of the TSC at the last tick.
+  uint32_t tsc_lo;
+  /// High 32 bits of the TSC at the last tick.
+  uint32_t tsc_hi;
+  /// Nanoseconds are `((tsc - tsc_last) * tsc_mult) >> tsc_shift`, 0 while
+  /// the TSC has not been calibrated (or it is missing).
+  uint32_t tsc_mult;
+  /// Shift of the TSC scale.
+  uint32_t tsc_shift;
+  /// PID of the running process.
+  pid_t pid;
+  /// PID of the parent of the running process.
+  pid_t ppid;
+} vdso_data_t;
+
+/// @brief Allocates the data page, and maps it in the kernel directory,
+/// which is the template of every process directory.
+/// @return 0 on success, 1 on failure.
+int vdso_init(void);
+
+/// @brief Updates the time data, called on every tick.
+void vdso_update_time(void);
+
+/// @brief Updates the identity data, with the process about to run.
+/// @param process The process.
+void vdso_update_task(task_struct *process);
@@ -7,6 +7,7 @@
 #include <arch/i386/timer.h>
 #include <arch/i386/cpu.h>
 #include <arch/i386/serial.h>
+#include <arch/i386/sysenter.h>
 
 #include <kernel/kernel.h>
 #include <kernel/boot.h>
@@ -44,6 +45,12 @@ static inline void boot_init(uint32_t magic, uint32_t addr) {
   boot_info.kernel_end       = KERNEL_END;
   boot_info.kernel_size      = KERNEL_END - KERNEL_START;
 
+  // Get the physical range of the initial ramdisk, if loaded.
+  if (mboot.multiboot_module) {
+    boot_info.module_start = mboot.multiboot_module->mod_start;
+    boot_info.module_end   = mboot.multiboot_module->mod_end;
+  }
+
   // Get the maximum memory
   uint32_t highest_address  = 0;
   uint32_t addressable_size = 0;
@@ -157,6 +164,7 @@ int kenter(uint32_t magic, uint32_t addr) {
 
   // System call
   syscall_init();
+  sysenter_init();
 
   // Graphic
   video_init(&boot_info);
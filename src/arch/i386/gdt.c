@@ -1,7 +1,7 @@
 #include <arch/i386/gdt.h>
 #include <kernel/string.h>
 
-static struct gdt_descriptor gdt[MAX_DESCRIPTORS]; // 6 descriptors
+static struct gdt_descriptor gdt[MAX_DESCRIPTORS]; // 7 descriptors
 
 static struct gdtr gdtr; // one gdt register
 
@@ -67,5 +67,16 @@ void gdt_init() {
                      I86_GDT_GRAND_4K | I86_GDT_GRAND_32BIT |
                        I86_GDT_GRAND_LIMITHI_MASK);
 
+  //! set user mode thread-local storage descriptor, rebased by gdt_set_tls
+  gdt_set_tls(0);
+
   gdt_load((uint32_t)&gdtr);
 }
+
+void gdt_set_tls(uint32_t base) {
+  gdt_set_descriptor(GDT_TLS_INDEX, base, 0xffffffff,
+                     I86_GDT_DESC_READWRITE | I86_GDT_DESC_CODEDATA |
+                       I86_GDT_DESC_MEMORY | I86_GDT_DESC_DPL,
+                     I86_GDT_GRAND_4K | I86_GDT_GRAND_32BIT |
+                       I86_GDT_GRAND_LIMITHI_MASK);
+}
@@ -255,9 +255,9 @@ static void _page_fault(pt_regs *r) {
 /**
  * @brief Legacy system call entrypoint.
  *
- * We don't have a non-legacy entrypoint, but this use of
- * an interrupt to make syscalls is considered "legacy"
- * by the existence of its replacement (SYSCALL/SYSRET).
+ * This use of an interrupt to make syscalls is considered "legacy"
+ * by the existence of its replacement (SYSENTER/SYSEXIT), whose entry is
+ * `sysenter_entry` in irq.S. We keep it for the CPUs without SEP.
  *
  * @param r Interrupt register context, which contains syscall arguments.
  * @return Register state after system call, which contains return value.
@@ -0,0 +1,40 @@
+/// Change the header.
+#define __DEBUG_HEADER__ "[SYSENT]"
+/// Set the log level.
+#define __DEBUG_LEVEL__ LOGLEVEL_NOTICE
+
+#include <arch/i386/sysenter.h>
+#include <arch/i386/cpu.h>
+
+#include <kernel/printf.h>
+
+/// The entry point of SYSENTER, defined in irq.S.
+extern void sysenter_entry(void);
+
+/// If the MSRs of SYSENTER have been set up.
+static int sysenter_on = 0;
+
+void sysenter_init(void) {
+  uint32_t eax = 1, ebx, ecx = 0, edx;
+
+  // Leaf 1 of cpuid, EDX holds the feature flags (cpuid.h defines `sinfo`,
+  // so it can only be included once).
+  __asm__ __volatile__("cpuid"
+                       : "+a"(eax), "=b"(ebx), "+c"(ecx), "=d"(edx));
+  if (!(edx & CPUID_EDX_SEP)) {
+    dprintf("SYSENTER is not supported, using int $0x80 only.\n");
+    return;
+  }
+  // The stack is set by sysenter_set_stack, before entering userspace.
+  wrmsr(MSR_IA32_SYSENTER_CS, 0x08, 0);
+  wrmsr(MSR_IA32_SYSENTER_ESP, 0, 0);
+  wrmsr(MSR_IA32_SYSENTER_EIP, (uint32_t)sysenter_entry, 0);
+  sysenter_on = 1;
+  dprintf("SYSENTER enabled, entry at 0x%p.\n", sysenter_entry);
+}
+
+void sysenter_set_stack(uint32_t kesp) {
+  if (sysenter_on) {
+    wrmsr(MSR_IA32_SYSENTER_ESP, kesp, 0);
+  }
+}
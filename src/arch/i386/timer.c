@@ -11,6 +11,7 @@
 #include <kernel/memory/mmu.h>
 #include <kernel/process/wait.h>
 #include <kernel/system/signal.h>
+#include <kernel/system/vdso.h>
 #include <kernel/drivers/video.h>
 #include <kernel/assert.h>
 #include <kernel/errno.h>
@@ -24,10 +25,19 @@ int32_t timer_handler(pt_regs *reg) {
   // switch_fpu();
   // Check if a second has passed.
   // ++ticks;
+  // Publish the time to userspace.
+  vdso_update_time();
   // Update all timers
   run_timer_softirq();
-  // Perform the schedule.
-  scheduler_run(reg);
+  // The running process could have used up its time.
+  scheduler_set_need_resched();
+  // Perform the schedule, unless we interrupted the kernel while it waits
+  // for a device (there is a single kernel stack, we cannot switch task). In
+  // that case it runs when the system call returns. The idle task runs in
+  // the kernel too, but it can always be switched.
+  if (((reg->cs & 3) == 3) ||
+      (scheduler_get_current_process() == scheduler_get_idle_process()))
+    scheduler_run(reg);
   // Update graphics.
   video_update();
   // Restore fpu state.
@@ -415,33 +425,20 @@ static inline void debug_timeout(unsigned long data) {
     data, ticks, timer_get_seconds());
 }
 
-/// @brief Contains the entry of a wait queue and timespec which keeps trakc of
-///        the remaining time.
-typedef struct sleep_data_t {
-  /// POinter to the entry of a wait queue.
-  wait_queue_entry_t *entry;
-  /// Keeps track of the remaining time.
-  timespec *rem;
-} sleep_data_t;
-
 /// @brief Callback for when a sleep timer expires
-/// @param data Custom data stored in the timer
-void sleep_timeout(unsigned long data) {
-  // NOTE: We could modify the sleep_on and make it return the wait_queue_entry_t
-  //       and then store it in the dynamic timer data member instead of the task pid,
-  //       this would remove the need to iterate the sleep queue list.
-
-  sleep_data_t *sleep_data = (sleep_data_t *)data;
-
-  wait_queue_entry_t *entry = sleep_data->entry;
-  task_struct *task = entry->task;
+/// @param pid PID of the sleeping process.
+void sleep_timeout(unsigned long pid) {
+  task_struct *task = scheduler_get_running_process(pid);
+  if (task == NULL)
+    return;
+  // The task sleeps on the queue with its own entry.
+  wait_queue_entry_t *entry = &task->wait;
 
   // Executed entry's wakeup test function
   int res = entry->func(entry, 0, 0);
   if (res == 1) {
-    // Removes entry from list and memory
+    // Removes entry from list
     remove_wait_queue(&sleep_queue, entry);
-    kfree(entry);
 
     dprintf("Process (pid: %d) restored from sleep\n", task->pid);
   }
@@ -453,23 +450,17 @@ int sys_nanosleep(const timespec *req, timespec *rem) {
   // timer venga interrotto prima da un segnale.
   dprintf("sys_nanosleep([s:%d; ns:%d],...)\n", req->tv_sec, req->tv_nsec);
 
-  // Saves pid and rem timespec
-  sleep_data_t *data = kmalloc(sizeof(sleep_data_t));
-  data->rem = rem;
-
   // Create a dinamic timer to wake up the process after some time
   struct timer_list *sleep_timer = kmalloc(sizeof(struct timer_list));
   init_timer(sleep_timer);
 
-  sleep_timer->expires = timer_get_ticks() + TICKS_PER_SECOND * req->tv_sec;
+  sleep_timer->expires  = timer_get_ticks() + TICKS_PER_SECOND * req->tv_sec;
   sleep_timer->function = &sleep_timeout;
-  sleep_timer->data = (unsigned long)data;
+  sleep_timer->data     = scheduler_get_current_process()->pid;
 
-  // Removes current process from runqueue and stores it in the waiting queue,
-  // this must be done at the end, because it changes the current active page
-  // and invalidates the req and rem pointers (?)
-  wait_queue_entry_t *entry = sleep_on(&sleep_queue);
-  data->entry = entry;
+  // Removes current process from the runnable ones and stores it in the
+  // waiting queue.
+  sleep_on(&sleep_queue);
 
   add_timer(sleep_timer);
   return -1;
@@ -480,8 +471,10 @@ int sys_nanosleep(const timespec *req, timespec *rem) {
 void alarm_timeout(unsigned long pid) {
   sys_kill(pid, SIGALRM);
 
-  struct task_struct *cur = scheduler_get_current_process();
-  cur->real_timer = NULL;
+  // The timer belongs to the task which set the alarm.
+  struct task_struct *cur = scheduler_get_running_process(pid);
+  if (cur)
+    cur->real_timer = NULL;
 }
 
 int sys_alarm(int seconds) {
@@ -585,6 +578,8 @@ int sys_getitimer(int which, struct itimerval *curr_value) {
 // Real timer interval timemout
 static void it_real_fn(unsigned long pid) {
   struct task_struct *cur = scheduler_get_running_process(pid);
+  if (cur == NULL)
+    return;
   sys_kill(pid, SIGALRM);
 
   // If the real incr is not 0 then restart
@@ -5,6 +5,7 @@
 
 #include <arch/i386/tss.h>
 #include <arch/i386/gdt.h>
+#include <arch/i386/sysenter.h>
 
 #include <kernel/string.h>
 
@@ -52,4 +53,6 @@ void tss_set_stack(uint32_t kss, uint32_t kesp) {
   kernel_tss.ss0 = kss;
   // Kernel stack address.
   kernel_tss.esp0 = kesp;
+  // SYSENTER does not look at the TSS, it has its own stack.
+  sysenter_set_stack(kesp);
 }
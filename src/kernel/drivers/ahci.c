@@ -0,0 +1,628 @@
+/// Copyright (c) 2022-2025 Minh Hai Dao (barrydevp)
+
+#include <kernel/fs/ahci.h>
+
+#include <arch/i386/irq.h>
+#include <arch/i386/pic.h>
+#include <arch/i386/pci.h>
+#include <kernel/system/panic.h>
+#include <kernel/system/syscall.h>
+#include <kernel/errno.h>
+#include <kernel/memory/mmu.h>
+#include <kernel/memory/vmm.h>
+#include <kernel/string.h>
+#include <kernel/fs/vfs.h>
+#include <kernel/stdio.h>
+#include <kernel/bitops.h>
+#include <kernel/math.h>
+#include <kernel/kernel.h>
+
+#include <kernel/printf.h>
+
+/// How many times a register is polled before giving up.
+#define AHCI_POLL_LIMIT 1000000
+
+/// The interrupts we enable on each port.
+#define AHCI_PORT_IE                                                       \
+  ((1U << ahci_is_dhrs) | (1U << ahci_is_pss) | (1U << ahci_is_dss) |     \
+   (1U << ahci_is_sdbs) | (1U << ahci_is_dps) | (1U << ahci_is_ifs) |     \
+   (1U << ahci_is_hbds) | (1U << ahci_is_hbfs) | (1U << ahci_is_tfes))
+
+/// The interrupts reporting an error on a port.
+#define AHCI_PORT_IS_ERROR                                                 \
+  ((1U << ahci_is_ifs) | (1U << ahci_is_hbds) | (1U << ahci_is_hbfs) |    \
+   (1U << ahci_is_tfes))
+
+static uint32_t ahci_pci = 0x00000000;
+static hba_mem_t *ahci_hba = NULL;
+static int ahci_irq        = -1;
+static unsigned ahci_nslots = 1;
+static bool_t ahci_sncq     = false;
+static char ahci_drive_char = 'a';
+static ahci_port_t *ahci_ports[AHCI_MAX_PORTS] = { NULL };
+
+static int ahci_block_submit(block_device_t *, block_request_t *);
+static vfs_file_t *ahci_device_create(ahci_port_t *port);
+
+// == SUPPORT FUNCTIONS =======================================================
+/// @brief Polls a register until the given bits are all clear.
+/// @param reg the register.
+/// @param mask the bits.
+/// @return 0 if they cleared, -ETIMEDOUT otherwise.
+static inline int ahci_wait_clear(volatile uint32_t *reg, uint32_t mask) {
+  for (unsigned i = 0; i < AHCI_POLL_LIMIT; ++i) {
+    if (!(*reg & mask)) {
+      return 0;
+    }
+  }
+  return -ETIMEDOUT;
+}
+
+/// @brief Stops the command list and the FIS receive engines of a port.
+/// @param regs the registers of the port.
+static void ahci_port_stop(hba_port_t *regs) {
+  bit_clear_assign(regs->cmd, ahci_cmd_st);
+  ahci_wait_clear(&regs->cmd, 1U << ahci_cmd_cr);
+  bit_clear_assign(regs->cmd, ahci_cmd_fre);
+  ahci_wait_clear(&regs->cmd, 1U << ahci_cmd_fr);
+}
+
+/// @brief Starts the FIS receive and the command list engines of a port.
+/// @param regs the registers of the port.
+static void ahci_port_start(hba_port_t *regs) {
+  // Wait for the device to be idle, ST must not be set while BSY or DRQ are.
+  ahci_wait_clear(&regs->tfd, 0x88);
+  bit_set_assign(regs->cmd, ahci_cmd_fre);
+  bit_set_assign(regs->cmd, ahci_cmd_st);
+}
+
+/// @brief Checks if the device can transfer data directly to/from the buffer.
+/// @param buffer the virtual address of the buffer.
+/// @param size the size of the transfer.
+/// @param write if we are writing to the device.
+/// @return true if the PRDT can point to the buffer, false if the transfer
+/// must go through the bounce buffer.
+static inline bool_t ahci_can_map(uintptr_t buffer, size_t size, bool_t write) {
+  // The regions must be word aligned, we ask for dword alignment.
+  if (buffer & 0x3) {
+    return false;
+  }
+  // All the pages must be resident, and writable if the device writes them.
+  for (uintptr_t page = buffer & PAGE_MASK; page < buffer + size;
+       page += PAGE_SIZE) {
+    union PML *pte = vmm_get_page(page);
+    if (!pte || !pte->ptbits.present || (!write && !pte->ptbits.writable)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// @brief Describes a virtually contiguous buffer inside the PRDT of a
+/// command table, one entry per run of physically contiguous pages.
+/// @param table the command table.
+/// @param count the number of entries already used.
+/// @param buffer the buffer, dword aligned.
+/// @param size the size of the buffer, a multiple of two.
+/// @return the number of entries used, or -1 if the PRDT is full.
+static int ahci_prdt_add(ahci_cmd_table_t *table, int count, uintptr_t buffer,
+                         size_t size) {
+  ahci_prdt_t *last = count ? &table->prdt[count - 1] : NULL;
+  while (size) {
+    uint32_t phys  = vmm_r_get_phy_addr(buffer);
+    uint32_t chunk = min(size, PAGE_SIZE - (buffer & PAGE_LOW_MASK));
+    // Extend the previous region, an entry can describe up to 4MB.
+    if (last && (last->dba + (last->dbc & 0x3FFFFF) + 1 == phys) &&
+        ((last->dbc & 0x3FFFFF) + 1 + chunk <= 4 * MB)) {
+      last->dbc += chunk;
+    } else {
+      if (count == AHCI_PRDT_ENTRIES) {
+        return -1;
+      }
+      last       = &table->prdt[count++];
+      last->dba  = phys;
+      last->dbau = 0;
+      last->rsv  = 0;
+      last->dbc  = chunk - 1;
+    }
+    buffer += chunk;
+    size -= chunk;
+  }
+  return count;
+}
+
+/// @brief Fills the command header and the command FIS of a slot.
+/// @param port the port.
+/// @param slot the slot.
+/// @param command the ATA command.
+/// @param lba the first sector.
+/// @param count the number of sectors.
+/// @param prdtl the number of PRDT entries.
+/// @param write if the data goes to the device.
+static void ahci_setup_command(ahci_port_t *port, unsigned slot,
+                               uint8_t command, uint32_t lba, uint32_t count,
+                               int prdtl, bool_t write) {
+  ahci_cmd_header_t *header = &port->cmd_list[slot];
+  ahci_cmd_table_t *table   = port->tables[slot];
+  fis_reg_h2d_t *fis        = (fis_reg_h2d_t *)table->cfis;
+
+  memset(fis, 0, sizeof(fis_reg_h2d_t));
+  fis->fis_type = 0x27;
+  fis->flags    = 0x80;
+  fis->command  = command;
+  fis->device   = (command == ahci_command_identify) ? 0 : 0x40;
+  fis->lba0     = (lba >> 0) & 0xFF;
+  fis->lba1     = (lba >> 8) & 0xFF;
+  fis->lba2     = (lba >> 16) & 0xFF;
+  fis->lba3     = (lba >> 24) & 0xFF;
+  if ((command == ahci_command_read_fpdma) ||
+      (command == ahci_command_write_fpdma)) {
+    // Queued commands carry the count in the features, and the tag, which
+    // is the slot, in the count.
+    fis->featurel = count & 0xFF;
+    fis->featureh = (count >> 8) & 0xFF;
+    fis->countl   = slot << 3;
+  } else {
+    fis->countl = count & 0xFF;
+    fis->counth = (count >> 8) & 0xFF;
+  }
+
+  header->flags = (sizeof(fis_reg_h2d_t) / 4) | (write ? (1U << 6) : 0);
+  header->prdtl = prdtl;
+  header->prdbc = 0;
+}
+
+// == PORT MANAGEMENT =========================================================
+/// @brief Sends IDENTIFY DEVICE to the drive, polling for its completion.
+/// @param port the port.
+/// @return 0 on success, a negative errno value otherwise.
+static int ahci_port_identify(ahci_port_t *port) {
+  hba_port_t *regs = port->regs;
+  int prdtl = ahci_prdt_add(port->tables[0], 0, (uintptr_t)port->identity,
+                            sizeof(port->identity));
+  ahci_setup_command(port, 0, ahci_command_identify, 0, 0, prdtl, false);
+  regs->ci = 1U;
+  for (unsigned i = 0; i < AHCI_POLL_LIMIT; ++i) {
+    if (regs->is & (1U << ahci_is_tfes)) {
+      return -EIO;
+    }
+    if (!(regs->ci & 1U)) {
+      regs->is = regs->is;
+      return 0;
+    }
+  }
+  return -ETIMEDOUT;
+}
+
+/// @brief Completes the commands of a port.
+/// @param port the port.
+/// @param done the slots whose command completed.
+/// @param status 0 on success, a negative errno value otherwise.
+static void ahci_port_complete(ahci_port_t *port, uint32_t done, int status) {
+  while (done) {
+    unsigned slot        = find_first_non_zero(done);
+    block_request_t *req = port->slots[slot];
+    bit_clear_assign(done, slot);
+    // Copy from the bounce buffer to the buffers.
+    if (bit_check(port->bounced, slot) && !req->write && !status) {
+      uint8_t *bounce = port->bounce[slot];
+      list_for_each_decl(it, &req->bios) {
+        bio_t *bio = list_entry(it, bio_t, list);
+        memcpy(bio->buffer, bounce, bio->count * BLOCK_SECTOR_SIZE);
+        bounce += bio->count * BLOCK_SECTOR_SIZE;
+      }
+    }
+    bit_clear_assign(port->bounced, slot);
+    bit_clear_assign(port->issued, slot);
+    port->slots[slot] = NULL;
+    block_end_request(&port->block, req, status);
+  }
+}
+
+/// @brief Handles the interrupt of a port.
+/// @param port the port.
+static void ahci_port_irq(ahci_port_t *port) {
+  hba_port_t *regs = port->regs;
+  uint32_t is      = regs->is;
+  regs->is         = is;
+  if (is & AHCI_PORT_IS_ERROR) {
+    dprintf("[%s] Port error (IS: 0x%x, TFD: 0x%x, SERR: 0x%x).\n", port->name,
+            is, regs->tfd, regs->serr);
+    // The whole queue is aborted by the device, fail every command and
+    // restart the port to clear the error.
+    ahci_port_stop(regs);
+    regs->serr = regs->serr;
+    regs->is   = regs->is;
+    ahci_port_complete(port, port->issued, -EIO);
+    ahci_port_start(regs);
+    return;
+  }
+  // A slot is done once the device cleared both its issue and its tag bits.
+  ahci_port_complete(port, port->issued & ~(regs->sact | regs->ci), 0);
+}
+
+/// @brief Initializes a port with a drive attached.
+/// @param index the index of the port.
+/// @return 0 on success, 1 on error.
+static int ahci_port_init(unsigned index) {
+  hba_port_t *regs = &ahci_hba->ports[index];
+
+  ahci_port_t *port = kmalloc(sizeof(ahci_port_t));
+  if (!port) {
+    dprintf("Failed to allocate the AHCI port.\n");
+    return 1;
+  }
+  memset(port, 0, sizeof(ahci_port_t));
+  port->index = index;
+  port->regs  = regs;
+
+  // The engines must be stopped while we change the addresses.
+  ahci_port_stop(regs);
+
+  // The command list (1K) and the received FIS area (256 bytes) share a page,
+  // each command table fills a page.
+  port->cmd_list = (ahci_cmd_header_t *)kmalloc_align(PAGE_SIZE);
+  if (!port->cmd_list) {
+    dprintf("Failed to allocate the AHCI command list.\n");
+    return 1;
+  }
+  memset(port->cmd_list, 0, PAGE_SIZE);
+  uintptr_t phys = vmm_r_get_phy_addr((uintptr_t)port->cmd_list);
+  regs->clb      = phys;
+  regs->clbu     = 0;
+  regs->fb       = phys + 1024;
+  regs->fbu      = 0;
+  for (unsigned slot = 0; slot < ahci_nslots; ++slot) {
+    port->tables[slot] = (ahci_cmd_table_t *)kmalloc_align(PAGE_SIZE);
+    if (!port->tables[slot]) {
+      dprintf("Failed to allocate the AHCI command tables.\n");
+      return 1;
+    }
+    memset(port->tables[slot], 0, PAGE_SIZE);
+    port->cmd_list[slot].ctba =
+      vmm_r_get_phy_addr((uintptr_t)port->tables[slot]);
+    port->cmd_list[slot].ctbau = 0;
+  }
+
+  // Clear the pending errors and interrupts, and start the port.
+  regs->serr = regs->serr;
+  regs->is   = regs->is;
+  ahci_port_start(regs);
+
+  if (ahci_port_identify(port)) {
+    dprintf("Failed to identify the drive on AHCI port %u.\n", index);
+    ahci_port_stop(regs);
+    return 1;
+  }
+
+  // Use native command queuing when both the HBA and the drive support it.
+  port->ncq = ahci_sncq && bit_check(port->identity[AHCI_IDENT_SATA_CAPS], 8);
+  port->nslots = ahci_nslots;
+  if (port->ncq) {
+    port->nslots = min(port->nslots,
+                       (port->identity[AHCI_IDENT_QUEUE_DEPTH] & 0x1F) + 1U);
+  }
+
+  // Set the device name and path.
+  sprintf(port->name, "sd%c", ahci_drive_char);
+  sprintf(port->path, "/dev/sd%c", ahci_drive_char);
+  // Create the filesystem entry for the drive.
+  port->fs_root = ahci_device_create(port);
+  if (!port->fs_root) {
+    dprintf("Failed to create ahci device!\n");
+    return 1;
+  }
+  // The VFS lengths are 32 bit, larger drives are truncated.
+  const uint16_t *id = port->identity;
+  uint32_t sectors   = ((uint32_t)id[AHCI_IDENT_LBA48 + 1] << 16) |
+                     id[AHCI_IDENT_LBA48];
+  if (id[AHCI_IDENT_LBA48 + 2] || id[AHCI_IDENT_LBA48 + 3]) {
+    sectors = 0xFFFFFFFFU;
+  } else if (!sectors) {
+    sectors = ((uint32_t)id[AHCI_IDENT_LBA28 + 1] << 16) | id[AHCI_IDENT_LBA28];
+  }
+  port->fs_root->length =
+    min(sectors, 0xFFFFFFFFU / BLOCK_SECTOR_SIZE) * BLOCK_SECTOR_SIZE;
+  // Try to mount the drive.
+  if (!vfs_mount(port->path, port->fs_root)) {
+    dprintf("Failed to mount ahci device!\n");
+    return 1;
+  }
+
+  // Register the block device, with one request in flight per slot.
+  strcpy(port->block.name, port->name);
+  port->block.sector_count = port->fs_root->length / BLOCK_SECTOR_SIZE;
+  port->block.max_sectors  = AHCI_MAX_SECTORS;
+  port->block.queue_depth  = port->nslots;
+  port->block.submit       = ahci_block_submit;
+  port->block.data         = port;
+  port->block.file         = port->fs_root;
+  if (block_register(&port->block) < 0) {
+    return 1;
+  }
+
+  // Enable the interrupts of the port.
+  regs->ie = AHCI_PORT_IE;
+
+  ahci_ports[index] = port;
+  ++ahci_drive_char;
+
+  dprintf("Device name     : %s\n", port->name);
+  dprintf("AHCI port       : %u\n", port->index);
+  dprintf("Sectors (48)    : %u\n", port->block.sector_count);
+  dprintf("Command slots   : %u%s\n", port->nslots, port->ncq ? " (NCQ)" : "");
+  return 0;
+}
+
+// == BLOCK LAYER =============================================================
+/// @brief Issues a request of the block layer on a free command slot.
+/// @param bdev the block device.
+/// @param req the request, at most AHCI_MAX_SECTORS long.
+/// @return BLOCK_QUEUED, or a negative errno value.
+/// @details When possible the device accesses the buffers of the bios
+/// directly, otherwise the data goes through the bounce buffer of the slot.
+/// The request is completed by the IRQ handler.
+static int ahci_block_submit(block_device_t *bdev, block_request_t *req) {
+  ahci_port_t *port = (ahci_port_t *)bdev->data;
+  list_head *it;
+  bio_t *bio;
+
+  // The block layer never has more requests in flight than slots.
+  unsigned slot = find_first_zero(port->issued);
+  if ((slot >= port->nslots) || bit_check(port->issued, slot)) {
+    return -EBUSY;
+  }
+  ahci_cmd_table_t *table = port->tables[slot];
+
+  // Describe the pages of each bio.
+  int prdtl = 0;
+  list_for_each(it, &req->bios) {
+    bio = list_entry(it, bio_t, list);
+    if (!ahci_can_map((uintptr_t)bio->buffer, bio->count * BLOCK_SECTOR_SIZE,
+                      req->write)) {
+      prdtl = -1;
+      break;
+    }
+    prdtl = ahci_prdt_add(table, prdtl, (uintptr_t)bio->buffer,
+                          bio->count * BLOCK_SECTOR_SIZE);
+    if (prdtl < 0) {
+      break;
+    }
+  }
+  if (prdtl < 0) {
+    // Fall back to the bounce buffer of the slot.
+    if (!port->bounce[slot]) {
+      port->bounce[slot] = kmalloc_align(AHCI_BOUNCE_SIZE);
+      if (!port->bounce[slot]) {
+        return -ENOMEM;
+      }
+    }
+    if (req->write) {
+      uint8_t *bounce = port->bounce[slot];
+      list_for_each(it, &req->bios) {
+        bio = list_entry(it, bio_t, list);
+        memcpy(bounce, bio->buffer, bio->count * BLOCK_SECTOR_SIZE);
+        bounce += bio->count * BLOCK_SECTOR_SIZE;
+      }
+    }
+    prdtl = ahci_prdt_add(table, 0, (uintptr_t)port->bounce[slot],
+                          req->count * BLOCK_SECTOR_SIZE);
+    bit_set_assign(port->bounced, slot);
+  }
+
+  uint8_t command;
+  if (port->ncq) {
+    command = req->write ? ahci_command_write_fpdma : ahci_command_read_fpdma;
+  } else {
+    command = req->write ? ahci_command_write_ext : ahci_command_read_ext;
+  }
+  ahci_setup_command(port, slot, command, req->sector, req->count, prdtl,
+                     req->write);
+
+  // Issue the command, queued commands also need their tag to be active.
+  port->slots[slot] = req;
+  bit_set_assign(port->issued, slot);
+  if (port->ncq) {
+    port->regs->sact = 1U << slot;
+  }
+  port->regs->ci = 1U << slot;
+  return BLOCK_QUEUED;
+}
+
+// == VFS CALLBACKS ===========================================================
+static vfs_file_t *ahci_open(const char *path, int flags, mode_t mode) {
+  dprintf("ahci_open(%s, %d, %d)\n", path, flags, mode);
+  for (unsigned i = 0; i < AHCI_MAX_PORTS; ++i) {
+    ahci_port_t *port = ahci_ports[i];
+    if (port && (strcmp(path, port->path) == 0)) {
+      ++port->fs_root->count;
+      return port->fs_root;
+    }
+  }
+  return NULL;
+}
+
+static int ahci_close(vfs_file_t *file) {
+  dprintf("ahci_close(%p)\n", file);
+  if (file->device == NULL) {
+    kernel_panic("Device not set.");
+  }
+  --file->count;
+  return 0;
+}
+
+static ssize_t ahci_read(vfs_file_t *file, char *buffer, off_t offset,
+                         size_t size) {
+  ahci_port_t *port = (ahci_port_t *)file->device;
+  if (port == NULL) {
+    kernel_panic("Device not set.");
+  }
+  return block_read(&port->block, buffer, offset, size);
+}
+
+static ssize_t ahci_write(vfs_file_t *file, const void *buffer, off_t offset,
+                          size_t size) {
+  ahci_port_t *port = (ahci_port_t *)file->device;
+  if (port == NULL) {
+    kernel_panic("Device not set.");
+  }
+  return block_write(&port->block, buffer, offset, size);
+}
+
+static int _ahci_stat(const ahci_port_t *port, stat_t *stat) {
+  if (port && port->fs_root) {
+    stat->st_dev   = 0;
+    stat->st_ino   = 0;
+    stat->st_mode  = 0060000 | 0600;
+    stat->st_uid   = 0;
+    stat->st_gid   = 0;
+    stat->st_atime = sys_time(NULL);
+    stat->st_mtime = stat->st_atime;
+    stat->st_ctime = stat->st_atime;
+    stat->st_size  = port->fs_root->length;
+  }
+  return 0;
+}
+
+static int ahci_fstat(vfs_file_t *file, stat_t *stat) {
+  return _ahci_stat(file->device, stat);
+}
+
+static int ahci_stat(const char *path, stat_t *stat) {
+  super_block_t *sb = vfs_get_superblock(path);
+  if (sb && sb->root) {
+    return _ahci_stat(sb->root->device, stat);
+  }
+  return -1;
+}
+
+// == VFS ENTRY GENERATION ====================================================
+/// Filesystem general operations.
+static vfs_sys_operations_t ahci_sys_operations = {
+  .stat_f = ahci_stat,
+};
+
+/// AHCI filesystem file operations.
+static vfs_file_operations_t ahci_fs_operations = {
+  .open_f  = ahci_open,
+  .close_f = ahci_close,
+  .read_f  = ahci_read,
+  .write_f = ahci_write,
+  .stat_f  = ahci_fstat,
+};
+
+static vfs_file_t *ahci_device_create(ahci_port_t *port) {
+  vfs_file_t *file = kmalloc(sizeof(vfs_file_t));
+  if (file == NULL) {
+    dprintf("Failed to create AHCI device.\n");
+    return NULL;
+  }
+  memset(file, 0, sizeof(vfs_file_t));
+  memcpy(file->name, port->name, NAME_MAX);
+  file->device         = port;
+  file->flags          = DT_BLK;
+  file->mask           = 0600;
+  file->sys_operations = &ahci_sys_operations;
+  file->fs_operations  = &ahci_fs_operations;
+  return file;
+}
+
+// == IRQ HANDLERS ============================================================
+/// @param f The interrupt stack frame.
+static int32_t ahci_irq_handler(pt_regs *f) {
+  uint32_t is = ahci_hba->is;
+  if (!is) {
+    // The line is shared, and it was not us.
+    return IRQ_CONTINUE;
+  }
+  for (uint32_t pending = is; pending;) {
+    unsigned index = find_first_non_zero(pending);
+    bit_clear_assign(pending, index);
+    if (ahci_ports[index]) {
+      ahci_port_irq(ahci_ports[index]);
+    } else {
+      ahci_hba->ports[index].is = ahci_hba->ports[index].is;
+    }
+  }
+  // The port bits are cleared after the port status.
+  ahci_hba->is = is;
+  irq_ack(ahci_irq);
+  return IRQ_STOP;
+}
+
+// == PCI FUNCTIONS ===========================================================
+static void pci_find_ahci(uint32_t dev, uint16_t vid, uint16_t did,
+                          void *extra) {
+  // Take the first controller.
+  if (!*((uint32_t *)extra)) {
+    *((uint32_t *)extra) = dev;
+  }
+}
+
+// == INITIALIZE/FINALIZE AHCI ================================================
+int ahci_init() {
+  // Search for the AHCI controller.
+  pci_scan(&pci_find_ahci, PCI_TYPE_AHCI, &ahci_pci);
+  if (!ahci_pci) {
+    dprintf("No AHCI controller found.\n");
+    return 1;
+  }
+
+  // Enable memory space accesses and bus mastering.
+  uint32_t pci_cmd = pci_read_field(ahci_pci, PCI_COMMAND, 4);
+  bit_set_assign(pci_cmd, pci_command_memory_space);
+  bit_set_assign(pci_cmd, pci_command_bus_master);
+  pci_write_field(ahci_pci, PCI_COMMAND, 4, pci_cmd);
+
+  // Map the HBA registers, the ABAR is in BAR5.
+  uint32_t abar = pci_read_field(ahci_pci, PCI_BASE_ADDRESS_5, 4) & ~0xFU;
+  ahci_hba      = (hba_mem_t *)vmm_map_mmio(abar, sizeof(hba_mem_t));
+  if (!ahci_hba) {
+    dprintf("Failed to map the AHCI registers.\n");
+    return 1;
+  }
+
+  // Switch to AHCI mode, with the interrupts disabled until the ports are
+  // ready.
+  bit_set_assign(ahci_hba->ghc, ahci_ghc_ae);
+  bit_clear_assign(ahci_hba->ghc, ahci_ghc_ie);
+
+  ahci_nslots = ((ahci_hba->cap >> 8) & 0x1F) + 1;
+  ahci_sncq   = bit_check(ahci_hba->cap, 30) != 0;
+  dprintf("AHCI controller 0x%x: ABAR 0x%x, version 0x%x, %u slots%s\n",
+          ahci_pci, abar, ahci_hba->vs, ahci_nslots,
+          ahci_sncq ? ", NCQ" : "");
+
+  // Bring up the ports with a SATA drive attached: the device is present and
+  // the link established, the interface is active.
+  uint32_t pi = ahci_hba->pi;
+  for (unsigned i = 0; i < AHCI_MAX_PORTS; ++i) {
+    if (!bit_check(pi, i)) {
+      continue;
+    }
+    hba_port_t *regs = &ahci_hba->ports[i];
+    if (((regs->ssts & 0x0F) != 3) || (((regs->ssts >> 8) & 0x0F) != 1)) {
+      continue;
+    }
+    if (regs->sig != AHCI_SIG_ATA) {
+      dprintf("AHCI port %u: unsupported device (signature 0x%x).\n", i,
+              regs->sig);
+      continue;
+    }
+    if (ahci_port_init(i)) {
+      dprintf("Failed to initialize AHCI port %u!\n", i);
+    }
+  }
+
+  // Install the IRQ handler, using the legacy INTx line.
+  ahci_irq = pci_get_interrupt(ahci_pci);
+  irq_install_handler(ahci_irq, ahci_irq_handler);
+  pic_clear_mask(ahci_irq);
+  ahci_hba->is = ahci_hba->is;
+  bit_set_assign(ahci_hba->ghc, ahci_ghc_ie);
+  return 0;
+}
+
+int ahci_finalize() {
+  return 0;
+}
@@ -18,10 +18,16 @@
 #include <kernel/fcntl.h>
 #include <kernel/stdio.h>
 #include <kernel/bitops.h>
+#include <kernel/arch.h>
+#include <kernel/process/scheduler.h>
+#include <kernel/math.h>
 
 #include <kernel/printf.h>
 
-static spinlock_t ata_lock;
+/// The primary IDE channel.
+static ata_channel_t ata_primary_channel;
+/// The secondary IDE channel.
+static ata_channel_t ata_secondary_channel;
 
 static char ata_drive_char = 'a';
 static int cdrom_number    = 0;
@@ -43,7 +49,8 @@ static ata_device_t ata_primary_master = {
   },
   .control_base = 0x3F6,
   .slave        = 0,
-  .primary      = true
+  .primary      = true,
+  .channel      = &ata_primary_channel
 };
 
 static ata_device_t ata_primary_slave = {
@@ -62,7 +69,8 @@ static ata_device_t ata_primary_slave = {
   },
   .control_base = 0x3F6,
   .slave        = 1,
-  .primary      = true
+  .primary      = true,
+  .channel      = &ata_primary_channel
 };
 
 static ata_device_t ata_secondary_master = {
@@ -81,7 +89,8 @@ static ata_device_t ata_secondary_master = {
   },
   .control_base = 0x376,
   .slave        = 0,
-  .primary      = false
+  .primary      = false,
+  .channel      = &ata_secondary_channel
 };
 
 static ata_device_t ata_secondary_slave = {
@@ -100,11 +109,11 @@ static ata_device_t ata_secondary_slave = {
   },
   .control_base = 0x376,
   .slave        = 1,
-  .primary      = false
+  .primary      = false,
+  .channel      = &ata_secondary_channel
 };
 
-static void ata_device_read_sector(ata_device_t *, uint64_t, uint8_t *);
-static void ata_device_write_sector(ata_device_t *, uint64_t, uint8_t *);
+static int ata_block_submit(block_device_t *, block_request_t *);
 
 static vfs_file_t *ata_open(const char *, int, mode_t);
 static int ata_close(vfs_file_t *);
@@ -352,7 +361,9 @@ static inline uintptr_t malloc_dma(size_t size, uintptr_t *physical) {
   // dprintf("[DMA Malloc] The lowmem address is at   : 0x%p\n", lowmem_address);
   // return lowmem_address;
 
-  uintptr_t dma_vaddr = (uintptr_t)kmalloc(size);
+  // Page align the area, so that the PRDT does not cross a 64K boundary and
+  // the DMA area starts at the beginning of a physical page.
+  uintptr_t dma_vaddr = (uintptr_t)kmalloc_align(size);
   *physical           = vmm_r_get_phy_addr(dma_vaddr);
 
   dprintf("[DMA Malloc] Size requirement is        : %d\n", size);
@@ -373,16 +384,11 @@ static bool_t ata_device_init(ata_device_t *dev) {
   ata_read_device_identity(dev, ata_command_pata_ident);
 
   // Allocate the memory for the Physical Region Descriptor Table (PRDT).
-  dev->dma_prdt = (prdt_t *)malloc_dma(sizeof(prdt_t), &dev->dma_prdt_phys);
-  // Allocate the memory for the Direct Memory Access (DMA).
+  dev->dma_prdt = (prdt_t *)malloc_dma(sizeof(prdt_t) * ATA_PRDT_ENTRIES,
+                                       &dev->dma_prdt_phys);
+  // Allocate the memory for the Direct Memory Access (DMA), the PRDT is
+  // filled for each transfer.
   dev->dma_start = (uint8_t *)malloc_dma(ATA_DMA_SIZE, &dev->dma_start_phys);
-  // Initialize the table, specifying the physical address of the DMA.
-  dev->dma_prdt->physical_address = dev->dma_start_phys;
-  // The size of the DMA.
-  dev->dma_prdt->byte_count = ATA_DMA_SIZE;
-  // Set the EOT to 1.
-  dev->dma_prdt->end_of_table = 0x8000;
-
   // Update the filesystem entry with the length of the device.
   dev->fs_root->length = ata_max_offset(dev);
 
@@ -392,6 +398,17 @@ static bool_t ata_device_init(ata_device_t *dev) {
   // Initialize the bus mastering addresses.
   ata_initialize_bus_mastering_address(dev);
 
+  // Register the block device, requests are limited by the DMA area.
+  strcpy(dev->block.name, dev->name);
+  dev->block.sector_count = ata_max_offset(dev) / ATA_SECTOR_SIZE;
+  dev->block.max_sectors  = ATA_DMA_SECTORS;
+  dev->block.submit       = ata_block_submit;
+  dev->block.data         = dev;
+  dev->block.file         = dev->fs_root;
+  if (block_register(&dev->block) < 0) {
+    return 1;
+  }
+
   // Print the device data.
   dprintf("Device name     : %s\n", dev->name);
   dprintf("Device status   : [%s]\n", ata_get_device_status_str(dev));
@@ -412,16 +429,170 @@ static bool_t ata_device_init(ata_device_t *dev) {
 }
 
 // == ATA SECTOR READ/WRITE FUNCTIONS =========================================
-static void ata_device_read_sector(ata_device_t *dev, uint32_t lba,
-                                   uint8_t *buffer) {
-  // Check if we are trying to perform the read on the correct drive type.
-  if ((dev->type != ata_dev_type_pata) && (dev->type != ata_dev_type_sata)) {
-    return;
+/// @brief Appends to the PRDT the physical regions backing the given buffer.
+/// @param dev the device.
+/// @param last the last entry of the PRDT, NULL if it is empty.
+/// @param buffer the virtual address of the buffer.
+/// @param size the size of the buffer.
+/// @return the new last entry of the PRDT.
+/// @details Each region must be contiguous in physical memory and must not
+/// cross a 64K boundary, physically adjacent pages are merged together.
+static inline prdt_t *ata_dma_prdt_add(ata_device_t *dev, prdt_t *last,
+                                       uintptr_t buffer, size_t size) {
+  uintptr_t phys;
+  size_t chunk;
+  for (size_t done = 0; done < size; done += chunk, buffer += chunk) {
+    phys  = vmm_r_get_phy_addr(buffer);
+    chunk = min(PAGE_SIZE - (buffer & PAGE_LOW_MASK), size - done);
+    // Extend the last region if it stays inside the same 64K block, a byte
+    // count of 0 means 64K.
+    if (last && (phys & 0xFFFF) &&
+        (phys == last->physical_address +
+                   (last->byte_count ? last->byte_count : 0x10000))) {
+      last->byte_count = (last->byte_count + chunk) & 0xFFFF;
+    } else {
+      last                   = last ? last + 1 : dev->dma_prdt;
+      last->physical_address = phys;
+      last->byte_count       = chunk & 0xFFFF;
+      last->end_of_table     = 0;
+    }
+  }
+  return last;
+}
+
+/// @brief Checks if the device can transfer data directly to/from the buffer.
+/// @param buffer the virtual address of the buffer.
+/// @param size the size of the transfer.
+/// @param write if we are writing to the device.
+/// @return true if the PRDT can point to the buffer, false if the transfer
+/// must go through the DMA area.
+static inline bool_t ata_dma_can_map(uintptr_t buffer, size_t size,
+                                     bool_t write) {
+  // The regions must be word aligned, we ask for dword alignment.
+  if (buffer & 0x3) {
+    return false;
   }
-  //dprintf("ata_device_read_sector(dev: %p, lba: %d, buff: %p)\n", dev, lba, buffer);
-  spinlock_lock(&ata_lock);
+  // All the pages must be resident, and writable if the device writes them.
+  for (uintptr_t page = buffer & PAGE_MASK; page < buffer + size;
+       page += PAGE_SIZE) {
+    union PML *pte = vmm_get_page(page);
+    if (!pte || !pte->ptbits.present || (!write && !pte->ptbits.writable)) {
+      return false;
+    }
+  }
+  return true;
+}
 
-  ata_wait(dev, 0);
+/// @brief Programs the LBA and the number of sectors of the next command.
+/// @param dev the device.
+/// @param lba the first sector.
+/// @param count the number of sectors.
+/// @param lba48 if the 48 bit LBA registers must be used.
+static inline void ata_device_setup_lba(ata_device_t *dev, uint32_t lba,
+                                        uint32_t count, bool_t lba48) {
+  if (lba48) {
+    outportb(dev->io_reg.hddevsel, 0x40 | (dev->slave << 4));
+    ata_io_wait(dev);
+    outportb(dev->io_reg.feature, 0x00);
+    // High order bytes first.
+    outportb(dev->io_reg.sector_count, (count & 0xFF00) >> 8);
+    outportb(dev->io_reg.lba_lo, (lba & 0xFF000000) >> 24);
+    outportb(dev->io_reg.lba_mid, 0);
+    outportb(dev->io_reg.lba_hi, 0);
+  } else {
+    outportb(dev->io_reg.hddevsel,
+             0xE0 | (dev->slave << 4) | ((lba & 0x0F000000) >> 24));
+    ata_io_wait(dev);
+    outportb(dev->io_reg.feature, 0x00);
+  }
+  // A sector count of 0 means 256 (or 65536 for 48 bit LBA).
+  outportb(dev->io_reg.sector_count, count & 0xFF);
+  outportb(dev->io_reg.lba_lo, (lba & 0x000000FF) >> 0);
+  outportb(dev->io_reg.lba_mid, (lba & 0x0000FF00) >> 8);
+  outportb(dev->io_reg.lba_hi, (lba & 0x00FF0000) >> 16);
+}
+
+/// @brief Puts the current task to sleep until the channel is idle.
+/// @param channel the channel.
+/// @details The kernel has a single kernel stack, so the task cannot be
+/// switched out in the middle of a system call. Instead, it is marked as
+/// sleeping on the channel wait queue and the CPU is halted with interrupts
+/// enabled, until the IRQ handler completes the transfer and wakes it up.
+static inline void ata_channel_wait(ata_channel_t *channel) {
+  task_struct *task = scheduler_get_current_process();
+  wait_queue_entry_t entry;
+  // There are no tasks while we are booting.
+  if (task) {
+    init_waitqueue_entry(&entry, task);
+    add_wait_queue(&channel->wait, &entry);
+    scheduler_block_task(task, TASK_UNINTERRUPTIBLE);
+  }
+  // Checking the channel with interrupts disabled and then executing
+  // `sti; hlt` cannot miss the IRQ, since `sti` enables them only after `hlt`.
+  while (channel->active) {
+    arch_pause();
+  }
+  if (task) {
+    remove_wait_queue(&channel->wait, &entry);
+  }
+}
+
+/// @brief Wakes up the tasks waiting for the channel.
+/// @param channel the channel.
+static inline void ata_channel_wake(ata_channel_t *channel) {
+  list_for_each_decl(it, &channel->wait.task_list) {
+    wait_queue_entry_t *entry = list_entry(it, wait_queue_entry_t, task_list);
+    entry->func(entry, 0, 0);
+  }
+}
+
+/// @brief Waits, for a bounded number of status reads, for the device to be
+/// ready to accept a command.
+/// @param dev the device.
+/// @return 0 if the device is ready, -ETIMEDOUT otherwise.
+static inline int ata_wait_ready(ata_device_t *dev) {
+  for (unsigned i = 0; i < ATA_POLL_LIMIT; ++i) {
+    uint8_t status = inportb(dev->io_reg.status);
+    if (!bit_check(status, ata_status_bsy) && bit_check(status, ata_status_rdy))
+      return 0;
+    cpu_relax();
+  }
+  return -ETIMEDOUT;
+}
+
+/// @brief Takes the channel of the device for a transfer, waiting for the
+/// other drive of the channel if it is busy.
+/// @param dev the device.
+static inline void ata_channel_acquire(ata_device_t *dev) {
+  ata_channel_t *channel = dev->channel;
+  spinlock_lock(&channel->lock);
+  while (channel->active) {
+    spinlock_unlock(&channel->lock);
+    ata_channel_wait(channel);
+    spinlock_lock(&channel->lock);
+  }
+  channel->active = dev;
+  spinlock_unlock(&channel->lock);
+}
+
+/// @brief Starts transferring `count` sectors between the device and the
+/// memory described by the PRDT, the IRQ handler of the channel completes
+/// the transfer.
+/// @param dev the device, it must hold its channel.
+/// @param lba the first sector.
+/// @param count the number of sectors, at most ATA_DMA_SECTORS.
+/// @param write if we are writing to the device.
+/// @return 0 if the transfer started, -ETIMEDOUT if the device stayed busy.
+static int ata_device_dma_start(ata_device_t *dev, uint32_t lba,
+                                uint32_t count, bool_t write) {
+  // Use 48 bit LBA commands only when the device supports them.
+  bool_t lba48     = dev->identity.sectors_48 != 0;
+  uint8_t bm_write = write ? 0x00 : 0x08;
+  uint8_t command;
+  if (write)
+    command = lba48 ? ata_dma_command_write_ext : ata_dma_command_write;
+  else
+    command = lba48 ? ata_dma_command_read_ext : ata_dma_command_read;
 
   // Reset bus master register's command register.
   outportb(dev->bmr.command, 0x00);
@@ -429,118 +600,96 @@ static void ata_device_read_sector(ata_device_t *dev, uint32_t lba,
   // Set the PRDT.
   outportl(dev->bmr.prdt, dev->dma_prdt_phys);
 
-  // Enable error, irq status.
+  // Clear error, irq status.
   outportb(dev->bmr.status, inportb(dev->bmr.status) | 0x04 | 0x02);
 
-  // Set read.
-  outportb(dev->bmr.command, 0x08);
+  // Set the direction.
+  outportb(dev->bmr.command, bm_write);
 
-  while (1) {
-    uint8_t status = inportb(dev->io_reg.status);
-    if (!bit_check(status, ata_status_bsy))
-      break;
-  }
+  // Wait for the device to be ready.
+  if (bit_check(ata_status_wait(dev, ATA_POLL_LIMIT), ata_status_bsy))
+    return -ETIMEDOUT;
 
   outportb(dev->control_base, 0x00);
-  outportb(dev->io_reg.hddevsel, 0xe0 | (dev->slave << 4));
-  ata_io_wait(dev);
-  outportb(dev->io_reg.feature, 0x00);
-
-  outportb(dev->io_reg.sector_count, 0);
-  outportb(dev->io_reg.lba_lo, (lba & 0xff000000) >> 24);
-  outportb(dev->io_reg.lba_mid, (lba & 0xff00000000) >> 32);
-  outportb(dev->io_reg.lba_hi, (lba & 0xff0000000000) >> 40);
+  ata_device_setup_lba(dev, lba, count, lba48);
 
-  outportb(dev->io_reg.sector_count, 1);
-  outportb(dev->io_reg.lba_lo, (lba & 0x000000ff) >> 0);
-  outportb(dev->io_reg.lba_mid, (lba & 0x0000ff00) >> 8);
-  outportb(dev->io_reg.lba_hi, (lba & 0x00ff0000) >> 16);
+  // Wait for the device to accept the command, for a bounded time.
+  if (ata_wait_ready(dev))
+    return -ETIMEDOUT;
 
-  while (1) {
-    uint8_t status = inportb(dev->io_reg.status);
-    if (!bit_check(status, ata_status_bsy) && bit_check(status, ata_status_rdy))
-      break;
-  }
-
-  // Write the READ_DMA to the command register (0xC8)
-  outportb(dev->io_reg.command, ata_dma_command_read);
+  // Send the DMA command.
+  outportb(dev->io_reg.command, command);
 
   ata_io_wait(dev);
 
-  outportb(dev->bmr.command, 0x08 | 0x01);
+  // Start the bus master.
+  outportb(dev->bmr.command, bm_write | 0x01);
+  return 0;
+}
 
-  while (1) {
-    int status  = inportb(dev->bmr.status);
-    int dstatus = inportb(dev->io_reg.status);
-    if (!(status & 0x04)) {
-      continue;
-    }
-    if (!bit_check(dstatus, ata_status_bsy)) {
+/// @brief Starts a request of the block layer, with a single DMA command.
+/// @param bdev the block device.
+/// @param req the request, at most ATA_DMA_SECTORS long.
+/// @return BLOCK_QUEUED, or a negative errno value.
+/// @details When possible the device accesses the buffers of the bios
+/// directly, otherwise the data goes through the DMA area. The PRDT and the
+/// DMA area belong to the drive, so they are prepared before waiting for the
+/// channel. The IRQ handler of the channel completes the request.
+static int ata_block_submit(block_device_t *bdev, block_request_t *req) {
+  ata_device_t *dev = (ata_device_t *)bdev->data;
+  bio_t *bio;
+  list_head *it;
+  // Check if we are trying to perform the I/O on the correct drive type.
+  if ((dev->type != ata_dev_type_pata) && (dev->type != ata_dev_type_sata)) {
+    return -ENODEV;
+  }
+  bool_t direct = true;
+  list_for_each(it, &req->bios) {
+    bio = list_entry(it, bio_t, list);
+    if (!ata_dma_can_map((uintptr_t)bio->buffer,
+                         bio->count * ATA_SECTOR_SIZE, req->write)) {
+      direct = false;
       break;
     }
   }
 
-  // Copy from DMA buffer to output buffer.
-  memcpy(buffer, dev->dma_start, ATA_DMA_SIZE);
-
-  // Inform device we are done.
-  outportb(dev->bmr.status, inportb(dev->bmr.status) | 0x04 | 0x02);
-
-  spinlock_unlock(&ata_lock);
-}
-
-static void ata_device_write_sector(ata_device_t *dev, uint32_t lba,
-                                    uint8_t *buffer) {
-  spinlock_lock(&ata_lock);
-
-  // Copy the buffer over to the DMA area
-  memcpy(dev->dma_start, buffer, ATA_DMA_SIZE);
-
-  // Reset bus master register's command register
-  outportb(dev->bmr.command, 0);
-
-  // Set prdt
-  outportl(dev->bmr.prdt, dev->dma_prdt_phys);
-
-  // Enable error, irq status.
-  outportb(dev->bmr.status, inportb(dev->bmr.status) | 0x04 | 0x02);
-
-  // Select drive
-  ata_wait(dev, 0);
-  outportb(dev->io_reg.hddevsel,
-           0xe0 | dev->slave << 4 | (lba & 0x0f000000) >> 24);
-  ata_wait(dev, 0);
-
-  // Set sector counts and LBAs
-  outportb(dev->io_reg.feature, 0x00);
-  outportb(dev->io_reg.sector_count, 1);
-  outportb(dev->io_reg.lba_lo, (lba & 0x000000ff) >> 0);
-  outportb(dev->io_reg.lba_mid, (lba & 0x0000ff00) >> 8);
-  outportb(dev->io_reg.lba_hi, (lba & 0x00ff0000) >> 16);
-  ata_wait(dev, 0);
-
-  // Notify that we are starting DMA writing.
-  outportb(dev->io_reg.command, ata_dma_command_write);
-
-  // Start DMA Writing.
-  outportb(dev->bmr.command, 0x1);
-
-  // Wait for dma write to complete.
-  while (1) {
-    int status  = inportb(dev->bmr.status);
-    int dstatus = inportb(dev->io_reg.status);
-    if (!(status & 0x04)) {
-      continue;
+  prdt_t *last = NULL;
+  if (direct) {
+    // Describe the pages of each bio.
+    list_for_each(it, &req->bios) {
+      bio  = list_entry(it, bio_t, list);
+      last = ata_dma_prdt_add(dev, last, (uintptr_t)bio->buffer,
+                              bio->count * ATA_SECTOR_SIZE);
     }
-    if (!(dstatus & 0x80)) {
-      break;
+  } else {
+    // Copy the buffers over to the DMA area.
+    if (req->write) {
+      uint8_t *dma = dev->dma_start;
+      list_for_each(it, &req->bios) {
+        bio = list_entry(it, bio_t, list);
+        memcpy(dma, bio->buffer, bio->count * ATA_SECTOR_SIZE);
+        dma += bio->count * ATA_SECTOR_SIZE;
+      }
     }
+    last = ata_dma_prdt_add(dev, last, (uintptr_t)dev->dma_start,
+                            req->count * ATA_SECTOR_SIZE);
   }
-
-  // Inform device we are done.
-  outportb(dev->bmr.status, inportb(dev->bmr.status) | 0x04 | 0x02);
-
-  spinlock_unlock(&ata_lock);
+  // Set the EOT to 1.
+  last->end_of_table = 0x8000;
+
+  // Only one drive of the channel can transfer at a time.
+  ata_channel_acquire(dev);
+  dev->channel->request = req;
+  dev->channel->bounced = !direct;
+  if (ata_device_dma_start(dev, req->sector, req->count, req->write)) {
+    dprintf("[%s] The device is not ready (lba: %u, count: %u).\n",
+            ata_get_device_settings_str(dev), req->sector, req->count);
+    dev->channel->request = NULL;
+    dev->channel->active  = NULL;
+    ata_channel_wake(dev->channel);
+    return -ETIMEDOUT;
+  }
+  return BLOCK_QUEUED;
 }
 
 // == VFS ENTRY GENERATION ====================================================
@@ -626,8 +775,6 @@ static ssize_t ata_read(vfs_file_t *file, char *buffer, off_t offset,
                         size_t size) {
   dprintf("ata_read(file: 0x%p, buffer: 0x%p, offest: %8d, size: %8d)\n", file,
           buffer, offset, size);
-  // Prepare a static support buffer.
-  static char support_buffer[ATA_SECTOR_SIZE];
   // Get the device from the VFS file.
   ata_device_t *dev = (ata_device_t *)file->device;
   // Check the device.
@@ -636,52 +783,13 @@ static ssize_t ata_read(vfs_file_t *file, char *buffer, off_t offset,
   }
 
   if ((dev->type == ata_dev_type_pata) || (dev->type == ata_dev_type_sata)) {
-    uint32_t start_block  = offset / ATA_SECTOR_SIZE;
-    uint32_t start_offset = offset % ATA_SECTOR_SIZE;
-    uint32_t end_block    = (offset + size - 1) / ATA_SECTOR_SIZE;
-    uint32_t end_offset   = (offset + size - 1) % ATA_SECTOR_SIZE;
-    uint32_t prefix_size  = (ATA_SECTOR_SIZE - start_offset);
-    uint32_t postfix_size = (offset + size) % ATA_SECTOR_SIZE;
-    uint32_t max_offset   = ata_max_offset(dev);
-    uint32_t x_offset     = 0;
-
-    // Check if with the offset we are exceeding the size.
-    if (offset > max_offset) {
-      dprintf("The offset is exceeding the disk size (%d > %d)\n", offset,
-              max_offset);
-      return 0;
-    }
-
-    // Check if we are going to reading over the size.
-    if ((offset + size) > max_offset) {
-      size = max_offset - offset;
-    }
-
-    if (start_offset) {
-      ata_device_read_sector(dev, start_block, (uint8_t *)support_buffer);
-      memcpy(buffer, (void *)((uintptr_t)support_buffer + start_offset),
-             prefix_size);
-      x_offset += prefix_size;
-      ++start_block;
-    }
-
-    if (postfix_size && (start_block <= end_block)) {
-      ata_device_read_sector(dev, end_block, (uint8_t *)support_buffer);
-      memcpy((void *)((uintptr_t)buffer + size - postfix_size), support_buffer,
-             postfix_size);
-      --end_block;
-    }
-
-    while (start_block <= end_block) {
-      ata_device_read_sector(dev, start_block,
-                             (uint8_t *)((uintptr_t)buffer + x_offset));
-      x_offset += ATA_SECTOR_SIZE;
-      ++start_block;
-    }
-  } else if ((dev->type == ata_dev_type_patapi) ||
-             (dev->type == ata_dev_type_satapi)) {
+    // The block layer splits the range in sectors, and queues them.
+    return block_read(&dev->block, buffer, offset, size);
+  }
+  if ((dev->type == ata_dev_type_patapi) ||
+      (dev->type == ata_dev_type_satapi)) {
     dprintf("ATAPI and SATAPI drives are not currently supported.\n");
-    size = -EPERM;
+    return -EPERM;
   }
   return size;
 }
@@ -689,8 +797,6 @@ static ssize_t ata_read(vfs_file_t *file, char *buffer, off_t offset,
 static ssize_t ata_write(vfs_file_t *file, const void *buffer, off_t offset,
                          size_t size) {
   dprintf("ata_write(%p, %p, %d, %d)\n", file, buffer, offset, size);
-  // Prepare a static support buffer.
-  static char support_buffer[ATA_SECTOR_SIZE];
   // Get the device from the VFS file.
   ata_device_t *dev = (ata_device_t *)file->device;
   // Check the device.
@@ -699,51 +805,13 @@ static ssize_t ata_write(vfs_file_t *file, const void *buffer, off_t offset,
   }
 
   if ((dev->type == ata_dev_type_pata) || (dev->type == ata_dev_type_sata)) {
-    uint32_t start_block  = offset / ATA_SECTOR_SIZE;
-    uint32_t start_offset = offset % ATA_SECTOR_SIZE;
-    uint32_t end_block    = (offset + size - 1) / ATA_SECTOR_SIZE;
-    uint32_t end_offset   = (offset + size - 1) % ATA_SECTOR_SIZE;
-    uint32_t prefix_size  = (ATA_SECTOR_SIZE - start_offset);
-    uint32_t postfix_size = (offset + size) % ATA_SECTOR_SIZE;
-    uint32_t max_offset   = ata_max_offset(dev);
-    uint32_t x_offset     = 0;
-
-    // Check if with the offset we are exceeding the size.
-    if (offset > max_offset) {
-      return 0;
-    }
-
-    // Check if we are going to readoing over the size.
-    if (offset + size > max_offset) {
-      size = max_offset - offset;
-    }
-    if (start_offset) {
-      ata_device_read_sector(dev, start_block, (uint8_t *)support_buffer);
-      memcpy((void *)((uintptr_t)support_buffer + (start_offset)), buffer,
-             prefix_size);
-      ata_device_write_sector(dev, start_block, (uint8_t *)support_buffer);
-      x_offset += prefix_size;
-      ++start_block;
-    }
-
-    if (postfix_size && (start_block <= end_block)) {
-      ata_device_read_sector(dev, end_block, (uint8_t *)support_buffer);
-      memcpy(support_buffer, (void *)((uintptr_t)buffer + size - postfix_size),
-             postfix_size);
-      ata_device_write_sector(dev, end_block, (uint8_t *)support_buffer);
-      --end_block;
-    }
-
-    while (start_block <= end_block) {
-      ata_device_write_sector(dev, start_block,
-                              (uint8_t *)((uintptr_t)buffer + x_offset));
-      x_offset += ATA_SECTOR_SIZE;
-      ++start_block;
-    }
-  } else if ((dev->type == ata_dev_type_patapi) ||
-             (dev->type == ata_dev_type_satapi)) {
+    // The block layer splits the range in sectors, and queues them.
+    return block_write(&dev->block, buffer, offset, size);
+  }
+  if ((dev->type == ata_dev_type_patapi) ||
+      (dev->type == ata_dev_type_satapi)) {
     dprintf("ATAPI and SATAPI drives are not currently supported.\n");
-    size = -EPERM;
+    return -EPERM;
   }
   return size;
 }
@@ -830,12 +898,56 @@ static ata_device_type_t ata_device_detect(ata_device_t *dev) {
 }
 
 // == IRQ HANDLERS ============================================================
+/// @brief Completes the in-flight DMA transfer of the channel, if any.
+/// @param channel the channel.
+/// @return 1 if the IRQ was raised by the channel, 0 otherwise.
+static int ata_channel_complete(ata_channel_t *channel) {
+  ata_device_t *dev = channel->active;
+  if (!dev) {
+    return 0;
+  }
+  // Reading the status is required after every IRQ, the Bus Master status
+  // tells us if it was raised by this channel.
+  uint8_t bm_status = inportb(dev->bmr.status);
+  if (!(bm_status & 0x04)) {
+    return 0;
+  }
+  // Reading the status register also acknowledges the device IRQ.
+  uint8_t dev_status = inportb(dev->io_reg.status);
+  // Stop the bus master.
+  outportb(dev->bmr.command, inportb(dev->bmr.command) & ~0x01);
+  // Inform device we are done.
+  outportb(dev->bmr.status, bm_status | 0x04 | 0x02);
+
+  block_request_t *req = channel->request;
+  int status           = 0;
+  if ((bm_status & 0x02) || bit_check(dev_status, ata_status_err) ||
+      bit_check(dev_status, ata_status_df)) {
+    dprintf("[%s] DMA transfer failed (lba: %u, count: %u).\n",
+            ata_get_device_settings_str(dev), req->sector, req->count);
+    status = -EIO;
+  }
+  // Copy from DMA area to the buffers.
+  if (!status && channel->bounced && !req->write) {
+    uint8_t *dma = dev->dma_start;
+    list_for_each_decl(it, &req->bios) {
+      bio_t *bio = list_entry(it, bio_t, list);
+      memcpy(bio->buffer, dma, bio->count * ATA_SECTOR_SIZE);
+      dma += bio->count * ATA_SECTOR_SIZE;
+    }
+  }
+  // Release the channel, then complete the request.
+  channel->request = NULL;
+  channel->active  = NULL;
+  block_end_request(&dev->block, req, status);
+  // Wake up the tasks waiting for the channel.
+  ata_channel_wake(channel);
+  return 1;
+}
+
 /// @param f The interrupt stack frame.
 int32_t ata_irq_handler_master(pt_regs *f) {
-  dprintf("ata_irq_handler_master\n");
-  inportb(ata_primary_master.io_reg.status);
-  inportb(ata_primary_master.bmr.status);
-  //outportb(ata_primary_master.bmr.command, ata_bm_stop_bus_master);
+  ata_channel_complete(&ata_primary_channel);
   irq_ack(IRQ_FIRST_HD);
 
   return IRQ_STOP;
@@ -843,10 +955,7 @@ int32_t ata_irq_handler_master(pt_regs *f) {
 
 /// @param f The interrupt stack frame.
 int32_t ata_irq_handler_slave(pt_regs *f) {
-  dprintf("ata_irq_handler_slave\n");
-  inportb(ata_secondary_master.io_reg.status);
-  inportb(ata_primary_master.bmr.status);
-  //outportb(ata_primary_master.bmr.command, ata_bm_stop_bus_master);
+  ata_channel_complete(&ata_secondary_channel);
   irq_ack(IRQ_SECOND_HD);
 
   return IRQ_STOP;
@@ -862,8 +971,13 @@ static void pci_find_ata(uint32_t dev, uint16_t vid, uint16_t did,
 
 // == INITIALIZE/FINALIZE ATA =================================================
 int ata_init() {
-  // Initialize the spinlock.
-  spinlock_init(&ata_lock);
+  // Initialize the channels.
+  spinlock_init(&ata_primary_channel.lock);
+  spinlock_init(&ata_primary_channel.wait.lock);
+  list_head_init(&ata_primary_channel.wait.task_list);
+  spinlock_init(&ata_secondary_channel.lock);
+  spinlock_init(&ata_secondary_channel.wait.lock);
+  list_head_init(&ata_secondary_channel.wait.task_list);
 
   // Search for ATA devices.
   pci_scan(&pci_find_ata, -1, &ata_pci);
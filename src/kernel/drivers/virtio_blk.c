@@ -0,0 +1,538 @@
+/// Copyright (c) 2022-2025 Minh Hai Dao (barrydevp)
+
+#include <kernel/fs/virtio_blk.h>
+
+#include <arch/i386/irq.h>
+#include <arch/i386/pic.h>
+#include <arch/i386/pci.h>
+#include <arch/i386/ports.h>
+#include <kernel/system/panic.h>
+#include <kernel/system/syscall.h>
+#include <kernel/errno.h>
+#include <kernel/memory/mmu.h>
+#include <kernel/memory/vmm.h>
+#include <kernel/string.h>
+#include <kernel/fs/vfs.h>
+#include <kernel/stdio.h>
+#include <kernel/stdatomic.h>
+#include <kernel/bitops.h>
+#include <kernel/math.h>
+
+#include <kernel/printf.h>
+
+static char virtio_blk_drive_char = 'a';
+static unsigned virtio_blk_count  = 0;
+static uint32_t virtio_blk_pci[VIRTIO_BLK_MAX_DEVICES];
+static virtio_blk_device_t *virtio_blk_devices[VIRTIO_BLK_MAX_DEVICES];
+
+static int virtio_blk_submit(block_device_t *, block_request_t *);
+static void virtio_blk_commit(block_device_t *);
+static int32_t virtio_blk_irq_handler(pt_regs *f);
+static vfs_file_t *virtio_blk_device_create(virtio_blk_device_t *dev);
+
+// == SUPPORT FUNCTIONS =======================================================
+/// @brief Checks if the device can transfer data directly to/from the buffer.
+/// @param buffer the virtual address of the buffer.
+/// @param size the size of the transfer.
+/// @param write if we are writing to the device.
+/// @return true if the descriptors can point to the buffer, false if the
+/// transfer must go through the bounce buffer.
+static inline bool_t virtio_blk_can_map(uintptr_t buffer, size_t size,
+                                        bool_t write) {
+  // All the pages must be resident, and writable if the device writes them.
+  for (uintptr_t page = buffer & PAGE_MASK; page < buffer + size;
+       page += PAGE_SIZE) {
+    union PML *pte = vmm_get_page(page);
+    if (!pte || !pte->ptbits.present || (!write && !pte->ptbits.writable)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// @brief Chains the descriptors describing a virtually contiguous buffer,
+/// one for each page it spans.
+/// @param dev the device.
+/// @param index the last descriptor of the chain.
+/// @param end the first descriptor the chain cannot use.
+/// @param buffer the buffer.
+/// @param size the size of the buffer.
+/// @param flags the flags of the descriptors.
+/// @return the new last descriptor, or -1 if there are not enough.
+static int virtio_blk_chain(virtio_blk_device_t *dev, int index, int end,
+                            uintptr_t buffer, size_t size, uint16_t flags) {
+  while (size) {
+    uint32_t chunk = min(size, PAGE_SIZE - (buffer & PAGE_LOW_MASK));
+    if (index + 1 >= end) {
+      return -1;
+    }
+    dev->desc[index].flags |= VRING_DESC_F_NEXT;
+    dev->desc[index].next = index + 1;
+    ++index;
+    dev->desc[index].addr    = vmm_r_get_phy_addr(buffer);
+    dev->desc[index].addr_hi = 0;
+    dev->desc[index].len     = chunk;
+    dev->desc[index].flags   = flags;
+    buffer += chunk;
+    size -= chunk;
+  }
+  return index;
+}
+
+// == BLOCK LAYER =============================================================
+/// @brief Makes a request of the block layer available to the device, with
+/// the descriptors of a free slot. The device is notified by
+/// virtio_blk_commit, once per batch.
+/// @param bdev the block device.
+/// @param req the request, at most VIRTIO_BLK_MAX_SECTORS long.
+/// @return BLOCK_QUEUED, or a negative errno value.
+/// @details When possible the device accesses the buffers of the bios
+/// directly, otherwise the data goes through the bounce buffer of the slot.
+/// The request is completed by the IRQ handler.
+static int virtio_blk_submit(block_device_t *bdev, block_request_t *req) {
+  virtio_blk_device_t *dev = (virtio_blk_device_t *)bdev->data;
+  list_head *it;
+  bio_t *bio;
+
+  if (req->write && dev->read_only) {
+    return -EROFS;
+  }
+  // The block layer never has more requests in flight than slots.
+  unsigned slot = find_first_zero(dev->issued);
+  if ((slot >= dev->nslots) || bit_check(dev->issued, slot)) {
+    return -EBUSY;
+  }
+
+  // The chain is the header, the data, and the status, inside the
+  // descriptors of the slot.
+  int head = slot * dev->slot_descs;
+  int end  = head + dev->slot_descs - 1;
+  uint16_t data_flags = req->write ? 0 : VRING_DESC_F_WRITE;
+
+  virtio_blk_slot_t *mem = &dev->slots[slot];
+  uintptr_t mem_phys     = dev->slots_phys + slot * sizeof(virtio_blk_slot_t);
+  mem->hdr.type          = req->write ? virtio_blk_t_out : virtio_blk_t_in;
+  mem->hdr.ioprio        = 0;
+  mem->hdr.sector        = req->sector;
+  mem->hdr.sector_hi     = 0;
+  mem->status            = 0xFF;
+
+  dev->desc[head].addr    = mem_phys;
+  dev->desc[head].addr_hi = 0;
+  dev->desc[head].len     = sizeof(virtio_blk_outhdr_t);
+  dev->desc[head].flags   = 0;
+
+  int last = head;
+  list_for_each(it, &req->bios) {
+    bio = list_entry(it, bio_t, list);
+    if (!virtio_blk_can_map((uintptr_t)bio->buffer,
+                            bio->count * BLOCK_SECTOR_SIZE, req->write)) {
+      last = -1;
+      break;
+    }
+    last = virtio_blk_chain(dev, last, end, (uintptr_t)bio->buffer,
+                            bio->count * BLOCK_SECTOR_SIZE, data_flags);
+    if (last < 0) {
+      break;
+    }
+  }
+  if (last < 0) {
+    // Fall back to the bounce buffer of the slot.
+    if (!dev->bounce[slot]) {
+      dev->bounce[slot] = kmalloc_align(VIRTIO_BLK_BOUNCE_SIZE);
+      if (!dev->bounce[slot]) {
+        return -ENOMEM;
+      }
+    }
+    if (req->write) {
+      uint8_t *bounce = dev->bounce[slot];
+      list_for_each(it, &req->bios) {
+        bio = list_entry(it, bio_t, list);
+        memcpy(bounce, bio->buffer, bio->count * BLOCK_SECTOR_SIZE);
+        bounce += bio->count * BLOCK_SECTOR_SIZE;
+      }
+    }
+    dev->desc[head].flags = 0;
+    last = virtio_blk_chain(dev, head, end, (uintptr_t)dev->bounce[slot],
+                            req->count * BLOCK_SECTOR_SIZE, data_flags);
+    bit_set_assign(dev->bounced, slot);
+  }
+
+  // The status byte closes the chain.
+  dev->desc[last].flags |= VRING_DESC_F_NEXT;
+  dev->desc[last].next = last + 1;
+  ++last;
+  dev->desc[last].addr    = mem_phys + offsetof(virtio_blk_slot_t, status);
+  dev->desc[last].addr_hi = 0;
+  dev->desc[last].len     = 1;
+  dev->desc[last].flags   = VRING_DESC_F_WRITE;
+
+  dev->requests[slot] = req;
+  bit_set_assign(dev->issued, slot);
+
+  // Publish the chain, the descriptors must be visible before the index.
+  dev->avail->ring[dev->avail->idx % dev->size] = head;
+  barrier();
+  ++dev->avail->idx;
+  return BLOCK_QUEUED;
+}
+
+/// @brief Notifies the device of the chains made available, once per batch.
+/// @param bdev the block device.
+static void virtio_blk_commit(block_device_t *bdev) {
+  virtio_blk_device_t *dev = (virtio_blk_device_t *)bdev->data;
+  barrier();
+  // The device can tell us it is already processing the ring.
+  if (!(((volatile vring_used_t *)dev->used)->flags & VRING_USED_F_NO_NOTIFY)) {
+    outportw(dev->io_base + virtio_reg_queue_notify, 0);
+  }
+}
+
+/// @brief Completes the requests the device has returned.
+/// @param dev the device.
+static void virtio_blk_complete(virtio_blk_device_t *dev) {
+  volatile vring_used_t *used = dev->used;
+  while (dev->last_used != used->idx) {
+    barrier();
+    uint32_t head = used->ring[dev->last_used % dev->size].id;
+    ++dev->last_used;
+
+    unsigned slot        = head / dev->slot_descs;
+    block_request_t *req = dev->requests[slot];
+    int status           = dev->slots[slot].status ? -EIO : 0;
+    if (!req) {
+      continue;
+    }
+    if (status) {
+      dprintf("[%s] Request at sector %u failed (status %u).\n", dev->name,
+              req->sector, dev->slots[slot].status);
+    }
+    // Copy from the bounce buffer to the buffers.
+    if (bit_check(dev->bounced, slot) && !req->write && !status) {
+      uint8_t *bounce = dev->bounce[slot];
+      list_for_each_decl(it, &req->bios) {
+        bio_t *bio = list_entry(it, bio_t, list);
+        memcpy(bio->buffer, bounce, bio->count * BLOCK_SECTOR_SIZE);
+        bounce += bio->count * BLOCK_SECTOR_SIZE;
+      }
+    }
+    bit_clear_assign(dev->bounced, slot);
+    bit_clear_assign(dev->issued, slot);
+    dev->requests[slot] = NULL;
+    block_end_request(&dev->block, req, status);
+  }
+}
+
+// == VFS CALLBACKS ===========================================================
+static vfs_file_t *virtio_blk_open(const char *path, int flags, mode_t mode) {
+  dprintf("virtio_blk_open(%s, %d, %d)\n", path, flags, mode);
+  for (unsigned i = 0; i < virtio_blk_count; ++i) {
+    virtio_blk_device_t *dev = virtio_blk_devices[i];
+    if (dev && (strcmp(path, dev->path) == 0)) {
+      ++dev->fs_root->count;
+      return dev->fs_root;
+    }
+  }
+  return NULL;
+}
+
+static int virtio_blk_close(vfs_file_t *file) {
+  dprintf("virtio_blk_close(%p)\n", file);
+  if (file->device == NULL) {
+    kernel_panic("Device not set.");
+  }
+  --file->count;
+  return 0;
+}
+
+static ssize_t virtio_blk_read(vfs_file_t *file, char *buffer, off_t offset,
+                               size_t size) {
+  virtio_blk_device_t *dev = (virtio_blk_device_t *)file->device;
+  if (dev == NULL) {
+    kernel_panic("Device not set.");
+  }
+  return block_read(&dev->block, buffer, offset, size);
+}
+
+static ssize_t virtio_blk_write(vfs_file_t *file, const void *buffer,
+                                off_t offset, size_t size) {
+  virtio_blk_device_t *dev = (virtio_blk_device_t *)file->device;
+  if (dev == NULL) {
+    kernel_panic("Device not set.");
+  }
+  return block_write(&dev->block, buffer, offset, size);
+}
+
+static int _virtio_blk_stat(const virtio_blk_device_t *dev, stat_t *stat) {
+  if (dev && dev->fs_root) {
+    stat->st_dev   = 0;
+    stat->st_ino   = 0;
+    stat->st_mode  = 0060000 | (dev->read_only ? 0400 : 0600);
+    stat->st_uid   = 0;
+    stat->st_gid   = 0;
+    stat->st_atime = sys_time(NULL);
+    stat->st_mtime = stat->st_atime;
+    stat->st_ctime = stat->st_atime;
+    stat->st_size  = dev->fs_root->length;
+  }
+  return 0;
+}
+
+static int virtio_blk_fstat(vfs_file_t *file, stat_t *stat) {
+  return _virtio_blk_stat(file->device, stat);
+}
+
+static int virtio_blk_stat(const char *path, stat_t *stat) {
+  super_block_t *sb = vfs_get_superblock(path);
+  if (sb && sb->root) {
+    return _virtio_blk_stat(sb->root->device, stat);
+  }
+  return -1;
+}
+
+// == VFS ENTRY GENERATION ====================================================
+/// Filesystem general operations.
+static vfs_sys_operations_t virtio_blk_sys_operations = {
+  .stat_f = virtio_blk_stat,
+};
+
+/// virtio-blk filesystem file operations.
+static vfs_file_operations_t virtio_blk_fs_operations = {
+  .open_f  = virtio_blk_open,
+  .close_f = virtio_blk_close,
+  .read_f  = virtio_blk_read,
+  .write_f = virtio_blk_write,
+  .stat_f  = virtio_blk_fstat,
+};
+
+static vfs_file_t *virtio_blk_device_create(virtio_blk_device_t *dev) {
+  vfs_file_t *file = kmalloc(sizeof(vfs_file_t));
+  if (file == NULL) {
+    dprintf("Failed to create virtio-blk device.\n");
+    return NULL;
+  }
+  memset(file, 0, sizeof(vfs_file_t));
+  memcpy(file->name, dev->name, NAME_MAX);
+  file->device         = dev;
+  file->flags          = DT_BLK;
+  file->mask           = dev->read_only ? 0400 : 0600;
+  file->sys_operations = &virtio_blk_sys_operations;
+  file->fs_operations  = &virtio_blk_fs_operations;
+  return file;
+}
+
+// == DEVICE MANAGEMENT =======================================================
+/// @brief Sets up the request virtqueue of the device.
+/// @param dev the device.
+/// @return 0 on success, 1 on error.
+static int virtio_blk_setup_queue(virtio_blk_device_t *dev) {
+  outportw(dev->io_base + virtio_reg_queue_select, 0);
+  dev->size = inportw(dev->io_base + virtio_reg_queue_size);
+  if (dev->size < 4) {
+    dprintf("[%s] The request queue is missing.\n", dev->name);
+    return 1;
+  }
+  // The legacy layout is fixed: the descriptors, the available ring, and the
+  // used ring at the next page, all physically contiguous.
+  uint32_t avail_offset = dev->size * sizeof(vring_desc_t);
+  uint32_t used_offset  = __ALIGN_UP(
+    avail_offset + sizeof(vring_avail_t) + (dev->size + 1) * sizeof(uint16_t),
+    PAGE_SIZE);
+  uint32_t ring_size = used_offset + sizeof(vring_used_t) +
+                       dev->size * sizeof(vring_used_elem_t) +
+                       sizeof(uint16_t);
+  uintptr_t ring_phys;
+  uint8_t *ring = vmm_alloc_dma(ring_size, &ring_phys);
+  if (!ring) {
+    return 1;
+  }
+  memset(ring, 0, __ALIGN_UP(ring_size, PAGE_SIZE));
+  dev->desc      = (vring_desc_t *)ring;
+  dev->avail     = (vring_avail_t *)(ring + avail_offset);
+  dev->used      = (vring_used_t *)(ring + used_offset);
+  dev->last_used = 0;
+
+  // Split the descriptors between the slots, each slot needs the header, the
+  // status, and at least one page of data.
+  dev->nslots     = min(VIRTIO_BLK_QUEUE_DEPTH, dev->size / 3);
+  dev->slot_descs = dev->size / dev->nslots;
+  dev->slots      = (virtio_blk_slot_t *)kmalloc_align(PAGE_SIZE);
+  if (!dev->slots) {
+    return 1;
+  }
+  dev->slots_phys = vmm_r_get_phy_addr((uintptr_t)dev->slots);
+
+  outportl(dev->io_base + virtio_reg_queue_address, ring_phys / PAGE_SIZE);
+  return 0;
+}
+
+/// @brief Initializes a virtio-blk device.
+/// @param pci the PCI device.
+/// @return 0 on success, 1 on error.
+static int virtio_blk_device_init(uint32_t pci) {
+  virtio_blk_device_t *dev = kmalloc(sizeof(virtio_blk_device_t));
+  if (!dev) {
+    dprintf("Failed to allocate the virtio-blk device.\n");
+    return 1;
+  }
+  memset(dev, 0, sizeof(virtio_blk_device_t));
+  dev->pci = pci;
+  sprintf(dev->name, "vd%c", virtio_blk_drive_char);
+  sprintf(dev->path, "/dev/vd%c", virtio_blk_drive_char);
+
+  // Enable I/O space accesses and bus mastering.
+  uint32_t pci_cmd = pci_read_field(pci, PCI_COMMAND, 4);
+  bit_set_assign(pci_cmd, pci_command_io_space);
+  bit_set_assign(pci_cmd, pci_command_bus_master);
+  pci_write_field(pci, PCI_COMMAND, 4, pci_cmd);
+  dev->io_base = pci_read_field(pci, PCI_BASE_ADDRESS_0, 4) & ~0x3U;
+
+  // Reset the device, and tell it we found it and we can drive it.
+  outportb(dev->io_base + virtio_reg_device_status, 0);
+  outportb(dev->io_base + virtio_reg_device_status,
+           virtio_status_acknowledge);
+  outportb(dev->io_base + virtio_reg_device_status,
+           virtio_status_acknowledge | virtio_status_driver);
+
+  // Accept only the features we use.
+  uint32_t features = inportl(dev->io_base + virtio_reg_device_features);
+  features &= (1U << virtio_blk_f_seg_max) | (1U << virtio_blk_f_ro);
+  outportl(dev->io_base + virtio_reg_guest_features, features);
+  dev->read_only = bit_check(features, virtio_blk_f_ro) != 0;
+
+  if (virtio_blk_setup_queue(dev)) {
+    outportb(dev->io_base + virtio_reg_device_status, virtio_status_failed);
+    return 1;
+  }
+
+  // A request carries at most the data descriptors of its slot, which the
+  // bounce buffer must fit in, one page each.
+  uint32_t segments = dev->slot_descs - 2;
+  if (bit_check(features, virtio_blk_f_seg_max)) {
+    uint32_t seg_max =
+      inportl(dev->io_base + virtio_reg_config + virtio_blk_config_seg_max);
+    if (seg_max) {
+      segments = min(segments, seg_max);
+      dev->slot_descs = segments + 2;
+    }
+  }
+
+  // The VFS lengths are 32 bit, larger drives are truncated.
+  uint32_t capacity =
+    inportl(dev->io_base + virtio_reg_config + virtio_blk_config_capacity);
+  if (inportl(dev->io_base + virtio_reg_config + virtio_blk_config_capacity +
+              4)) {
+    capacity = 0xFFFFFFFFU;
+  }
+
+  // Create the filesystem entry for the drive.
+  dev->fs_root = virtio_blk_device_create(dev);
+  if (!dev->fs_root) {
+    dprintf("Failed to create virtio-blk device!\n");
+    return 1;
+  }
+  dev->fs_root->length =
+    min(capacity, 0xFFFFFFFFU / BLOCK_SECTOR_SIZE) * BLOCK_SECTOR_SIZE;
+  // Try to mount the drive.
+  if (!vfs_mount(dev->path, dev->fs_root)) {
+    dprintf("Failed to mount virtio-blk device!\n");
+    return 1;
+  }
+
+  // Register the block device, with one request in flight per slot.
+  strcpy(dev->block.name, dev->name);
+  dev->block.sector_count = dev->fs_root->length / BLOCK_SECTOR_SIZE;
+  dev->block.max_sectors =
+    min(VIRTIO_BLK_MAX_SECTORS, segments * (PAGE_SIZE / BLOCK_SECTOR_SIZE));
+  dev->block.queue_depth = dev->nslots;
+  dev->block.submit      = virtio_blk_submit;
+  dev->block.commit      = virtio_blk_commit;
+  dev->block.data        = dev;
+  dev->block.file        = dev->fs_root;
+  if (block_register(&dev->block) < 0) {
+    return 1;
+  }
+
+  // Install the IRQ handler, once per line.
+  dev->irq = pci_get_interrupt(pci);
+  bool_t installed = false;
+  for (unsigned i = 0; i < virtio_blk_count; ++i) {
+    if (virtio_blk_devices[i] && (virtio_blk_devices[i]->irq == dev->irq)) {
+      installed = true;
+    }
+  }
+  virtio_blk_devices[virtio_blk_count++] = dev;
+  if (!installed) {
+    irq_install_handler(dev->irq, virtio_blk_irq_handler);
+    pic_clear_mask(dev->irq);
+  }
+
+  // The driver is ready.
+  outportb(dev->io_base + virtio_reg_device_status,
+           virtio_status_acknowledge | virtio_status_driver |
+             virtio_status_driver_ok);
+  ++virtio_blk_drive_char;
+
+  dprintf("Device name     : %s\n", dev->name);
+  dprintf("Sectors         : %u%s\n", dev->block.sector_count,
+          dev->read_only ? " (read-only)" : "");
+  dprintf("Queue size      : %u (%u slots of %u descriptors)\n", dev->size,
+          dev->nslots, dev->slot_descs);
+  return 0;
+}
+
+// == IRQ HANDLERS ============================================================
+/// @param f The interrupt stack frame.
+static int32_t virtio_blk_irq_handler(pt_regs *f) {
+  int irq        = f->int_no - 32;
+  bool_t handled = false;
+  for (unsigned i = 0; i < virtio_blk_count; ++i) {
+    virtio_blk_device_t *dev = virtio_blk_devices[i];
+    if (dev->irq != irq) {
+      continue;
+    }
+    // Reading the ISR status acknowledges the interrupt, bit 0 tells us
+    // the used ring was updated.
+    if (inportb(dev->io_base + virtio_reg_isr_status) & 0x01) {
+      virtio_blk_complete(dev);
+      handled = true;
+    }
+  }
+  if (!handled) {
+    // The line is shared, and it was not us.
+    return IRQ_CONTINUE;
+  }
+  irq_ack(irq);
+  return IRQ_STOP;
+}
+
+// == PCI FUNCTIONS ===========================================================
+static void pci_find_virtio_blk(uint32_t dev, uint16_t vid, uint16_t did,
+                                void *extra) {
+  unsigned *count = (unsigned *)extra;
+  if ((vid == VIRTIO_VENDOR_ID) && (did == VIRTIO_BLK_DEVICE_ID) &&
+      (*count < VIRTIO_BLK_MAX_DEVICES)) {
+    virtio_blk_pci[(*count)++] = dev;
+  }
+}
+
+// == INITIALIZE/FINALIZE VIRTIO-BLK ==========================================
+int virtio_blk_init() {
+  unsigned found = 0;
+  pci_scan(&pci_find_virtio_blk, -1, &found);
+  if (!found) {
+    dprintf("No virtio-blk device found.\n");
+    return 1;
+  }
+  for (unsigned i = 0; i < found; ++i) {
+    if (virtio_blk_device_init(virtio_blk_pci[i])) {
+      dprintf("Failed to initialize virtio-blk device 0x%x!\n",
+              virtio_blk_pci[i]);
+    }
+  }
+  return virtio_blk_count ? 0 : 1;
+}
+
+int virtio_blk_finalize() {
+  return 0;
+}
@@ -0,0 +1,487 @@
+/// Copyright (c) 2022-2025 Minh Hai Dao (barrydevp)
+
+#include <kernel/fs/block.h>
+#include <kernel/arch.h>
+#include <kernel/errno.h>
+#include <kernel/kernel.h>
+#include <kernel/math.h>
+#include <kernel/memory/mmu.h>
+#include <kernel/string.h>
+#include <kernel/stdio.h>
+#include <arch/i386/timer.h>
+
+#include <kernel/printf.h>
+
+/// The list of registered block devices.
+static list_head block_devices = { &block_devices, &block_devices };
+
+int block_register(block_device_t *dev) {
+  if (!dev->submit || !dev->max_sectors) {
+    return -EINVAL;
+  }
+  list_head_init(&dev->queue);
+  dev->head     = 0;
+  dev->plugged  = 0;
+  dev->inflight = 0;
+  memset(&dev->stats, 0, sizeof(block_stats_t));
+  spinlock_init(&dev->lock);
+  list_head_insert_before(&dev->list, &block_devices);
+  dprintf("block: registered %s (%u sectors, %u per request)\n", dev->name,
+          dev->sector_count, dev->max_sectors);
+  return 0;
+}
+
+block_device_t *block_get_device(vfs_file_t *file) {
+  list_for_each_decl(it, &block_devices) {
+    block_device_t *dev = list_entry(it, block_device_t, list);
+    if (dev->file == file) {
+      return dev;
+    }
+  }
+  return NULL;
+}
+
+void bio_init(bio_t *bio, uint32_t sector, uint32_t count, char *buffer,
+              bool_t write) {
+  bio->sector  = sector;
+  bio->count   = count;
+  bio->buffer  = buffer;
+  bio->write   = write;
+  bio->status  = 0;
+  bio->end_io  = NULL;
+  bio->private = NULL;
+  list_head_init(&bio->list);
+}
+
+// == STATISTICS ==============================================================
+
+/// @brief Converts timer ticks to microseconds.
+/// @param ticks the ticks.
+/// @return the microseconds.
+static inline unsigned long __block_ticks_to_us(unsigned long ticks) {
+  return ticks * (1000000UL / TICKS_PER_SECOND);
+}
+
+/// @brief Accounts an interval inside a log2 histogram.
+/// @param hist the histogram.
+/// @param ticks the length of the interval, in timer ticks.
+static inline void __block_hist_add(unsigned long *hist, unsigned long ticks) {
+  unsigned long us = __block_ticks_to_us(ticks);
+  unsigned bucket  = 0;
+  while ((us >>= 1) && (bucket < BLOCK_HIST_BUCKETS - 1)) {
+    ++bucket;
+  }
+  ++hist[bucket];
+}
+
+// == QUEUE MANAGEMENT ========================================================
+
+/// @brief Moves all the bios of `from` at the end of `to`, and frees `from`.
+/// @param to the request which absorbs the other one.
+/// @param from the request following `to`.
+static inline void __block_request_absorb(block_request_t *to,
+                                          block_request_t *from) {
+  list_head *it;
+  while ((it = list_head_pop(&from->bios))) {
+    list_head_insert_before(it, &to->bios);
+  }
+  to->count += from->count;
+  // The merged request waited since the oldest of the two.
+  if ((long)(from->queued - to->queued) < 0) {
+    to->queued = from->queued;
+  }
+  list_head_remove(&from->list);
+  kfree(from);
+}
+
+/// @brief Tries to merge the bio inside a queued request.
+/// @param dev the device.
+/// @param bio the bio.
+/// @return 1 if the bio has been merged, 0 otherwise.
+static int __block_try_merge(block_device_t *dev, bio_t *bio) {
+  list_for_each_decl(it, &dev->queue) {
+    block_request_t *req = list_entry(it, block_request_t, list);
+    if ((req->write != bio->write) ||
+        (req->count + bio->count > dev->max_sectors)) {
+      continue;
+    }
+    // Back merge, the bio follows the request.
+    if (req->sector + req->count == bio->sector) {
+      list_head_insert_before(&bio->list, &req->bios);
+      req->count += bio->count;
+      ++dev->stats.merges[req->write];
+      // The request may now touch the next one.
+      if (req->list.next != &dev->queue) {
+        block_request_t *next =
+          list_entry(req->list.next, block_request_t, list);
+        if ((next->write == req->write) &&
+            (req->sector + req->count == next->sector) &&
+            (req->count + next->count <= dev->max_sectors)) {
+          __block_request_absorb(req, next);
+        }
+      }
+      return 1;
+    }
+    // Front merge, the bio precedes the request.
+    if (bio->sector + bio->count == req->sector) {
+      list_head_insert_after(&bio->list, &req->bios);
+      req->sector = bio->sector;
+      req->count += bio->count;
+      ++dev->stats.merges[req->write];
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/// @brief Inserts a new request for the bio, keeping the queue sorted.
+/// @param dev the device.
+/// @param bio the bio.
+/// @return 0 on success, -ENOMEM on failure.
+static int __block_queue_request(block_device_t *dev, bio_t *bio) {
+  block_request_t *req = kmalloc(sizeof(block_request_t));
+  if (!req) {
+    return -ENOMEM;
+  }
+  req->sector = bio->sector;
+  req->count  = bio->count;
+  req->write  = bio->write;
+  req->queued = timer_get_ticks();
+  list_head_init(&req->bios);
+  list_head_insert_before(&bio->list, &req->bios);
+  // Find the first request which comes after the new one.
+  list_head *it;
+  list_for_each(it, &dev->queue) {
+    if (list_entry(it, block_request_t, list)->sector > req->sector) {
+      break;
+    }
+  }
+  list_head_insert_before(&req->list, it);
+  return 0;
+}
+
+void block_end_request(block_device_t *dev, block_request_t *req, int status) {
+  unsigned long service = timer_get_ticks() - req->dispatched;
+  block_stats_t *stats  = &dev->stats;
+  --dev->inflight;
+  if (status < 0) {
+    ++stats->errors[req->write];
+  } else {
+    ++stats->ops[req->write];
+    stats->sectors[req->write] += req->count;
+  }
+  stats->service_ticks[req->write] += service;
+  __block_hist_add(stats->service_hist, service);
+  list_head *it;
+  while ((it = list_head_pop(&req->bios))) {
+    bio_t *bio  = list_entry(it, bio_t, list);
+    bio->status = status;
+    if (bio->end_io) {
+      bio->end_io(bio);
+    }
+  }
+  kfree(req);
+}
+
+/// @brief Picks the next request with a C-LOOK elevator: requests are
+/// served in ascending sector order starting from the head, when there are
+/// no more requests after the head it goes back to the lowest sector.
+/// @param dev the device.
+/// @return the next request, or NULL if the queue is empty.
+static block_request_t *__block_elevator_next(block_device_t *dev) {
+  if (list_head_empty(&dev->queue)) {
+    return NULL;
+  }
+  list_for_each_decl(it, &dev->queue) {
+    block_request_t *req = list_entry(it, block_request_t, list);
+    if (req->sector >= dev->head) {
+      return req;
+    }
+  }
+  return list_entry(dev->queue.next, block_request_t, list);
+}
+
+void block_submit_bio(block_device_t *dev, bio_t *bio) {
+  int ret = 0;
+  if ((bio->count == 0) || (bio->sector + bio->count > dev->sector_count)) {
+    ret = -EIO;
+  } else {
+    spinlock_lock(&dev->lock);
+    if (!__block_try_merge(dev, bio)) {
+      ret = __block_queue_request(dev, bio);
+    }
+    spinlock_unlock(&dev->lock);
+  }
+  if (ret < 0) {
+    bio->status = ret;
+    if (bio->end_io) {
+      bio->end_io(bio);
+    }
+    return;
+  }
+  if (!dev->plugged) {
+    block_run_queue(dev);
+  }
+}
+
+void block_plug(block_device_t *dev) {
+  ++dev->plugged;
+}
+
+void block_unplug(block_device_t *dev) {
+  if (dev->plugged && (--dev->plugged == 0)) {
+    block_run_queue(dev);
+  }
+}
+
+void block_run_queue(block_device_t *dev) {
+  unsigned depth = dev->queue_depth ? dev->queue_depth : 1;
+  block_request_t *req;
+  unsigned submitted = 0;
+  int ret;
+  while (1) {
+    spinlock_lock(&dev->lock);
+    req = (dev->inflight < depth) ? __block_elevator_next(dev) : NULL;
+    if (req) {
+      list_head_remove(&req->list);
+      dev->head       = req->sector + req->count;
+      req->dispatched = timer_get_ticks();
+      dev->stats.queue_ticks[req->write] += req->dispatched - req->queued;
+      __block_hist_add(dev->stats.queue_hist, req->dispatched - req->queued);
+      ++dev->inflight;
+    }
+    spinlock_unlock(&dev->lock);
+    if (!req) {
+      break;
+    }
+    ret = dev->submit(dev, req);
+    // Synchronous drivers are done with the request.
+    if (ret != BLOCK_QUEUED) {
+      block_end_request(dev, req, ret);
+    } else {
+      ++submitted;
+    }
+  }
+  if (submitted && dev->commit) {
+    dev->commit(dev);
+  }
+}
+
+/// @brief Prints a histogram, up to its last non-empty bucket.
+/// @param buffer the buffer where the text is written.
+/// @param label the name of the histogram.
+/// @param hist the histogram.
+/// @return the length of the text.
+static size_t __block_print_hist(char *buffer, const char *label,
+                                 const unsigned long *hist) {
+  int last = BLOCK_HIST_BUCKETS - 1;
+  while ((last >= 0) && !hist[last]) {
+    --last;
+  }
+  size_t len = sprintf(buffer, "  %-7s", label);
+  for (int i = 0; i <= last; ++i) {
+    len += sprintf(buffer + len, " %lu", hist[i]);
+  }
+  buffer[len++] = '\n';
+  buffer[len]   = 0;
+  return len;
+}
+
+size_t block_print_stats(char *buffer, size_t bufsize) {
+  size_t len = 0;
+  buffer[0]  = 0;
+  list_for_each_decl(it, &block_devices) {
+    block_device_t *dev  = list_entry(it, block_device_t, list);
+    block_stats_t *stats = &dev->stats;
+    if (len + BLOCK_STATS_DEVICE_MAX >= bufsize) {
+      break;
+    }
+    // name, then for reads and writes: ops merges sectors errors, and the
+    // microseconds spent in queue and in service, then the requests in flight.
+    len += sprintf(buffer + len, "%-6s %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %u\n",
+                   dev->name, stats->ops[0], stats->merges[0],
+                   stats->sectors[0], stats->errors[0],
+                   __block_ticks_to_us(stats->queue_ticks[0]),
+                   __block_ticks_to_us(stats->service_ticks[0]),
+                   stats->ops[1], stats->merges[1], stats->sectors[1],
+                   stats->errors[1],
+                   __block_ticks_to_us(stats->queue_ticks[1]),
+                   __block_ticks_to_us(stats->service_ticks[1]),
+                   dev->inflight);
+    len += __block_print_hist(buffer + len, "queue", stats->queue_hist);
+    len += __block_print_hist(buffer + len, "service", stats->service_hist);
+  }
+  return len;
+}
+
+size_t block_stats_size(void) {
+  return list_head_size(&block_devices) * BLOCK_STATS_DEVICE_MAX + 1;
+}
+
+// == BATCHES =================================================================
+
+/// @brief Completion function of the bios belonging to a batch.
+/// @param bio the bio.
+static void __block_batch_end_io(bio_t *bio) {
+  block_batch_t *batch = (block_batch_t *)bio->private;
+  if ((bio->status < 0) && !batch->status) {
+    batch->status = bio->status;
+  }
+  --batch->pending;
+}
+
+void block_batch_init(block_batch_t *batch) {
+  batch->pending = 0;
+  batch->status  = 0;
+}
+
+void block_batch_add(block_batch_t *batch, bio_t *bio) {
+  bio->end_io  = __block_batch_end_io;
+  bio->private = batch;
+  ++batch->pending;
+}
+
+int block_batch_wait(block_device_t *dev, block_batch_t *batch) {
+  // Run the queue even if somebody is holding it plugged, and keep feeding
+  // the driver as the requests in flight complete.
+  while (batch->pending) {
+    block_run_queue(dev);
+    // Checking with interrupts disabled, and then halting with `sti; hlt`,
+    // cannot miss the completion IRQ.
+    if (batch->pending && dev->inflight) {
+      arch_pause();
+    } else if (batch->pending) {
+      dprintf("block: %s: %u bios did not complete.\n", dev->name,
+              batch->pending);
+      return -EIO;
+    }
+  }
+  return batch->status;
+}
+
+// == BYTE ORIENTED ACCESS ====================================================
+
+/// @brief Transfers a byte range, as a single batch of bios.
+/// @param dev the device.
+/// @param buffer the buffer.
+/// @param offset the offset, in bytes.
+/// @param size the size, in bytes.
+/// @param write if the data goes to the device.
+/// @return the amount transferred, or a negative errno value.
+static ssize_t __block_transfer(block_device_t *dev, char *buffer,
+                                off_t offset, size_t size, bool_t write) {
+  uint64_t dev_size = (uint64_t)dev->sector_count * BLOCK_SECTOR_SIZE;
+  if ((offset < 0) || ((uint64_t)offset >= dev_size)) {
+    return 0;
+  }
+  size = min(size, dev_size - offset);
+  if (size == 0) {
+    return 0;
+  }
+
+  uint32_t first     = offset / BLOCK_SECTOR_SIZE;
+  uint32_t last      = (offset + size - 1) / BLOCK_SECTOR_SIZE;
+  uint32_t head_skip = offset % BLOCK_SECTOR_SIZE;
+  uint32_t tail_size = (offset + size) % BLOCK_SECTOR_SIZE;
+  // Partial sectors at the edges go through a support buffer.
+  bool_t head_partial = head_skip || ((first == last) && tail_size);
+  bool_t tail_partial = (last != first) && tail_size;
+  uint32_t whole_first = first + head_partial;
+  uint32_t whole_count = last + 1 - whole_first - tail_partial;
+  uint32_t nbios       = head_partial + tail_partial +
+                   (whole_count + dev->max_sectors - 1) / dev->max_sectors;
+
+  block_batch_t batch;
+  int ret;
+
+  bio_t *bios = kmalloc(sizeof(bio_t) * nbios);
+  char *support =
+    (head_partial || tail_partial) ? kmalloc(2 * BLOCK_SECTOR_SIZE) : NULL;
+  if (!bios || ((head_partial || tail_partial) && !support)) {
+    ret = -ENOMEM;
+    goto free_return;
+  }
+  char *head_buffer = support;
+  char *tail_buffer = support + BLOCK_SECTOR_SIZE;
+
+  // Read the partial sectors, we need them before writing back.
+  if (write && (head_partial || tail_partial)) {
+    block_batch_init(&batch);
+    block_plug(dev);
+    if (head_partial) {
+      bio_init(&bios[0], first, 1, head_buffer, false);
+      block_batch_add(&batch, &bios[0]);
+      block_submit_bio(dev, &bios[0]);
+    }
+    if (tail_partial) {
+      bio_init(&bios[1], last, 1, tail_buffer, false);
+      block_batch_add(&batch, &bios[1]);
+      block_submit_bio(dev, &bios[1]);
+    }
+    block_unplug(dev);
+    if ((ret = block_batch_wait(dev, &batch)) < 0) {
+      goto free_return;
+    }
+  }
+
+  size_t head_size = head_partial ? min(BLOCK_SECTOR_SIZE - head_skip, size) : 0;
+  if (write) {
+    if (head_partial)
+      memcpy(head_buffer + head_skip, buffer, head_size);
+    if (tail_partial)
+      memcpy(tail_buffer, buffer + size - tail_size, tail_size);
+  }
+
+  // Submit everything at once, so that adjacent bios are merged.
+  block_batch_init(&batch);
+  block_plug(dev);
+  unsigned n = 0;
+  if (head_partial) {
+    bio_init(&bios[n], first, 1, head_buffer, write);
+    block_batch_add(&batch, &bios[n]);
+    block_submit_bio(dev, &bios[n++]);
+  }
+  char *whole = buffer + head_size;
+  for (uint32_t done = 0, count; done < whole_count; done += count) {
+    count = min(whole_count - done, dev->max_sectors);
+    bio_init(&bios[n], whole_first + done, count,
+             whole + done * BLOCK_SECTOR_SIZE, write);
+    block_batch_add(&batch, &bios[n]);
+    block_submit_bio(dev, &bios[n++]);
+  }
+  if (tail_partial) {
+    bio_init(&bios[n], last, 1, tail_buffer, write);
+    block_batch_add(&batch, &bios[n]);
+    block_submit_bio(dev, &bios[n++]);
+  }
+  block_unplug(dev);
+  if ((ret = block_batch_wait(dev, &batch)) < 0) {
+    goto free_return;
+  }
+
+  if (!write) {
+    if (head_partial)
+      memcpy(buffer, head_buffer + head_skip, head_size);
+    if (tail_partial)
+      memcpy(buffer + size - tail_size, tail_buffer, tail_size);
+  }
+  ret = size;
+
+free_return:
+  if (bios)
+    kfree(bios);
+  if (support)
+    kfree(support);
+  return ret;
+}
+
+ssize_t block_read(block_device_t *dev, char *buffer, off_t offset,
+                   size_t size) {
+  return __block_transfer(dev, buffer, offset, size, false);
+}
+
+ssize_t block_write(block_device_t *dev, const char *buffer, off_t offset,
+                    size_t size) {
+  // The buffer is only read, when writing.
+  return __block_transfer(dev, (char *)buffer, offset, size, true);
+}
@@ -34,15 +34,16 @@ static struct vfs_sys_operations_t ext2_sys_operations = {
 
 /// Filesystem file operations.
 static struct vfs_file_operations_t ext2_fs_operations = {
-  .open_f     = ext2_open,
-  .unlink_f   = ext2_unlink,
-  .close_f    = ext2_close,
-  .read_f     = ext2_read,
-  .write_f    = ext2_write,
-  .lseek_f    = ext2_lseek,
-  .stat_f     = ext2_fstat,
-  .ioctl_f    = ext2_ioctl,
-  .getdents_f = ext2_getdents
+  .open_f         = ext2_open,
+  .unlink_f       = ext2_unlink,
+  .close_f        = ext2_close,
+  .read_f         = ext2_read,
+  .write_f        = ext2_write,
+  .lseek_f        = ext2_lseek,
+  .stat_f         = ext2_fstat,
+  .ioctl_f        = ext2_ioctl,
+  .getdents_f     = ext2_getdents,
+  .getdentsplus_f = ext2_getdentsplus
 };
 
 // ============================================================================
@@ -1122,6 +1123,35 @@ static ssize_t ext2_read_inode_block(ext2_filesystem_t *fs, ext2_inode_t *inode,
   return ext2_read_block(fs, real_index, buffer);
 }
 
+/// @brief Queues the read of the real block starting from an inode and the
+/// block index inside the inode, the read completes when the batch does.
+/// @param fs the filesystem, it must have a block layer device.
+/// @param inode the inode which we are working with.
+/// @param block_index the index of the block within the inode.
+/// @param buffer the buffer where to put the data.
+/// @param bio the bio used for the read.
+/// @param batch the batch the bio is added to.
+/// @return 0 on success, -1 on failure.
+static int ext2_submit_inode_block_read(ext2_filesystem_t *fs,
+                                        ext2_inode_t *inode,
+                                        uint32_t block_index, uint8_t *buffer,
+                                        bio_t *bio, block_batch_t *batch) {
+  if (block_index >= (inode->blocks_count / fs->blocks_per_block_count))
+    return -1;
+  // Get the real index.
+  uint32_t real_index = ext2_get_real_block_index(fs, inode, block_index);
+  if (real_index == 0)
+    return -1;
+  // Log the address to the inode block.
+  dprintf("Queue inode block (block:%4u real:%4u)\n", block_index, real_index);
+  // Queue the read of the block.
+  uint32_t sectors = fs->block_size / BLOCK_SECTOR_SIZE;
+  bio_init(bio, real_index * sectors, sectors, (char *)buffer, false);
+  block_batch_add(batch, bio);
+  block_submit_bio(fs->block, bio);
+  return 0;
+}
+
 /// @brief Writes the real block starting from an inode and the block index inside the inode.
 /// @param fs the filesystem.
 /// @param inode the inode which we are working with.
@@ -1195,12 +1225,38 @@ static ssize_t ext2_read_inode_data(ext2_filesystem_t *fs, ext2_inode_t *inode,
   } else {
     uint32_t block_offset;
     uint32_t blocks_read = 0;
+    // Whole blocks are read straight into the buffer as a single batch, so
+    // that the block layer can merge the adjacent ones.
+    bio_t *bios = NULL;
+    unsigned nbios = 0;
+    block_batch_t batch;
+    int failed = 0;
+    if (fs->block) {
+      bios = kmalloc(sizeof(bio_t) * (end_block - start_block));
+      block_batch_init(&batch);
+      block_plug(fs->block);
+    }
     for (block_offset = start_block; block_offset < end_block;
          block_offset++, blocks_read++) {
+      if (bios && ((block_offset != start_block) ||
+                   ((offset % fs->block_size) == 0))) {
+        // Queue the read of the block, into its place in the buffer.
+        if (ext2_submit_inode_block_read(
+              fs, inode, block_offset,
+              (uint8_t *)buffer + fs->block_size * blocks_read -
+                (offset % fs->block_size),
+              &bios[nbios++], &batch) == -1) {
+          dprintf("Failed to read the inode block `%d`\n", block_offset);
+          failed = 1;
+          break;
+        }
+        continue;
+      }
       // Read the real block.
       if (ext2_read_inode_block(fs, inode, block_offset, cache) == -1) {
         dprintf("Failed to read the inode block `%d`\n", block_offset);
-        goto free_cache_return_error;
+        failed = 1;
+        break;
       }
       // Copy the content back to the buffer.
       if (block_offset == start_block) {
@@ -1214,6 +1270,19 @@ static ssize_t ext2_read_inode_data(ext2_filesystem_t *fs, ext2_inode_t *inode,
                cache, fs->block_size);
       }
     }
+    if (fs->block) {
+      // Send the queued reads, and wait for them.
+      block_unplug(fs->block);
+      if (block_batch_wait(fs->block, &batch) < 0) {
+        failed = 1;
+      }
+      if (bios) {
+        kfree(bios);
+      }
+    }
+    if (failed) {
+      goto free_cache_return_error;
+    }
     if (end_size) {
       // Read the real block.
       if (ext2_read_inode_block(fs, inode, end_block, cache) == -1) {
@@ -1376,6 +1445,40 @@ ext2_direntry_iterator_t ext2_direntry_iterator_begin(ext2_filesystem_t *fs,
   return it;
 }
 
+/// @brief Initializes the iterator at the given position inside the directory.
+/// @param fs pointer to the filesystem.
+/// @param cache used for reading.
+/// @param inode pointer to the directory inode.
+/// @param block_index the index of the block where we start.
+/// @param block_offset the offset inside the block where we start.
+/// @return The initialized directory iterator.
+ext2_direntry_iterator_t ext2_direntry_iterator_begin_at(ext2_filesystem_t *fs,
+                                                         uint8_t *cache,
+                                                         ext2_inode_t *inode,
+                                                         uint32_t block_index,
+                                                         uint32_t block_offset) {
+  ext2_direntry_iterator_t it = {
+    .fs           = fs,
+    .cache        = cache,
+    .inode        = inode,
+    .block_index  = block_index,
+    .total_offset = block_index * fs->block_size + block_offset,
+    .block_offset = block_offset,
+    .direntry     = NULL
+  };
+  // If the position is past the end of the directory, the iterator is not valid.
+  if ((it.total_offset >= inode->size) || (block_offset >= fs->block_size))
+    return it;
+  // Read the block containing the position.
+  if (ext2_read_inode_block(fs, inode, it.block_index, cache) == -1) {
+    dprintf("Failed to read the inode block `%d`\n", it.block_index);
+  } else {
+    // Initialize the directory entry.
+    it.direntry = ext2_direntry_iterator_get(&it);
+  }
+  return it;
+}
+
 /// @brief Moves to the next direntry, and moves to the next block if necessary.
 /// @param iterator the iterator.
 void ext2_direntry_iterator_next(ext2_direntry_iterator_t *iterator) {
@@ -1858,6 +1961,8 @@ static int ext2_init_vfs_file(ext2_filesystem_t *fs, vfs_file_t *file,
   file->fs_operations  = &ext2_fs_operations;
   // Set the read offest.
   file->f_pos = 0;
+  // Reset the directory position.
+  memset(&file->dir_pos, 0, sizeof(file->dir_pos));
   // Set the number of links.
   file->nlink = inode->links_count;
   // Initialize the list of siblings.
@@ -2402,6 +2507,68 @@ static int ext2_ioctl(vfs_file_t *file, int request, void *data) {
   return -1;
 }
 
+/// @brief Fills the buffer with the entries of the directory, starting from
+///        the saved directory position when possible.
+/// @param fs         the filesystem.
+/// @param file       the directory handler.
+/// @param inode      the inode of the directory.
+/// @param cache      the cache used for reading.
+/// @param dirp       the buffer where the data should be written.
+/// @param entry_size the size of each element of the buffer.
+/// @param doff       the offset (in bytes of elements) of the first entry.
+/// @param count      the maximum length of the buffer.
+/// @return The number of written bytes in the buffer.
+/// @details
+/// The position reached inside the directory is saved in `file->dir_pos`, so
+/// that a call continuing from where the previous one stopped resumes the
+/// iteration directly, instead of skipping the entries already provided.
+static int __ext2_getdents(ext2_filesystem_t *fs, vfs_file_t *file,
+                           ext2_inode_t *inode, uint8_t *cache, dirent_t *dirp,
+                           size_t entry_size, off_t doff, size_t count) {
+  uint32_t current = 0, written = 0, skip = doff / entry_size;
+  // Initialize the iterator, resuming from the saved position if the caller
+  // is continuing from where the last call stopped.
+  ext2_direntry_iterator_t it;
+  if ((skip > 0) && (skip == file->dir_pos.entry)) {
+    it = ext2_direntry_iterator_begin_at(fs, cache, inode,
+                                         file->dir_pos.block_index,
+                                         file->dir_pos.block_offset);
+    current = skip;
+  } else {
+    it = ext2_direntry_iterator_begin(fs, cache, inode);
+  }
+  for (; ext2_direntry_iterator_valid(&it) && ((written + entry_size) <= count);
+       ext2_direntry_iterator_next(&it)) {
+    // Skip unused inode.
+    if (it.direntry->inode == 0)
+      continue;
+    // Skip if already provided.
+    if (++current <= skip)
+      continue;
+    // Write on current directory entry data.
+    dirp->d_ino  = it.direntry->inode;
+    dirp->d_type = ext2_file_type_to_vfs_file_type(it.direntry->file_type);
+    memset(dirp->d_name, 0, NAME_MAX);
+    strncpy(dirp->d_name, it.direntry->name, it.direntry->name_len);
+    dirp->d_off    = it.direntry->rec_len;
+    dirp->d_reclen = it.direntry->rec_len;
+    // Increment the amount written.
+    written += entry_size;
+    // Move to next writing position.
+    dirp = (dirent_t *)((uintptr_t)dirp + entry_size);
+  }
+  // Save the position of the first entry we did not provide.
+  file->dir_pos.entry        = skip + (written / entry_size);
+  file->dir_pos.block_index  = it.block_index;
+  file->dir_pos.block_offset = it.block_offset;
+  // If we reached the end of the directory, move the position past the end.
+  if (!ext2_direntry_iterator_valid(&it)) {
+    file->dir_pos.block_index  = inode->size / fs->block_size;
+    file->dir_pos.block_offset = 0;
+  }
+  return written;
+}
+
 /// @brief Reads contents of the directories to a dirent buffer, updating
 ///        the offset and returning the number of written bytes in the buffer,
 ///        it assumes that all paths are well-formed.
@@ -2426,34 +2593,99 @@ static int ext2_getdents(vfs_file_t *file, dirent_t *dirp, off_t doff,
     dprintf("Failed to read the inode (%d).\n", file->ino);
     return -ENOENT;
   }
-  uint32_t current = 0, written = 0;
   // Allocate the cache.
   // uint8_t *cache = kmem_cache_alloc(fs->ext2_buffer_cache, GFP_KERNEL);
   uint8_t *cache = kmalloc(sizeof(uint8_t) * fs->block_size);
   // Clean the cache.
   memset(cache, 0, fs->block_size);
-  // Initialize the iterator.
-  ext2_direntry_iterator_t it = ext2_direntry_iterator_begin(fs, cache, &inode);
-  for (; ext2_direntry_iterator_valid(&it) && (written < count);
-       ext2_direntry_iterator_next(&it)) {
-    // Skip unused inode.
-    if (it.direntry->inode == 0)
-      continue;
-    // Skip if already provided.
-    current += sizeof(dirent_t);
-    if (current <= doff)
+  // Fill the buffer.
+  int written = __ext2_getdents(fs, file, &inode, cache, dirp, sizeof(dirent_t),
+                                doff, count);
+  // Free the cache.
+  // kmem_cache_free(cache);
+  kfree(cache);
+  return written;
+}
+
+/// @brief Reads contents of the directories to a direntplus buffer, together
+///        with the information concerning each entry.
+/// @param file  The directory handler.
+/// @param dirp  The buffer where the data should be written.
+/// @param doff  The offset inside the buffer where the data should be written.
+/// @param count The maximum length of the buffer.
+/// @return The number of written bytes in the buffer.
+/// @details
+/// The inodes of the entries are not read one by one. Each block of the inode
+/// table is read once, and used to fill all the entries whose inode lives in
+/// it. Since the inodes of a directory are usually allocated in the same
+/// group, a whole batch costs a handful of block reads.
+static int ext2_getdentsplus(vfs_file_t *file, direntplus_t *dirp, off_t doff,
+                             size_t count) {
+  dprintf("ext2_getdentsplus(%s, %p, %d, %u)\n", file->name, dirp, (int)doff,
+          (unsigned)count);
+  // Get the filesystem.
+  ext2_filesystem_t *fs = (ext2_filesystem_t *)file->device;
+  if (fs == NULL) {
+    dprintf("The file does not belong to an EXT2 filesystem `%s`.\n",
+            file->name);
+    return -ENOENT;
+  }
+  // Get the inode associated with the file.
+  ext2_inode_t inode;
+  if (ext2_read_inode(fs, &inode, file->ino) == -1) {
+    dprintf("Failed to read the inode (%d).\n", file->ino);
+    return -ENOENT;
+  }
+  // Allocate the cache.
+  // uint8_t *cache = kmem_cache_alloc(fs->ext2_buffer_cache, GFP_KERNEL);
+  uint8_t *cache = kmalloc(sizeof(uint8_t) * fs->block_size);
+  // Clean the cache.
+  memset(cache, 0, fs->block_size);
+  // Fill the buffer with the directory entries.
+  int written = __ext2_getdents(fs, file, &inode, cache, &dirp->d_ent,
+                                sizeof(direntplus_t), doff, count);
+  size_t nentries = (written > 0) ? (written / sizeof(direntplus_t)) : 0;
+  // Clean the information, a zero inode marks the entries still to fill.
+  for (size_t i = 0; i < nentries; ++i) {
+    memset(&dirp[i].d_stat, 0, sizeof(stat_t));
+  }
+  uint32_t group_index, block_index, inode_offset;
+  for (size_t i = 0; i < nentries; ++i) {
+    // Skip the entries we already filled.
+    if (dirp[i].d_stat.st_ino != 0)
       continue;
-    // Write on current directory entry data.
-    dirp->d_ino  = it.direntry->inode;
-    dirp->d_type = ext2_file_type_to_vfs_file_type(it.direntry->file_type);
-    memset(dirp->d_name, 0, NAME_MAX);
-    strncpy(dirp->d_name, it.direntry->name, it.direntry->name_len);
-    dirp->d_off    = it.direntry->rec_len;
-    dirp->d_reclen = it.direntry->rec_len;
-    // Increment the amount written.
-    written += sizeof(dirent_t);
-    // Move to next writing position.
-    ++dirp;
+    // Get the block of the inode table containing the inode.
+    group_index  = ext2_get_group_index_from_inode(fs, dirp[i].d_ent.d_ino);
+    inode_offset = ext2_get_inode_offest_in_group(fs, dirp[i].d_ent.d_ino);
+    block_index  = ext2_get_block_index_from_inode_offset(fs, inode_offset);
+    if ((group_index >= fs->block_groups_count) ||
+        (ext2_read_block(fs,
+                         fs->block_groups[group_index].inode_table + block_index,
+                         cache) < 0)) {
+      dprintf("Failed to read the inode table for inode `%d`.\n",
+              dirp[i].d_ent.d_ino);
+      written = -EIO;
+      break;
+    }
+    // Fill all the entries whose inode resides inside this block.
+    for (size_t j = i; j < nentries; ++j) {
+      if ((dirp[j].d_stat.st_ino != 0) ||
+          (ext2_get_group_index_from_inode(fs, dirp[j].d_ent.d_ino) !=
+           group_index))
+        continue;
+      inode_offset = ext2_get_inode_offest_in_group(fs, dirp[j].d_ent.d_ino);
+      if (ext2_get_block_index_from_inode_offset(fs, inode_offset) !=
+          block_index)
+        continue;
+      // Get the real inode offset inside the block.
+      inode_offset %= fs->inodes_per_block_count;
+      // Set the information.
+      __ext2_stat((ext2_inode_t *)((uintptr_t)cache +
+                                   (inode_offset * fs->superblock.inode_size)),
+                  &dirp[j].d_stat);
+      dirp[j].d_stat.st_dev = fs->block_device->ino;
+      dirp[j].d_stat.st_ino = dirp[j].d_ent.d_ino;
+    }
   }
   // Free the cache.
   // kmem_cache_free(cache);
@@ -2719,6 +2951,8 @@ static vfs_file_t *ext2_mount(vfs_file_t *block_device, const char *path) {
   list_head_init(&fs->opened_files);
   // Set the pointer to the block device.
   fs->block_device = block_device;
+  // Get the queue of the device, if it has one.
+  fs->block = block_get_device(block_device);
   // Read the superblock.
   if (ext2_read_superblock(fs) == -1) {
     dprintf("Failed to read the superblock table at 1024.\n");
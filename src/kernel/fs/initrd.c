@@ -0,0 +1,134 @@
+/// Copyright (c) 2022-2025 Minh Hai Dao (barrydevp)
+
+#include <kernel/fs/modules.h>
+#include <kernel/fs/vfs.h>
+#include <kernel/kernel.h>
+#include <kernel/memory/mmu.h>
+#include <kernel/memory/vmm.h>
+#include <kernel/string.h>
+#include <kernel/errno.h>
+#include <kernel/time.h>
+#include <kernel/math.h>
+#include <kernel/system/syscall.h>
+
+#include <kernel/printf.h>
+
+/// @brief The initial ramdisk loaded by the bootloader.
+typedef struct initrd_device_t {
+  /// Where the image is mapped inside the kernel address space.
+  char *start;
+  /// The size of the image.
+  size_t size;
+  /// The VFS file of the block device.
+  vfs_file_t *fs_root;
+} initrd_device_t;
+
+/// The initial ramdisk.
+static initrd_device_t initrd;
+
+static ssize_t read_initrd(vfs_file_t *file, char *buffer, off_t offset,
+                           size_t size) {
+  if ((offset < 0) || ((size_t)offset >= initrd.size))
+    return 0;
+  size = min(size, initrd.size - offset);
+  memcpy(buffer, initrd.start + offset, size);
+  return size;
+}
+
+static ssize_t write_initrd(vfs_file_t *file, const void *buffer, off_t offset,
+                            size_t size) {
+  if ((offset < 0) || ((size_t)offset >= initrd.size))
+    return -ENOSPC;
+  size = min(size, initrd.size - offset);
+  memcpy(initrd.start + offset, buffer, size);
+  return size;
+}
+
+static vfs_file_t *open_initrd(const char *path, int flags, mode_t mode) {
+  return initrd.fs_root;
+}
+
+static int close_initrd(vfs_file_t *file) {
+  return 0;
+}
+
+static int _stat_initrd(stat_t *stat) {
+  stat->st_dev   = 0;
+  stat->st_ino   = 0;
+  stat->st_mode  = 0060000 | 0600;
+  stat->st_uid   = 0;
+  stat->st_gid   = 0;
+  stat->st_size  = initrd.size;
+  stat->st_atime = sys_time(NULL);
+  stat->st_mtime = stat->st_atime;
+  stat->st_ctime = stat->st_atime;
+  return 0;
+}
+
+static int fstat_initrd(vfs_file_t *file, stat_t *stat) {
+  return _stat_initrd(stat);
+}
+
+static int stat_initrd(const char *path, stat_t *stat) {
+  return _stat_initrd(stat);
+}
+
+/// Filesystem general operations.
+static vfs_sys_operations_t initrd_sys_operations = {
+  .stat_f = stat_initrd,
+};
+
+/// Filesystem file operations.
+static vfs_file_operations_t initrd_fs_operations = {
+  .open_f  = open_initrd,
+  .close_f = close_initrd,
+  .read_f  = read_initrd,
+  .write_f = write_initrd,
+  .stat_f  = fstat_initrd,
+};
+
+static vfs_file_t *initrd_device_create(void) {
+  vfs_file_t *file = kmalloc(sizeof(vfs_file_t));
+  if (!file) {
+    dprintf("initrd_device_create(): Failed to allocate memory for VFS file!\n");
+    return NULL;
+  }
+  memset(file, 0, sizeof(vfs_file_t));
+  strcpy(file->name, "initrd");
+  file->device         = &initrd;
+  file->flags          = DT_BLK;
+  file->mask           = 0600;
+  file->length         = initrd.size;
+  file->sys_operations = &initrd_sys_operations;
+  file->fs_operations  = &initrd_fs_operations;
+  return file;
+}
+
+int initrd_init(boot_info_t *boot_info) {
+  if (!boot_info->module_start) {
+    dprintf("No initrd has been loaded by the bootloader.\n");
+    return 1;
+  }
+  uint32_t size   = boot_info->module_end - boot_info->module_start;
+  uint32_t offset = boot_info->module_start & PAGE_LOW_MASK;
+  if (offset + size > INITRD_END - INITRD_START) {
+    dprintf("The initrd is too big (%uKB).\n", size / KB);
+    return 1;
+  }
+  // Map the image, its frames were reserved by the physical memory manager.
+  vmm_map_range(INITRD_START, boot_info->module_start, offset + size,
+                PML_KERNEL_ACCESS);
+  initrd.start = (char *)(INITRD_START + offset);
+  initrd.size  = size;
+  // Create the block device.
+  initrd.fs_root = initrd_device_create();
+  if (!initrd.fs_root)
+    return 1;
+  if (!vfs_mount("/dev/initrd", initrd.fs_root)) {
+    dprintf("Failed to mount the initrd device!\n");
+    return 1;
+  }
+  dprintf("initrd: phy=0x%x virt=0x%p (%uKB)\n", boot_info->module_start,
+          initrd.start, size / KB);
+  return 0;
+}
@@ -2,14 +2,20 @@
 
 #include <kernel/process/task.h>
 #include <kernel/memory/pmm.h>
+#include <kernel/memory/mmu.h>
 #include <kernel/fs/procfs.h>
+#include <kernel/fs/block.h>
 #include <kernel/version.h>
 #include <kernel/string.h>
 #include <kernel/stdio.h>
 #include <kernel/errno.h>
+#include <kernel/math.h>
 
 #include <kernel/printf.h>
 
+/// The size of the buffer where the content of the entries is generated.
+#define PROCS_BUFSIZ 4096
+
 static ssize_t procs_do_uptime(char *buffer, size_t bufsize);
 
 static ssize_t procs_do_version(char *buffer, size_t bufsize);
@@ -22,6 +28,8 @@ static ssize_t procs_do_meminfo(char *buffer, size_t bufsize);
 
 static ssize_t procs_do_stat(char *buffer, size_t bufsize);
 
+static ssize_t procs_do_diskstats(char *buffer, size_t bufsize);
+
 static ssize_t procs_read(vfs_file_t *file, char *buf, off_t offset,
                           size_t nbyte) {
   if (file == NULL)
@@ -29,23 +37,31 @@ static ssize_t procs_read(vfs_file_t *file, char *buf, off_t offset,
   proc_dir_entry_t *entry = (proc_dir_entry_t *)file->device;
   if (entry == NULL)
     return -EFAULT;
-  // Prepare a buffer.
-  char buffer[BUFSIZ];
-  memset(buffer, 0, BUFSIZ);
+  // Prepare a buffer, it is too big for the stack. The statistics of the
+  // block devices grow with the number of devices.
+  size_t bufsize = PROCS_BUFSIZ;
+  if (strcmp(entry->name, "diskstats") == 0)
+    bufsize = max(bufsize, block_stats_size());
+  char *buffer = kmalloc(bufsize);
+  if (buffer == NULL)
+    return -ENOMEM;
+  memset(buffer, 0, bufsize);
   // Call the specific function.
   int ret = 0;
   if (strcmp(entry->name, "uptime") == 0)
-    ret = procs_do_uptime(buffer, BUFSIZ);
+    ret = procs_do_uptime(buffer, bufsize);
   else if (strcmp(entry->name, "version") == 0)
-    ret = procs_do_version(buffer, BUFSIZ);
+    ret = procs_do_version(buffer, bufsize);
   else if (strcmp(entry->name, "mounts") == 0)
-    ret = procs_do_mounts(buffer, BUFSIZ);
+    ret = procs_do_mounts(buffer, bufsize);
   else if (strcmp(entry->name, "cpuinfo") == 0)
-    ret = procs_do_cpuinfo(buffer, BUFSIZ);
+    ret = procs_do_cpuinfo(buffer, bufsize);
   else if (strcmp(entry->name, "meminfo") == 0)
-    ret = procs_do_meminfo(buffer, BUFSIZ);
+    ret = procs_do_meminfo(buffer, bufsize);
   else if (strcmp(entry->name, "stat") == 0)
-    ret = procs_do_stat(buffer, BUFSIZ);
+    ret = procs_do_stat(buffer, bufsize);
+  else if (strcmp(entry->name, "diskstats") == 0)
+    ret = procs_do_diskstats(buffer, bufsize);
   // Perform read.
   ssize_t it = 0;
   if (ret == 0) {
@@ -59,6 +75,7 @@ static ssize_t procs_read(vfs_file_t *file, char *buf, off_t offset,
       }
     }
   }
+  kfree(buffer);
   return it;
 }
 
@@ -139,6 +156,16 @@ int procs_init() {
   // Set the specific operations.
   system_entry->sys_operations = &procs_sys_operations;
   system_entry->fs_operations  = &procs_fs_operations;
+
+  // == /proc/diskstats ===================================================
+  if ((system_entry = proc_create_entry("diskstats", NULL)) == NULL) {
+    dprintf("Cannot create `/proc/diskstats`.\n");
+    return 1;
+  }
+  dprintf("Created `/proc/diskstats` (%p)\n", system_entry);
+  // Set the specific operations.
+  system_entry->sys_operations = &procs_sys_operations;
+  system_entry->fs_operations  = &procs_fs_operations;
   return 0;
 }
 
@@ -181,3 +208,8 @@ static ssize_t procs_do_meminfo(char *buffer, size_t bufsize) {
 static ssize_t procs_do_stat(char *buffer, size_t bufsize) {
   return 0;
 }
+
+static ssize_t procs_do_diskstats(char *buffer, size_t bufsize) {
+  block_print_stats(buffer, bufsize);
+  return 0;
+}
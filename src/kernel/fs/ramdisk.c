@@ -0,0 +1,206 @@
+/// Copyright (c) 2022-2025 Minh Hai Dao (barrydevp)
+
+#include <kernel/fs/ramdisk.h>
+#include <kernel/fs/vfs.h>
+#include <kernel/memory/mmu.h>
+#include <kernel/string.h>
+#include <kernel/stdio.h>
+#include <kernel/errno.h>
+#include <kernel/system/syscall.h>
+
+#include <kernel/printf.h>
+
+/// The RAM disks.
+static ramdisk_device_t *ramdisks[RAMDISK_MAX_DEVICES] = { NULL };
+
+/// @brief Performs a request of the block layer, by copying the sectors.
+/// @param bdev the block device.
+/// @param req the request.
+/// @return 0.
+static int ramdisk_submit(block_device_t *bdev, block_request_t *req) {
+  ramdisk_device_t *dev = (ramdisk_device_t *)bdev->data;
+  char *data            = dev->start + req->sector * BLOCK_SECTOR_SIZE;
+  list_for_each_decl(it, &req->bios) {
+    bio_t *bio  = list_entry(it, bio_t, list);
+    size_t size = bio->count * BLOCK_SECTOR_SIZE;
+    if (req->write) {
+      memcpy(data, bio->buffer, size);
+    } else {
+      memcpy(bio->buffer, data, size);
+    }
+    data += size;
+  }
+  return 0;
+}
+
+static vfs_file_t *ramdisk_open(const char *path, int flags, mode_t mode) {
+  for (unsigned i = 0; i < RAMDISK_MAX_DEVICES; ++i) {
+    if (ramdisks[i] && (strcmp(path, ramdisks[i]->path) == 0)) {
+      ++ramdisks[i]->fs_root->count;
+      return ramdisks[i]->fs_root;
+    }
+  }
+  return NULL;
+}
+
+static int ramdisk_close(vfs_file_t *file) {
+  --file->count;
+  return 0;
+}
+
+static ssize_t ramdisk_read(vfs_file_t *file, char *buffer, off_t offset,
+                            size_t size) {
+  ramdisk_device_t *dev = (ramdisk_device_t *)file->device;
+  // The block layer splits the range in sectors, and queues them.
+  return block_read(&dev->block, buffer, offset, size);
+}
+
+static ssize_t ramdisk_write(vfs_file_t *file, const void *buffer,
+                             off_t offset, size_t size) {
+  ramdisk_device_t *dev = (ramdisk_device_t *)file->device;
+  // The block layer splits the range in sectors, and queues them.
+  return block_write(&dev->block, buffer, offset, size);
+}
+
+static int ramdisk_ioctl(vfs_file_t *file, int request, void *data) {
+  ramdisk_device_t *dev = (ramdisk_device_t *)file->device;
+  if (!data) {
+    return -EFAULT;
+  }
+  if (request == ramdisk_ioctl_create) {
+    return ramdisk_create(*(size_t *)data);
+  }
+  if (request == ramdisk_ioctl_get_size) {
+    *(size_t *)data = dev->size;
+    return 0;
+  }
+  return -ENOTTY;
+}
+
+static int _ramdisk_stat(const ramdisk_device_t *dev, stat_t *stat) {
+  stat->st_dev   = 0;
+  stat->st_ino   = 0;
+  stat->st_mode  = 0060000 | 0600;
+  stat->st_uid   = 0;
+  stat->st_gid   = 0;
+  stat->st_size  = dev->size;
+  stat->st_atime = sys_time(NULL);
+  stat->st_mtime = stat->st_atime;
+  stat->st_ctime = stat->st_atime;
+  return 0;
+}
+
+static int ramdisk_fstat(vfs_file_t *file, stat_t *stat) {
+  return _ramdisk_stat(file->device, stat);
+}
+
+static int ramdisk_stat(const char *path, stat_t *stat) {
+  for (unsigned i = 0; i < RAMDISK_MAX_DEVICES; ++i) {
+    if (ramdisks[i] && (strcmp(path, ramdisks[i]->path) == 0)) {
+      return _ramdisk_stat(ramdisks[i], stat);
+    }
+  }
+  return -ENOENT;
+}
+
+/// Filesystem general operations.
+static vfs_sys_operations_t ramdisk_sys_operations = {
+  .stat_f = ramdisk_stat,
+};
+
+/// Filesystem file operations.
+static vfs_file_operations_t ramdisk_fs_operations = {
+  .open_f  = ramdisk_open,
+  .close_f = ramdisk_close,
+  .read_f  = ramdisk_read,
+  .write_f = ramdisk_write,
+  .stat_f  = ramdisk_fstat,
+  .ioctl_f = ramdisk_ioctl,
+};
+
+static vfs_file_t *ramdisk_device_create(ramdisk_device_t *dev) {
+  vfs_file_t *file = kmalloc(sizeof(vfs_file_t));
+  if (!file) {
+    dprintf("ramdisk_device_create(): Failed to allocate memory for VFS file!\n");
+    return NULL;
+  }
+  memset(file, 0, sizeof(vfs_file_t));
+  strcpy(file->name, dev->name);
+  file->device         = dev;
+  file->flags          = DT_BLK;
+  file->mask           = 0600;
+  file->length         = dev->size;
+  file->sys_operations = &ramdisk_sys_operations;
+  file->fs_operations  = &ramdisk_fs_operations;
+  return file;
+}
+
+int ramdisk_create(size_t size) {
+  // Find a free index.
+  int index = -1;
+  for (int i = 0; i < RAMDISK_MAX_DEVICES; ++i) {
+    if (!ramdisks[i]) {
+      index = i;
+      break;
+    }
+  }
+  if (index < 0) {
+    return -ENOSPC;
+  }
+  size = __ALIGN_UP(size, BLOCK_SECTOR_SIZE);
+  if (!size) {
+    return -EINVAL;
+  }
+
+  ramdisk_device_t *dev = kmalloc(sizeof(ramdisk_device_t));
+  if (!dev) {
+    return -ENOMEM;
+  }
+  memset(dev, 0, sizeof(ramdisk_device_t));
+  dev->start = kmalloc_align(size);
+  if (!dev->start) {
+    kfree(dev);
+    return -ENOMEM;
+  }
+  memset(dev->start, 0, size);
+  dev->size = size;
+  sprintf(dev->name, "ram%d", index);
+  sprintf(dev->path, "/dev/ram%d", index);
+
+  // Create the block device.
+  dev->fs_root = ramdisk_device_create(dev);
+  if (!dev->fs_root) {
+    kfree(dev->start);
+    kfree(dev);
+    return -ENOMEM;
+  }
+  if (!vfs_mount(dev->path, dev->fs_root)) {
+    dprintf("Failed to mount the %s device!\n", dev->path);
+    kfree(dev->fs_root);
+    kfree(dev->start);
+    kfree(dev);
+    return -EIO;
+  }
+  // Requests are served synchronously, by copying the data.
+  strcpy(dev->block.name, dev->name);
+  dev->block.sector_count = size / BLOCK_SECTOR_SIZE;
+  dev->block.max_sectors  = RAMDISK_MAX_SECTORS;
+  dev->block.submit       = ramdisk_submit;
+  dev->block.data         = dev;
+  dev->block.file         = dev->fs_root;
+  block_register(&dev->block);
+
+  ramdisks[index] = dev;
+  dprintf("ramdisk: %s (%uKB)\n", dev->path, (uint32_t)(size / KB));
+  return index;
+}
+
+int ramdisk_init(unsigned count, size_t size) {
+  for (unsigned i = 0; i < count; ++i) {
+    if (ramdisk_create(size) < 0) {
+      dprintf("Failed to create the RAM disk %u.\n", i);
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,67 @@
+/// Copyright (c) 2014-2024 MentOs-Team
+/// Copyright (c) 2022-2025 Minh Hai Dao (barrydevp)
+
+#include <kernel/fs/vfs.h>
+
+#include <kernel/process/scheduler.h>
+#include <kernel/system/syscall.h>
+#include <kernel/errno.h>
+
+#include <kernel/printf.h>
+
+/// @brief Returns the file associated with the file descriptor of the current
+///        process.
+/// @param fd the file descriptor.
+/// @param file the output variable where we store the file.
+/// @return 0 on success, a negative errno value on failure.
+static inline int __get_current_file(int fd, vfs_file_t **file) {
+  task_struct *task = scheduler_get_current_process();
+  // Check the current FD.
+  if ((fd < 0) || (fd >= task->files->max_fd)) {
+    return -EBADF;
+  }
+  // Get the file descriptor.
+  vfs_file_descriptor_t *vfd = &task->files->fd_list[fd];
+  // Check the file.
+  if (vfd->file_struct == NULL) {
+    return -ENOENT;
+  }
+  (*file) = vfd->file_struct;
+  return 0;
+}
+
+int sys_getdents(int fd, dirent_t *dirp, unsigned int count) {
+  if (dirp == NULL) {
+    return -EFAULT;
+  }
+  vfs_file_t *file;
+  int ret = __get_current_file(fd, &file);
+  if (ret < 0) {
+    return ret;
+  }
+  // Perform the read.
+  ssize_t actual_read = vfs_getdents(file, dirp, file->f_pos, count);
+  // Update the offest, only if the value the function returns is positive.
+  if (actual_read > 0) {
+    file->f_pos += actual_read;
+  }
+  return actual_read;
+}
+
+int sys_getdentsplus(int fd, direntplus_t *dirp, unsigned int count) {
+  if (dirp == NULL) {
+    return -EFAULT;
+  }
+  vfs_file_t *file;
+  int ret = __get_current_file(fd, &file);
+  if (ret < 0) {
+    return ret;
+  }
+  // Perform the read.
+  ssize_t actual_read = vfs_getdentsplus(file, dirp, file->f_pos, count);
+  // Update the offest, only if the value the function returns is positive.
+  if (actual_read > 0) {
+    file->f_pos += actual_read;
+  }
+  return actual_read;
+}
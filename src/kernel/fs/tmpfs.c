@@ -0,0 +1,944 @@
+/// Copyright (c) 2022-2025 Minh Hai Dao (barrydevp)
+
+#include <kernel/fs/tmpfs.h>
+#include <kernel/fs/vfs.h>
+#include <kernel/memory/mmu.h>
+#include <kernel/process/scheduler.h>
+#include <kernel/string.h>
+#include <kernel/errno.h>
+#include <kernel/fcntl.h>
+#include <kernel/assert.h>
+#include <kernel/stdio.h>
+#include <kernel/time.h>
+#include <kernel/math.h>
+#include <kernel/bitops.h>
+#include <kernel/spinlock.h>
+
+#include <kernel/printf.h>
+
+/// The magic number used to check if the tmpfs node is valid.
+#define TMPFS_MAGIC_NUMBER 0x7E
+/// Mode bits identifying a directory.
+#define TMPFS_S_IFDIR 0040000
+/// Mode bits identifying a regular file.
+#define TMPFS_S_IFREG 0100000
+/// Without a size option, a tmpfs can use 1/TMPFS_DEFAULT_SIZE_RATIO of the
+/// physical memory.
+#define TMPFS_DEFAULT_SIZE_RATIO 2
+/// Frames a tmpfs never takes, they are left to the rest of the kernel.
+#define TMPFS_RESERVED_FRAMES 256
+
+// ============================================================================
+// Data Structures
+// ============================================================================
+
+/// Forward declaration of the filesystem.
+typedef struct tmpfs_t tmpfs_t;
+
+/// @brief A file or a directory living inside a tmpfs.
+typedef struct tmpfs_node_t {
+  /// Number used as delimiter, it must be set to TMPFS_MAGIC_NUMBER.
+  int magic;
+  /// The node inode.
+  ino_t inode;
+  /// Flags (DT_DIR or DT_REG).
+  unsigned flags;
+  /// The permissions mask.
+  mode_t mask;
+  /// The name of the entry inside its parent.
+  char name[NAME_MAX];
+  /// User id of the file.
+  uid_t uid;
+  /// Group id of the file.
+  gid_t gid;
+  /// Time of last access.
+  time_t atime;
+  /// Time of last data modification.
+  time_t mtime;
+  /// Time of last status change.
+  time_t ctime;
+  /// Size of the file, in bytes.
+  size_t size;
+  /// The physical frames holding the content of the file, 0 entries are
+  /// holes. They are mapped with vmm_kmap only while they are accessed.
+  uintptr_t *pages;
+  /// Number of slots inside `pages`.
+  size_t npages;
+  /// The filesystem the node belongs to.
+  tmpfs_t *fs;
+  /// The parent directory, NULL for the root or for unlinked nodes.
+  struct tmpfs_node_t *parent;
+  /// The entries of the directory.
+  list_head children;
+  /// Position inside the list of entries of the parent.
+  list_head siblings;
+  /// The VFS files currently opened on this node.
+  list_head files;
+} tmpfs_node_t;
+
+/// @brief An instance of a mounted tmpfs.
+struct tmpfs_t {
+  /// The root directory.
+  tmpfs_node_t *root;
+  /// The next free inode.
+  ino_t next_inode;
+  /// Maximum number of pages the filesystem can use.
+  size_t max_pages;
+  /// Number of pages currently used for file data.
+  size_t used_pages;
+  /// Lock protecting the tree and the pages.
+  spinlock_t spinlock;
+};
+
+// ============================================================================
+// Forward Declaration of Functions
+// ============================================================================
+
+static int tmpfs_mkdir(const char *path, mode_t mode);
+static int tmpfs_rmdir(const char *path);
+static int tmpfs_stat(const char *path, stat_t *stat);
+static vfs_file_t *tmpfs_creat(const char *path, mode_t mode);
+
+static vfs_file_t *tmpfs_open(const char *path, int flags, mode_t mode);
+static int tmpfs_unlink(const char *path);
+static int tmpfs_close(vfs_file_t *file);
+static ssize_t tmpfs_read(vfs_file_t *file, char *buffer, off_t offset,
+                          size_t nbyte);
+static ssize_t tmpfs_write(vfs_file_t *file, const void *buffer, off_t offset,
+                           size_t nbyte);
+static off_t tmpfs_lseek(vfs_file_t *file, off_t offset, int whence);
+static int tmpfs_fstat(vfs_file_t *file, stat_t *stat);
+static int tmpfs_ioctl(vfs_file_t *file, int request, void *data);
+static int tmpfs_getdents(vfs_file_t *file, dirent_t *dirp, off_t doff,
+                          size_t count);
+static int tmpfs_getdentsplus(vfs_file_t *file, direntplus_t *dirp, off_t doff,
+                              size_t count);
+
+// ============================================================================
+// Virtual FileSystem (VFS) Operaions
+// ============================================================================
+
+/// Filesystem general operations.
+static vfs_sys_operations_t tmpfs_sys_operations = {
+  .mkdir_f = tmpfs_mkdir,
+  .rmdir_f = tmpfs_rmdir,
+  .stat_f  = tmpfs_stat,
+  .creat_f = tmpfs_creat,
+};
+
+/// Filesystem file operations.
+static vfs_file_operations_t tmpfs_fs_operations = {
+  .open_f         = tmpfs_open,
+  .unlink_f       = tmpfs_unlink,
+  .close_f        = tmpfs_close,
+  .read_f         = tmpfs_read,
+  .write_f        = tmpfs_write,
+  .lseek_f        = tmpfs_lseek,
+  .stat_f         = tmpfs_fstat,
+  .ioctl_f        = tmpfs_ioctl,
+  .getdents_f     = tmpfs_getdents,
+  .getdentsplus_f = tmpfs_getdentsplus,
+};
+
+// ============================================================================
+// TMPFS Core Functions
+// ============================================================================
+
+/// @brief Checks if the node is a valid TMPFS node.
+/// @param node the node to check.
+/// @return true if valid, false otherwise.
+static inline bool_t tmpfs_check_node(tmpfs_node_t *node) {
+  return (node && (node->magic == TMPFS_MAGIC_NUMBER));
+}
+
+/// @brief Returns the TMPFS node associated with the given VFS file.
+/// @param file the VFS file.
+/// @return a valid pointer to a TMPFS node, NULL otherwise.
+static inline tmpfs_node_t *tmpfs_get_node(vfs_file_t *file) {
+  if (file && tmpfs_check_node((tmpfs_node_t *)file->device))
+    return (tmpfs_node_t *)file->device;
+  return NULL;
+}
+
+/// @brief Get the TMPFS filesystem starting from an absolute path.
+/// @param absolute_path the absolute path of an entry.
+/// @param relative_path where we store the path relative to the mount point.
+/// @return a pointer to the TMPFS filesystem, NULL otherwise.
+static tmpfs_t *tmpfs_get_filesystem(const char *absolute_path,
+                                     const char **relative_path) {
+  super_block_t *sb = vfs_get_superblock(absolute_path);
+  if (sb == NULL) {
+    dprintf("Cannot find the superblock for the absolute path `%s`.\n",
+            absolute_path);
+    return NULL;
+  }
+  tmpfs_node_t *root = tmpfs_get_node(sb->root);
+  if (root == NULL) {
+    dprintf("The superblock `%s` does not belong to a TMPFS.\n", sb->path);
+    return NULL;
+  }
+  // The mount tree guarantees that the superblock path is a prefix made of
+  // whole components.
+  *relative_path = absolute_path + strlen(sb->path);
+  return root->fs;
+}
+
+/// @brief Extracts the next component of the path.
+/// @param path the path, it is moved past the extracted component.
+/// @param component the buffer where the component is copied.
+/// @return 1 if a component was found, 0 at the end of the path.
+static inline int __tmpfs_next_component(const char **path, char *component) {
+  const char *it = *path;
+  // Skip the separators.
+  while (*it == PATH_SEPARATOR)
+    ++it;
+  if (*it == 0)
+    return 0;
+  // Find the end of the component.
+  size_t length = 0;
+  while (it[length] && (it[length] != PATH_SEPARATOR))
+    ++length;
+  length = min(length, NAME_MAX - 1);
+  strncpy(component, it, length);
+  component[length] = 0;
+  *path             = it + length;
+  return 1;
+}
+
+/// @brief Searches the entry with the given name inside the directory.
+/// @param directory the directory.
+/// @param name the name of the entry.
+/// @return a pointer to the entry, NULL otherwise.
+static inline tmpfs_node_t *tmpfs_find_child(tmpfs_node_t *directory,
+                                             const char *name) {
+  tmpfs_node_t *child;
+  list_for_each_decl(it, &directory->children) {
+    child = list_entry(it, tmpfs_node_t, siblings);
+    if (!strcmp(child->name, name))
+      return child;
+  }
+  return NULL;
+}
+
+/// @brief Walks the directory tree following the given path.
+/// @param fs the filesystem.
+/// @param path the path relative to the mount point.
+/// @param parent if not NULL, set to the directory containing the last
+///   component, or NULL if one of the intermediate directories is missing.
+/// @param name if not NULL, receives the last component of the path.
+/// @return a pointer to the node, NULL if it does not exist.
+static tmpfs_node_t *tmpfs_resolve_path(tmpfs_t *fs, const char *path,
+                                        tmpfs_node_t **parent, char *name) {
+  char component[NAME_MAX];
+  tmpfs_node_t *node = fs->root;
+  if (parent)
+    *parent = NULL;
+  if (name)
+    name[0] = 0;
+  while (__tmpfs_next_component(&path, component)) {
+    // The previous component must be an existing directory.
+    if ((node == NULL) || !bitmask_check(node->flags, DT_DIR)) {
+      if (parent)
+        *parent = NULL;
+      return NULL;
+    }
+    if (parent)
+      *parent = node;
+    if (name)
+      strcpy(name, component);
+    node = tmpfs_find_child(node, component);
+  }
+  return node;
+}
+
+/// @brief Creates a new TMPFS node inside the given directory.
+/// @param fs the filesystem.
+/// @param parent the parent directory, NULL for the root.
+/// @param name the name of the entry.
+/// @param flags the type of the entry.
+/// @param mask the permissions mask.
+/// @return a pointer to the new TMPFS node, NULL otherwise.
+static tmpfs_node_t *tmpfs_create_node(tmpfs_t *fs, tmpfs_node_t *parent,
+                                       const char *name, unsigned flags,
+                                       mode_t mask) {
+  tmpfs_node_t *node = kmalloc(sizeof(tmpfs_node_t));
+  if (!node) {
+    dprintf("Failed to allocate the tmpfs node `%s`.\n", name);
+    return NULL;
+  }
+  // Clean up the memory.
+  memset(node, 0, sizeof(tmpfs_node_t));
+  // Initialize the magic number.
+  node->magic = TMPFS_MAGIC_NUMBER;
+  // Initialize the inode.
+  node->inode = fs->next_inode++;
+  // Flags and permissions.
+  node->flags = flags;
+  node->mask  = mask & 0xFFF;
+  // The name of the entry.
+  strncpy(node->name, name, NAME_MAX - 1);
+  // The owner is the current process, if any.
+  task_struct *task = scheduler_get_current_process();
+  if (task) {
+    node->uid = task->uid;
+    node->gid = task->gid;
+  }
+  // Set the times.
+  node->atime = sys_time(NULL);
+  node->mtime = node->atime;
+  node->ctime = node->atime;
+  // Initialize the lists.
+  node->fs = fs;
+  list_head_init(&node->children);
+  list_head_init(&node->siblings);
+  list_head_init(&node->files);
+  // Add the node to its parent.
+  if (parent) {
+    node->parent = parent;
+    list_head_insert_before(&node->siblings, &parent->children);
+    parent->mtime = node->atime;
+  }
+  dprintf("tmpfs_create_node(%p) `%s` (ino: %d)\n", node, name, node->inode);
+  return node;
+}
+
+/// @brief Returns the frame of the page with the given index, allocating it
+///   if requested.
+/// @param node the TMPFS node.
+/// @param index the index of the page inside the file.
+/// @param alloc if the page should be allocated when missing.
+/// @return the physical address of the frame, 0 if it is a hole or if we ran
+///   out of space.
+static uintptr_t tmpfs_get_page(tmpfs_node_t *node, size_t index,
+                                bool_t alloc) {
+  if ((index < node->npages) && node->pages[index])
+    return node->pages[index];
+  if (!alloc)
+    return 0;
+  tmpfs_t *fs = node->fs;
+  // Check the size limit of the filesystem, and leave the last frames to the
+  // rest of the kernel, running out of them is fatal.
+  if ((fs->used_pages >= fs->max_pages) ||
+      (get_used_frames() + TMPFS_RESERVED_FRAMES >= get_total_frames())) {
+    dprintf("tmpfs: no space left (%u pages used).\n",
+            (unsigned)fs->used_pages);
+    return 0;
+  }
+  // Grow the table of pages.
+  if (index >= node->npages) {
+    size_t npages    = max(index + 1, node->npages * 2);
+    uintptr_t *pages = kmalloc(npages * sizeof(uintptr_t));
+    if (pages == NULL)
+      return 0;
+    memset(pages, 0, npages * sizeof(uintptr_t));
+    if (node->pages) {
+      memcpy(pages, node->pages, node->npages * sizeof(uintptr_t));
+      kfree(node->pages);
+    }
+    node->pages  = pages;
+    node->npages = npages;
+  }
+  // Allocate a frame, and clear it.
+  uintptr_t frame = pmm_allocate_frame_addr();
+  char *page      = vmm_kmap(frame);
+  if (page == NULL) {
+    pmm_free_frame(frame);
+    return 0;
+  }
+  memset(page, 0, PAGE_SIZE);
+  vmm_kunmap(page);
+  node->pages[index] = frame;
+  ++fs->used_pages;
+  return frame;
+}
+
+/// @brief Copies data between the page with the given index and a buffer.
+/// @param node the TMPFS node.
+/// @param index the index of the page inside the file.
+/// @param offset the offset inside the page.
+/// @param buffer the buffer, NULL to clear the page instead of writing it.
+/// @param size the number of bytes to copy.
+/// @param write if the data is copied from the buffer to the page.
+/// @return 0 on success, -ENOSPC if the page cannot be allocated.
+static int tmpfs_copy_page(tmpfs_node_t *node, size_t index, size_t offset,
+                           void *buffer, size_t size, bool_t write) {
+  uintptr_t frame = tmpfs_get_page(node, index, write);
+  // Holes are read as zeros.
+  if (frame == 0) {
+    if (write)
+      return -ENOSPC;
+    memset(buffer, 0, size);
+    return 0;
+  }
+  char *page = vmm_kmap(frame);
+  if (page == NULL)
+    return -ENOSPC;
+  if (!write)
+    memcpy(buffer, page + offset, size);
+  else if (buffer)
+    memcpy(page + offset, buffer, size);
+  else
+    memset(page + offset, 0, size);
+  vmm_kunmap(page);
+  return 0;
+}
+
+/// @brief Changes the size of the file, releasing the pages past the end.
+/// @param node the TMPFS node.
+/// @param size the new size.
+static void tmpfs_truncate(tmpfs_node_t *node, size_t size) {
+  size_t keep = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+  // Release the pages which are completely past the end.
+  for (size_t index = keep; index < node->npages; ++index) {
+    if (node->pages[index]) {
+      pmm_free_frame(node->pages[index]);
+      node->pages[index] = 0;
+      --node->fs->used_pages;
+    }
+  }
+  // Clear the tail of the last page, so that growing the file reads zeros.
+  if ((size < node->size) && (size % PAGE_SIZE) &&
+      tmpfs_get_page(node, size / PAGE_SIZE, false)) {
+    tmpfs_copy_page(node, size / PAGE_SIZE, size % PAGE_SIZE, NULL,
+                    PAGE_SIZE - (size % PAGE_SIZE), true);
+  }
+  node->size  = size;
+  node->mtime = sys_time(NULL);
+}
+
+/// @brief Destroyes the given TMPFS node, together with its content.
+/// @param node the node to destroy, it must be detached from the tree.
+static void tmpfs_destroy_node(tmpfs_node_t *node) {
+  dprintf("tmpfs_destroy_node(%p) `%s`\n", node, node->name);
+  tmpfs_truncate(node, 0);
+  if (node->pages)
+    kfree(node->pages);
+  node->magic = 0;
+  kfree(node);
+}
+
+/// @brief Removes the node from its parent, freeing it if it is not opened.
+/// @param node the node to remove.
+static void tmpfs_detach_node(tmpfs_node_t *node) {
+  if (node->parent)
+    node->parent->mtime = sys_time(NULL);
+  list_head_remove(&node->siblings);
+  node->parent = NULL;
+  // The node is destroyed by the last close.
+  if (list_head_empty(&node->files))
+    tmpfs_destroy_node(node);
+}
+
+/// @brief Creates a VFS file, from a TMPFS node.
+/// @param node the TMPFS node.
+/// @param path the absolute path of the node.
+/// @return a pointer to the newly create VFS file, NULL on failure.
+static vfs_file_t *tmpfs_create_file_struct(tmpfs_node_t *node,
+                                            const char *path) {
+  vfs_file_t *file = kmalloc(sizeof(vfs_file_t));
+  if (!file) {
+    dprintf("Failed to allocate memory for VFS file `%s`!\n", path);
+    return NULL;
+  }
+  memset(file, 0, sizeof(vfs_file_t));
+  strncpy(file->name, path, NAME_MAX - 1);
+  file->device         = node;
+  file->ino            = node->inode;
+  file->uid            = node->uid;
+  file->gid            = node->gid;
+  file->mask           = node->mask;
+  file->length         = node->size;
+  file->flags          = node->flags;
+  file->atime          = node->atime;
+  file->mtime          = node->mtime;
+  file->ctime          = node->ctime;
+  file->nlink          = 1;
+  file->sys_operations = &tmpfs_sys_operations;
+  file->fs_operations  = &tmpfs_fs_operations;
+  list_head_init(&file->siblings);
+  // Add the file to the list of files opened on the node.
+  list_head_insert_before(&file->siblings, &node->files);
+  return file;
+}
+
+/// @brief Saves the information concerning the node.
+/// @param node the TMPFS node.
+/// @param stat the structure where the information are stored.
+/// @return 0 if success.
+static int __tmpfs_stat(tmpfs_node_t *node, stat_t *stat) {
+  stat->st_dev   = 0;
+  stat->st_ino   = node->inode;
+  stat->st_mode  = node->mask;
+  stat->st_mode |= bitmask_check(node->flags, DT_DIR) ? TMPFS_S_IFDIR :
+                                                        TMPFS_S_IFREG;
+  stat->st_uid   = node->uid;
+  stat->st_gid   = node->gid;
+  stat->st_size  = node->size;
+  stat->st_atime = node->atime;
+  stat->st_mtime = node->mtime;
+  stat->st_ctime = node->ctime;
+  return 0;
+}
+
+// ============================================================================
+// Virtual FileSystem (VFS) Functions
+// ============================================================================
+
+/// @brief Creates a new directory.
+/// @param path The path to the new directory.
+/// @param mode The file mode.
+/// @return 0 if success.
+static int tmpfs_mkdir(const char *path, mode_t mode) {
+  const char *relative_path;
+  tmpfs_t *fs = tmpfs_get_filesystem(path, &relative_path);
+  if (fs == NULL)
+    return -ENOENT;
+  char name[NAME_MAX];
+  tmpfs_node_t *parent;
+  int ret = 0;
+  spinlock_lock(&fs->spinlock);
+  if (tmpfs_resolve_path(fs, relative_path, &parent, name) != NULL) {
+    ret = -EEXIST;
+  } else if (parent == NULL) {
+    ret = -ENOENT;
+  } else if (!strcmp(name, PATH_DOT) || !strcmp(name, PATH_UP)) {
+    ret = -EPERM;
+  } else if (!tmpfs_create_node(fs, parent, name, DT_DIR, mode)) {
+    ret = -ENOSPC;
+  }
+  spinlock_unlock(&fs->spinlock);
+  return ret;
+}
+
+/// @brief Removes a directory.
+/// @param path The path to the directory.
+/// @return 0 if success.
+static int tmpfs_rmdir(const char *path) {
+  const char *relative_path;
+  tmpfs_t *fs = tmpfs_get_filesystem(path, &relative_path);
+  if (fs == NULL)
+    return -ENOENT;
+  int ret = 0;
+  spinlock_lock(&fs->spinlock);
+  tmpfs_node_t *node = tmpfs_resolve_path(fs, relative_path, NULL, NULL);
+  if (node == NULL) {
+    ret = -ENOENT;
+  } else if (!bitmask_check(node->flags, DT_DIR)) {
+    ret = -ENOTDIR;
+  } else if (node == fs->root) {
+    ret = -EBUSY;
+  } else if (!list_head_empty(&node->children)) {
+    ret = -ENOTEMPTY;
+  } else {
+    tmpfs_detach_node(node);
+  }
+  spinlock_unlock(&fs->spinlock);
+  return ret;
+}
+
+/// @brief Retrieves information concerning the file at the given position.
+/// @param path The path to the file.
+/// @param stat The structure where the information are stored.
+/// @return 0 if success.
+static int tmpfs_stat(const char *path, stat_t *stat) {
+  const char *relative_path;
+  tmpfs_t *fs = tmpfs_get_filesystem(path, &relative_path);
+  if (fs == NULL)
+    return -ENOENT;
+  tmpfs_node_t *node = tmpfs_resolve_path(fs, relative_path, NULL, NULL);
+  if (node == NULL)
+    return -ENOENT;
+  return __tmpfs_stat(node, stat);
+}
+
+/// @brief Creates a new file or rewrite an existing one.
+/// @param path path to the file.
+/// @param mode mode for file creation.
+/// @return the opened file, NULL otherwise and errno is set.
+/// @details
+/// It is equivalent to: open(path, O_WRONLY|O_CREAT|O_TRUNC, mode)
+static vfs_file_t *tmpfs_creat(const char *path, mode_t mode) {
+  return tmpfs_open(path, O_WRONLY | O_CREAT | O_TRUNC, mode);
+}
+
+/// @brief Open the file at the given path and returns its file descriptor.
+/// @param path  The path to the file.
+/// @param flags The flags used to determine the behavior of the function.
+/// @param mode  The mode with which we open the file.
+/// @return The opened file, NULL otherwise and errno is set.
+static vfs_file_t *tmpfs_open(const char *path, int flags, mode_t mode) {
+  dprintf("tmpfs_open(path: \"%s\", flags: %d, mode: %d)\n", path, flags, mode);
+  const char *relative_path;
+  tmpfs_t *fs = tmpfs_get_filesystem(path, &relative_path);
+  if (fs == NULL) {
+    errno = ENOENT;
+    return NULL;
+  }
+  char name[NAME_MAX];
+  tmpfs_node_t *parent;
+  vfs_file_t *file = NULL;
+  spinlock_lock(&fs->spinlock);
+  tmpfs_node_t *node = tmpfs_resolve_path(fs, relative_path, &parent, name);
+  if (node != NULL) {
+    // The file must not exist only if both O_CREAT and O_EXCL are given.
+    if ((flags & (O_CREAT | O_EXCL)) == (O_CREAT | O_EXCL)) {
+      errno = EEXIST;
+      goto unlock_return;
+    }
+    if (bitmask_check(node->flags, DT_DIR)) {
+      // A directory cannot be opened for writing.
+      if (bitmask_check(flags, O_WRONLY) || bitmask_check(flags, O_RDWR)) {
+        errno = EISDIR;
+        goto unlock_return;
+      }
+    } else if (bitmask_check(flags, O_DIRECTORY)) {
+      errno = ENOTDIR;
+      goto unlock_return;
+    } else if (bitmask_check(flags, O_TRUNC) &&
+               (bitmask_check(flags, O_WRONLY) ||
+                bitmask_check(flags, O_RDWR))) {
+      tmpfs_truncate(node, 0);
+    }
+  } else {
+    //  When both O_CREAT and O_DIRECTORY are specified in flags and the file
+    //  specified by pathname does not exist, open() will create a regular file
+    //  (i.e., O_DIRECTORY is ignored).
+    if (!bitmask_check(flags, O_CREAT) || (parent == NULL)) {
+      errno = ENOENT;
+      goto unlock_return;
+    }
+    node = tmpfs_create_node(fs, parent, name, DT_REG, mode);
+    if (node == NULL) {
+      errno = ENOSPC;
+      goto unlock_return;
+    }
+  }
+  // Create the associated file.
+  file = tmpfs_create_file_struct(node, path);
+  if (file == NULL) {
+    errno = ENFILE;
+    goto unlock_return;
+  }
+  // Update file access.
+  node->atime = sys_time(NULL);
+unlock_return:
+  spinlock_unlock(&fs->spinlock);
+  return file;
+}
+
+/// @brief Deletes the file at the given path.
+/// @param path The path to the file.
+/// @return 0 on success, a negative errno value otherwise.
+/// @details If the file is still opened, its content is released by the
+/// last close.
+static int tmpfs_unlink(const char *path) {
+  const char *relative_path;
+  tmpfs_t *fs = tmpfs_get_filesystem(path, &relative_path);
+  if (fs == NULL)
+    return -ENOENT;
+  int ret = 0;
+  spinlock_lock(&fs->spinlock);
+  tmpfs_node_t *node = tmpfs_resolve_path(fs, relative_path, NULL, NULL);
+  if (node == NULL) {
+    ret = -ENOENT;
+  } else if (bitmask_check(node->flags, DT_DIR)) {
+    ret = -EISDIR;
+  } else {
+    tmpfs_detach_node(node);
+  }
+  spinlock_unlock(&fs->spinlock);
+  return ret;
+}
+
+/// @brief Closes the given file.
+/// @param file The file structure.
+/// @return 0 on success.
+static int tmpfs_close(vfs_file_t *file) {
+  tmpfs_node_t *node = tmpfs_get_node(file);
+  assert(node && "Received an invalid tmpfs file.");
+  tmpfs_t *fs = node->fs;
+  spinlock_lock(&fs->spinlock);
+  list_head_remove(&file->siblings);
+  // Release nodes that were unlinked while opened.
+  if ((node->parent == NULL) && (node != fs->root) &&
+      list_head_empty(&node->files))
+    tmpfs_destroy_node(node);
+  spinlock_unlock(&fs->spinlock);
+  kfree(file);
+  return 0;
+}
+
+/// @brief Reads from the file.
+/// @param file The file.
+/// @param buffer Buffer where the read content must be placed.
+/// @param offset Offset from which we start reading from the file.
+/// @param nbyte The number of bytes to read.
+/// @return The number of read bytes, or a negative errno value.
+static ssize_t tmpfs_read(vfs_file_t *file, char *buffer, off_t offset,
+                          size_t nbyte) {
+  tmpfs_node_t *node = tmpfs_get_node(file);
+  if (node == NULL)
+    return -EBADF;
+  if (bitmask_check(node->flags, DT_DIR))
+    return -EISDIR;
+  if ((offset < 0) || ((size_t)offset >= node->size))
+    return 0;
+  nbyte       = min(nbyte, node->size - offset);
+  size_t read = 0, page_offset, chunk;
+  while (read < nbyte) {
+    page_offset = (offset + read) % PAGE_SIZE;
+    chunk       = min(PAGE_SIZE - page_offset, nbyte - read);
+    if (tmpfs_copy_page(node, (offset + read) / PAGE_SIZE, page_offset,
+                        buffer + read, chunk, false))
+      break;
+    read += chunk;
+  }
+  node->atime = sys_time(NULL);
+  return read;
+}
+
+/// @brief Writes the given content inside the file.
+/// @param file The file.
+/// @param buffer The content to write.
+/// @param offset Offset from which we start writing in the file.
+/// @param nbyte The number of bytes to write.
+/// @return The number of written bytes, or a negative errno value.
+static ssize_t tmpfs_write(vfs_file_t *file, const void *buffer, off_t offset,
+                           size_t nbyte) {
+  tmpfs_node_t *node = tmpfs_get_node(file);
+  if (node == NULL)
+    return -EBADF;
+  if (bitmask_check(node->flags, DT_DIR))
+    return -EISDIR;
+  if (offset < 0)
+    return -EINVAL;
+  size_t written = 0, page_offset, chunk;
+  spinlock_lock(&node->fs->spinlock);
+  while (written < nbyte) {
+    page_offset = (offset + written) % PAGE_SIZE;
+    chunk       = min(PAGE_SIZE - page_offset, nbyte - written);
+    if (tmpfs_copy_page(node, (offset + written) / PAGE_SIZE, page_offset,
+                        (char *)buffer + written, chunk, true))
+      break;
+    written += chunk;
+  }
+  if (written) {
+    node->size   = max(node->size, offset + written);
+    node->mtime  = sys_time(NULL);
+    file->length = node->size;
+  }
+  spinlock_unlock(&node->fs->spinlock);
+  if ((written == 0) && (nbyte > 0))
+    return -ENOSPC;
+  return written;
+}
+
+/// @brief Repositions the file offset inside a file.
+/// @param file the file we are working with.
+/// @param offset the offest to use for the operation.
+/// @param whence the type of operation.
+/// @return the resulting offset, or a negative errno value.
+static off_t tmpfs_lseek(vfs_file_t *file, off_t offset, int whence) {
+  tmpfs_node_t *node = tmpfs_get_node(file);
+  if (node == NULL)
+    return -EBADF;
+  switch (whence) {
+    case SEEK_END:
+      offset += node->size;
+      break;
+    case SEEK_CUR:
+      offset += file->f_pos;
+      break;
+    case SEEK_SET:
+      break;
+    default:
+      return -EINVAL;
+  }
+  if (offset < 0)
+    return -EINVAL;
+  file->f_pos = offset;
+  return offset;
+}
+
+/// @brief Retrieves information concerning the file.
+/// @param file The file struct.
+/// @param stat The structure where the information are stored.
+/// @return 0 if success.
+static int tmpfs_fstat(vfs_file_t *file, stat_t *stat) {
+  tmpfs_node_t *node = tmpfs_get_node(file);
+  if (node == NULL)
+    return -EBADF;
+  return __tmpfs_stat(node, stat);
+}
+
+/// @brief Perform the I/O control operation specified by REQUEST on FD.
+/// @param file the file.
+/// @param request the device-dependent request code.
+/// @param data an untyped pointer to memory.
+/// @return -ENOTTY, there are no control operations on tmpfs files.
+static int tmpfs_ioctl(vfs_file_t *file, int request, void *data) {
+  return -ENOTTY;
+}
+
+/// @brief Fills a directory entry, and optionally its information.
+/// @param entry the entry, a `dirent_t` or a `direntplus_t`.
+/// @param node the node the entry refers to.
+/// @param name the name of the entry.
+/// @param entry_size the size of the entry.
+/// @param plus if `entry` is a `direntplus_t`.
+static inline void __tmpfs_fill_dirent(char *entry, tmpfs_node_t *node,
+                                       const char *name, size_t entry_size,
+                                       bool_t plus) {
+  dirent_t *dirp = (dirent_t *)entry;
+  dirp->d_ino    = node->inode;
+  dirp->d_type   = node->flags;
+  strncpy(dirp->d_name, name, NAME_MAX - 1);
+  dirp->d_off    = entry_size;
+  dirp->d_reclen = entry_size;
+  if (plus)
+    __tmpfs_stat(node, &((direntplus_t *)entry)->d_stat);
+}
+
+/// @brief Writes the entries of the directory inside the buffer.
+/// @param file the directory handler.
+/// @param buffer the buffer where the entries are written.
+/// @param entry_size the size of an entry inside the buffer.
+/// @param doff the offset, in bytes, of the first entry to provide.
+/// @param count the size of the buffer.
+/// @param plus if the entries are `direntplus_t`.
+/// @return the number of written bytes, or a negative errno value.
+static int __tmpfs_getdents(vfs_file_t *file, char *buffer, size_t entry_size,
+                            off_t doff, size_t count, bool_t plus) {
+  tmpfs_node_t *directory = tmpfs_get_node(file);
+  if ((directory == NULL) || (buffer == NULL))
+    return -EBADF;
+  if (!bitmask_check(directory->flags, DT_DIR))
+    return -ENOTDIR;
+  memset(buffer, 0, count);
+  // The entries we already provided.
+  off_t skip     = doff / entry_size, current = 0;
+  size_t written = 0;
+  spinlock_lock(&directory->fs->spinlock);
+  // The root of the filesystem is its own parent.
+  tmpfs_node_t *parent = directory->parent ? directory->parent : directory;
+  if ((current++ >= skip) && (written + entry_size <= count)) {
+    __tmpfs_fill_dirent(buffer + written, directory, PATH_DOT, entry_size, plus);
+    written += entry_size;
+  }
+  if ((current++ >= skip) && (written + entry_size <= count)) {
+    __tmpfs_fill_dirent(buffer + written, parent, PATH_UP, entry_size, plus);
+    written += entry_size;
+  }
+  tmpfs_node_t *child;
+  list_for_each_decl(it, &directory->children) {
+    if (written + entry_size > count)
+      break;
+    // Skip if already provided.
+    if (current++ < skip)
+      continue;
+    child = list_entry(it, tmpfs_node_t, siblings);
+    __tmpfs_fill_dirent(buffer + written, child, child->name, entry_size, plus);
+    written += entry_size;
+  }
+  directory->atime = sys_time(NULL);
+  spinlock_unlock(&directory->fs->spinlock);
+  return written;
+}
+
+/// @brief Reads contents of the directories to a dirent buffer.
+/// @param file  The directory handler.
+/// @param dirp  The buffer where the data should be written.
+/// @param doff  The offset inside the buffer where the data should be written.
+/// @param count The maximum length of the buffer.
+/// @return The number of written bytes in the buffer.
+static int tmpfs_getdents(vfs_file_t *file, dirent_t *dirp, off_t doff,
+                          size_t count) {
+  return __tmpfs_getdents(file, (char *)dirp, sizeof(dirent_t), doff, count,
+                          false);
+}
+
+/// @brief Reads contents of the directories, together with the information
+///        of each entry.
+/// @param file  The directory handler.
+/// @param dirp  The buffer where the data should be written.
+/// @param doff  The offset inside the buffer where the data should be written.
+/// @param count The maximum length of the buffer.
+/// @return The number of written bytes in the buffer.
+static int tmpfs_getdentsplus(vfs_file_t *file, direntplus_t *dirp, off_t doff,
+                              size_t count) {
+  return __tmpfs_getdents(file, (char *)dirp, sizeof(direntplus_t), doff, count,
+                          true);
+}
+
+// ============================================================================
+// Initialization Functions
+// ============================================================================
+
+/// @brief Parses the mount options, i.e., `size=<n>[k|m]`.
+/// @param args the mount options, can be NULL.
+/// @return the maximum number of pages, by default half of the physical
+///   memory.
+static size_t tmpfs_parse_size(const char *args) {
+  size_t pages = 0;
+  if (args && !strncmp(args, "size=", 5)) {
+    char *end;
+    size_t size = strtol(args + 5, &end, 10);
+    if ((*end == 'k') || (*end == 'K'))
+      size *= 1024;
+    else if ((*end == 'm') || (*end == 'M'))
+      size *= 1024 * 1024;
+    pages = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+  }
+  return pages ? pages : (get_total_frames() / TMPFS_DEFAULT_SIZE_RATIO);
+}
+
+/// @brief Mounts a new tmpfs at the given path.
+/// @param path the path where we want to mount the tmpfs.
+/// @param args the mount options, NULL or `size=<n>[k|m]`.
+/// @return a pointer to the root VFS file.
+static vfs_file_t *tmpfs_mount_callback(const char *path, const char *args) {
+  dprintf("tmpfs_mount_callback(%s, %s)\n", path, args);
+  tmpfs_t *fs = kmalloc(sizeof(tmpfs_t));
+  if (fs == NULL) {
+    dprintf("Failed to allocate the tmpfs for `%s`.\n", path);
+    return NULL;
+  }
+  memset(fs, 0, sizeof(tmpfs_t));
+  spinlock_init(&fs->spinlock);
+  fs->next_inode = 1;
+  fs->max_pages  = tmpfs_parse_size(args);
+  // Create the root directory, world writable with the sticky bit.
+  fs->root = tmpfs_create_node(fs, NULL, PATH_SEPARATOR_STRING, DT_DIR,
+                               S_ISVTX | S_IRWXU | S_IRWXG | S_IRWXO);
+  if (fs->root == NULL) {
+    kfree(fs);
+    return NULL;
+  }
+  // Create the file used as superblock root, it is never closed.
+  vfs_file_t *file = tmpfs_create_file_struct(fs->root, path);
+  if (file == NULL) {
+    tmpfs_destroy_node(fs->root);
+    kfree(fs);
+    return NULL;
+  }
+  return file;
+}
+
+/// Filesystem information.
+static file_system_type tmpfs_file_system_type = {
+  .name     = TMPFS,
+  .fs_flags = 0,
+  .mount    = tmpfs_mount_callback,
+};
+
+int tmpfs_init() {
+  // Register the filesystem.
+  vfs_register_filesystem(&tmpfs_file_system_type);
+  return 0;
+}
+
+int tmpfs_cleanup() {
+  // Unregister the filesystem.
+  vfs_unregister_filesystem(&tmpfs_file_system_type);
+  return 0;
+}
@@ -12,6 +12,7 @@
 #include <kernel/spinlock.h>
 #include <kernel/strerror.h>
 #include <kernel/hashmap.h>
+#include <kernel/math.h>
 #include <kernel/string.h>
 #include <kernel/libgen.h>
 #include <kernel/stdio.h>
@@ -22,6 +23,10 @@
 static hashmap_t *vfs_filesystems;
 /// The list of superblocks.
 static list_head vfs_super_blocks;
+/// The number of buckets of the children hashmap of a mount tree node.
+static const unsigned vfs_mount_children_max = 8;
+/// The root of the mount tree.
+static struct vfs_mount_node_t *vfs_mount_root;
 /// The maximum number of filesystem types.
 static const unsigned vfs_filesystems_max = 10;
 /// Lock for refcount field.
@@ -34,6 +39,59 @@ static spinlock_t vfs_spinlock;
 /// VFS memory cache for files.
 // kmem_cache_t *vfs_file_cache;
 
+/// @brief A node of the mount tree, there is one for each component of the
+///        path of a mount point.
+typedef struct vfs_mount_node_t {
+  /// The name of the path component.
+  char name[NAME_MAX];
+  /// The superblock mounted on this node, NULL if none is mounted here.
+  super_block_t *sb;
+  /// The parent node, NULL for the root.
+  struct vfs_mount_node_t *parent;
+  /// The children of the node, indexed by their name.
+  hashmap_t *children;
+} vfs_mount_node_t;
+
+/// @brief Allocates a new node of the mount tree.
+/// @param name the name of the path component.
+/// @param len the length of the name.
+/// @return a pointer to the new node, NULL on failure.
+static inline vfs_mount_node_t *__vfs_mount_node_alloc(const char *name,
+                                                       size_t len) {
+  vfs_mount_node_t *node = kmalloc(sizeof(vfs_mount_node_t));
+  if (node == NULL) {
+    return NULL;
+  }
+  memset(node, 0, sizeof(vfs_mount_node_t));
+  // Copy the name.
+  strncpy(node->name, name, min(len, NAME_MAX - 1));
+  // Allocate the hashmap for the children, the keys are the names stored
+  // inside the nodes themselves.
+  node->children = hashmap_create(vfs_mount_children_max, hashmap_str_hash,
+                                  hashmap_str_comp, hashmap_do_not_duplicate,
+                                  hashmap_do_not_free);
+  return node;
+}
+
+/// @brief Extracts the next component from the path.
+/// @param path the pointer to the path, moved after the component.
+/// @param component the buffer where the component is copied.
+/// @return the length of the component, 0 if there are no more components.
+static inline size_t __vfs_next_component(const char **path, char *component) {
+  size_t len = 0;
+  // Skip the separators.
+  while (**path == PATH_SEPARATOR) { ++(*path); }
+  // Copy the component.
+  while ((**path != '\0') && (**path != PATH_SEPARATOR)) {
+    if (len < (NAME_MAX - 1)) {
+      component[len++] = **path;
+    }
+    ++(*path);
+  }
+  component[len] = '\0';
+  return len;
+}
+
 void vfs_init() {
   // Initialize the list of superblocks.
   list_head_init(&vfs_super_blocks);
@@ -44,6 +102,8 @@ void vfs_init() {
   vfs_filesystems = hashmap_create(vfs_filesystems_max, hashmap_str_hash,
                                    hashmap_str_comp, hashmap_do_not_duplicate,
                                    hashmap_do_not_free);
+  // Allocate the root of the mount tree.
+  vfs_mount_root = __vfs_mount_node_alloc(PATH_SEPARATOR_STRING, 1);
   // Initialize the spinlock.
   spinlock_init(&vfs_spinlock);
   spinlock_init(&vfs_spinlock_refcount);
@@ -67,47 +127,107 @@ int vfs_unregister_filesystem(file_system_type *fs) {
 }
 
 super_block_t *vfs_get_superblock(const char *absolute_path) {
-  size_t last_sb_len     = 0;
-  super_block_t *last_sb = NULL, *superblock = NULL;
-  list_head *it;
-  list_for_each(it, &vfs_super_blocks) {
-    superblock = list_entry(it, super_block_t, mounts);
-#if 0
-        int len    = strlen(superblock->name);
-        dprintf("`%s` vs `%s`\n", absolute_path, superblock->name);
-        if (!strncmp(absolute_path, superblock->name, len)) {
-            size_t sbl = strlen(superblock->name);
-            if (sbl > last_sb_len) {
-                last_sb_len = sbl;
-                last_sb     = superblock;
-            }
+  char component[NAME_MAX];
+  vfs_mount_node_t *node = vfs_mount_root;
+  // The deepest superblock we met so far.
+  super_block_t *last_sb = node->sb;
+  // Walk down the mount tree, one component of the path at a time.
+  while (__vfs_next_component(&absolute_path, component)) {
+    node = (vfs_mount_node_t *)hashmap_get(node->children, component);
+    if (node == NULL) {
+      break;
+    }
+    if (node->sb) {
+      last_sb = node->sb;
+    }
+  }
+  return last_sb;
+}
+
+/// @brief Resolves the absolute path and the superblock of the given path.
+/// @details The path is normalized (`.`, `..` and repeated separators) and
+/// the mount tree is walked in the same pass, one component at a time, so the
+/// superblock comes for free with the absolute path.
+/// @param path the path to resolve.
+/// @param absolute_path the buffer where the absolute path is stored.
+/// @return the superblock where the path resides, NULL on failure (errno is
+/// set to ENODEV if the path cannot be resolved, ENOENT if nothing is mounted).
+static inline super_block_t *vfs_resolve_superblock(const char *path,
+                                                    char *absolute_path) {
+  char component[NAME_MAX];
+  // Relative paths start from the working directory, already absolute.
+  const char *parts[2] = { NULL, path };
+  if (path[0] != PATH_SEPARATOR) {
+    task_struct *current = scheduler_get_current_process();
+    if (current == NULL) {
+      errno = ENODEV;
+      return NULL;
+    }
+    parts[0] = current->cwd;
+  }
+  vfs_mount_node_t *node = vfs_mount_root, *child;
+  // Number of components past the deepest node of the mount tree we reached.
+  unsigned outside = 0;
+  size_t len = 0, component_len;
+  for (int i = 0; i < 2; ++i) {
+    const char *it = parts[i];
+    if (it == NULL) {
+      continue;
+    }
+    while ((component_len = __vfs_next_component(&it, component))) {
+      if (strcmp(component, ".") == 0) {
+        continue;
+      }
+      if (strcmp(component, "..") == 0) {
+        // Drop the last component of the path, and go up in the tree.
+        while (len && (absolute_path[len - 1] != PATH_SEPARATOR)) { --len; }
+        if (len) {
+          --len;
+        }
+        if (outside) {
+          --outside;
+        } else if (node->parent) {
+          node = node->parent;
         }
-#else
-    int len = strlen(superblock->path);
-    if (!strncmp(absolute_path, superblock->path, len)) {
-      if (len > last_sb_len) {
-        last_sb_len = len;
-        last_sb     = superblock;
+        continue;
+      }
+      // Append the component.
+      if ((len + 1 + component_len) >= PATH_MAX) {
+        errno = ENODEV;
+        return NULL;
+      }
+      absolute_path[len++] = PATH_SEPARATOR;
+      memcpy(absolute_path + len, component, component_len);
+      len += component_len;
+      // Go down in the tree, while the path follows it.
+      if (!outside &&
+          (child = (vfs_mount_node_t *)hashmap_get(node->children, component))) {
+        node = child;
+      } else {
+        ++outside;
       }
     }
-#endif
   }
-  return last_sb;
+  // The root has no components.
+  if (len == 0) {
+    absolute_path[len++] = PATH_SEPARATOR;
+  }
+  absolute_path[len] = '\0';
+  // The path resides in the deepest superblock mounted along it.
+  while (!node->sb && node->parent) { node = node->parent; }
+  if (node->sb == NULL) {
+    errno = ENOENT;
+  }
+  return node->sb;
 }
 
 vfs_file_t *vfs_open(const char *path, int flags, mode_t mode) {
   // Allocate a variable for the path.
   char absolute_path[PATH_MAX];
-  // If the first character is not the '/' then get the absolute path.
-  if (!realpath(path, absolute_path)) {
-    dprintf("vfs_open(%s): Cannot get the absolute path!\n", path);
-    errno = ENODEV;
-    return NULL;
-  }
-  super_block_t *sb = vfs_get_superblock(absolute_path);
+  // Get the absolute path, and the superblock where it resides.
+  super_block_t *sb = vfs_resolve_superblock(path, absolute_path);
   if (sb == NULL) {
     dprintf("vfs_open(%s): Cannot find the superblock!\n", path);
-    errno = ENOENT;
     return NULL;
   }
   vfs_file_t *sb_root = sb->root;
@@ -186,6 +306,15 @@ int vfs_getdents(vfs_file_t *file, dirent_t *dirp, off_t off, size_t count) {
   return file->fs_operations->getdents_f(file, dirp, off, count);
 }
 
+int vfs_getdentsplus(vfs_file_t *file, direntplus_t *dirp, off_t off,
+                     size_t count) {
+  if (file->fs_operations->getdentsplus_f == NULL) {
+    dprintf("No GETDENTSPLUS function found for the current filesystem.\n");
+    return -ENOSYS;
+  }
+  return file->fs_operations->getdentsplus_f(file, dirp, off, count);
+}
+
 int vfs_ioctl(vfs_file_t *file, int request, void *data) {
   if (file->fs_operations->ioctl_f == NULL) {
     dprintf("No IOCTL function found for the current filesystem.\n");
@@ -197,12 +326,8 @@ int vfs_ioctl(vfs_file_t *file, int request, void *data) {
 int vfs_unlink(const char *path) {
   // Allocate a variable for the path.
   char absolute_path[PATH_MAX];
-  // If the first character is not the '/' then get the absolute path.
-  if (!realpath(path, absolute_path)) {
-    dprintf("vfs_unlink(%s): Cannot get the absolute path.", path);
-    return -ENODEV;
-  }
-  super_block_t *sb = vfs_get_superblock(absolute_path);
+  // Get the absolute path, and the superblock where it resides.
+  super_block_t *sb = vfs_resolve_superblock(path, absolute_path);
   if (sb == NULL) {
     dprintf("vfs_unlink(%s): Cannot find the superblock!\n", path);
     return -ENODEV;
@@ -224,12 +349,8 @@ int vfs_unlink(const char *path) {
 int vfs_mkdir(const char *path, mode_t mode) {
   // Allocate a variable for the path.
   char absolute_path[PATH_MAX];
-  // If the first character is not the '/' then get the absolute path.
-  if (!realpath(path, absolute_path)) {
-    dprintf("vfs_mkdir(%s): Cannot get the absolute path.", path);
-    return -ENODEV;
-  }
-  super_block_t *sb = vfs_get_superblock(absolute_path);
+  // Get the absolute path, and the superblock where it resides.
+  super_block_t *sb = vfs_resolve_superblock(path, absolute_path);
   if (sb == NULL) {
     dprintf("vfs_mkdir(%s): Cannot find the superblock!\n", path);
     return -ENODEV;
@@ -251,12 +372,8 @@ int vfs_mkdir(const char *path, mode_t mode) {
 int vfs_rmdir(const char *path) {
   // Allocate a variable for the path.
   char absolute_path[PATH_MAX];
-  // If the first character is not the '/' then get the absolute path.
-  if (!realpath(path, absolute_path)) {
-    dprintf("vfs_rmdir(%s): Cannot get the absolute path.", path);
-    return -ENODEV;
-  }
-  super_block_t *sb = vfs_get_superblock(absolute_path);
+  // Get the absolute path, and the superblock where it resides.
+  super_block_t *sb = vfs_resolve_superblock(path, absolute_path);
   if (sb == NULL) {
     dprintf("vfs_rmdir(%s): Cannot find the superblock!\n", path);
     return -ENODEV;
@@ -279,13 +396,8 @@ int vfs_rmdir(const char *path) {
 vfs_file_t *vfs_create(const char *path, mode_t mode) {
   // Allocate a variable for the path.
   char absolute_path[PATH_MAX];
-  // If the first character is not the '/' then get the absolute path.
-  if (!realpath(path, absolute_path)) {
-    dprintf("vfs_creat(%s): Cannot get the absolute path.", path);
-    errno = ENODEV;
-    return NULL;
-  }
-  super_block_t *sb = vfs_get_superblock(absolute_path);
+  // Get the absolute path, and the superblock where it resides.
+  super_block_t *sb = vfs_resolve_superblock(path, absolute_path);
   if (sb == NULL) {
     dprintf("vfs_creat(%s): Cannot find the superblock!\n", path);
     errno = ENODEV;
@@ -321,12 +433,8 @@ vfs_file_t *vfs_create(const char *path, mode_t mode) {
 int vfs_stat(const char *path, stat_t *buf) {
   // Allocate a variable for the path.
   char absolute_path[PATH_MAX];
-  // If the first character is not the '/' then get the absolute path.
-  if (!realpath(path, absolute_path)) {
-    dprintf("vfs_stat(%s): Cannot get the absolute path.", path);
-    return -ENODEV;
-  }
-  super_block_t *sb = vfs_get_superblock(absolute_path);
+  // Get the absolute path, and the superblock where it resides.
+  super_block_t *sb = vfs_resolve_superblock(path, absolute_path);
   if (sb == NULL) {
     dprintf("vfs_stat(%s): Cannot find the superblock!\n", path);
     return -ENODEV;
@@ -387,11 +495,30 @@ int vfs_mount(const char *path, vfs_file_t *new_fs_root) {
   spinlock_lock(&vfs_spinlock);
   dprintf("Mounting file with path `%s` as root '%s'...\n", new_fs_root->name,
           path);
+  // Find the node of the mount tree, creating the missing ones.
+  char component[NAME_MAX];
+  const char *it         = path;
+  vfs_mount_node_t *node = vfs_mount_root, *child;
+  while (__vfs_next_component(&it, component)) {
+    child = (vfs_mount_node_t *)hashmap_get(node->children, component);
+    if (child == NULL) {
+      child = __vfs_mount_node_alloc(component, strlen(component));
+      if (child == NULL) {
+        dprintf("Cannot allocate memory for the mount tree.\n");
+        spinlock_unlock(&vfs_spinlock);
+        return 0;
+      }
+      child->parent = node;
+      hashmap_set(node->children, child->name, child);
+    }
+    node = child;
+  }
   // Create the superblock.
   // super_block_t *sb = kmem_cache_alloc(vfs_superblock_cache, GFP_KERNEL);
   super_block_t *sb = kmalloc(sizeof(super_block_t));
   if (!sb) {
     dprintf("Cannot allocate memory for the superblock.\n");
+    spinlock_unlock(&vfs_spinlock);
     return 0;
   } else {
     // Copy the name.
@@ -402,6 +529,8 @@ int vfs_mount(const char *path, vfs_file_t *new_fs_root) {
     sb->root = new_fs_root;
     // Add to the list.
     list_head_insert_after(&sb->mounts, &vfs_super_blocks);
+    // Attach it to the mount tree, hiding the one previously mounted here.
+    node->sb = sb;
   }
   spinlock_unlock(&vfs_spinlock);
   dprintf("Correctly mounted '%s' on '%s'...\n", new_fs_root->name, path);
@@ -453,8 +582,9 @@ int vfs_extend_task_fd_list(struct task_struct *task) {
     errno = ESRCH;
     return 0;
   }
+  files_struct_t *files = task->files;
   // Set the max number of file descriptors.
-  int new_max_fd = (task->fd_list) ? task->max_fd * 2 + 1 : MAX_OPEN_FD;
+  int new_max_fd = (files->fd_list) ? files->max_fd * 2 + 1 : MAX_OPEN_FD;
   // Allocate the memory for the list.
   void *new_fd_list = kmalloc(new_max_fd * sizeof(vfs_file_descriptor_t));
   // Check the new list.
@@ -464,28 +594,47 @@ int vfs_extend_task_fd_list(struct task_struct *task) {
     return 0;
   }
   // Clear the memory of the new list.
-  memset(new_fd_list, 0, task->max_fd * sizeof(vfs_file_descriptor_t));
+  memset(new_fd_list, 0, new_max_fd * sizeof(vfs_file_descriptor_t));
   // Deal with pre-existing list.
-  if (task->fd_list) {
+  if (files->fd_list) {
     // Copy the old entries.
-    memcpy(new_fd_list, task->fd_list,
-           task->max_fd * sizeof(vfs_file_descriptor_t));
+    memcpy(new_fd_list, files->fd_list,
+           files->max_fd * sizeof(vfs_file_descriptor_t));
     // Free the memory of the old list.
-    kfree(task->fd_list);
+    kfree(files->fd_list);
   }
   // Set the new maximum number of file descriptors.
-  task->max_fd = new_max_fd;
+  files->max_fd = new_max_fd;
   // Set the new list.
-  task->fd_list = new_fd_list;
+  files->fd_list = new_fd_list;
   return 1;
 }
 
+/// @brief Allocates an empty file descriptor table, used by a single task.
+/// @return The table, NULL on failure.
+static inline files_struct_t *__vfs_alloc_files(void) {
+  files_struct_t *files = kmalloc(sizeof(files_struct_t));
+  if (!files) {
+    dprintf("Failed to allocate memory for the file descriptor table.\n");
+    errno = ENOMEM;
+    return NULL;
+  }
+  files->count   = 1;
+  files->fd_list = NULL;
+  files->max_fd  = 0;
+  return files;
+}
+
 int vfs_init_task(task_struct *task) {
   if (!task) {
     dprintf("Null process.\n");
     errno = ESRCH;
     return 0;
   }
+  // Allocate the file descriptor table.
+  if (!(task->files = __vfs_alloc_files())) {
+    return 0;
+  }
   // Initialize the file descriptor list.
   if (!vfs_extend_task_fd_list(task)) {
     dprintf(
@@ -503,19 +652,24 @@ int vfs_init_task(task_struct *task) {
 }
 
 int vfs_dup_task(task_struct *task, task_struct *old_task) {
+  // Allocate the file descriptor table.
+  if (!(task->files = __vfs_alloc_files())) {
+    return 0;
+  }
+  files_struct_t *files = task->files;
   // Copy the maximum number of file descriptors.
-  task->max_fd = old_task->max_fd;
+  files->max_fd = old_task->files->max_fd;
   // Allocate the memory for the new list.
-  task->fd_list = kmalloc(task->max_fd * sizeof(vfs_file_descriptor_t));
+  files->fd_list = kmalloc(files->max_fd * sizeof(vfs_file_descriptor_t));
   // Copy the old list.
-  memcpy(task->fd_list, old_task->fd_list,
-         task->max_fd * sizeof(vfs_file_descriptor_t));
+  memcpy(files->fd_list, old_task->files->fd_list,
+         files->max_fd * sizeof(vfs_file_descriptor_t));
   // Increase the counters to the open files.
-  for (int fd = 0; fd < task->max_fd; fd++) {
+  for (int fd = 0; fd < files->max_fd; fd++) {
     // Check if the file descriptor is associated with a file.
-    if (task->fd_list[fd].file_struct) {
+    if (files->fd_list[fd].file_struct) {
       // Increase the counter.
-      ++task->fd_list[fd].file_struct->count;
+      ++files->fd_list[fd].file_struct->count;
     }
   }
   // Create the proc entry.
@@ -527,25 +681,42 @@ int vfs_dup_task(task_struct *task, task_struct *old_task) {
   return 1;
 }
 
+int vfs_share_task(task_struct *task, task_struct *old_task) {
+  // Both tasks use the same table, so the open files are not touched.
+  task->files = old_task->files;
+  ++task->files->count;
+  // Create the proc entry.
+  if (procr_create_entry_pid(task)) {
+    dprintf("Error while trying to create proc entry for '%d': %s\n", task->pid,
+            strerror(errno));
+    return 0;
+  }
+  return 1;
+}
+
 int vfs_destroy_task(task_struct *task) {
-  // Decrease the counters to the open files.
-  for (int fd = 0; fd < task->max_fd; fd++) {
-    // Check if the file descriptor is associated with a file.
-    if (task->fd_list[fd].file_struct) {
-      // Decrease the counter.
-      --task->fd_list[fd].file_struct->count;
-      // If counter is zero, close the file.
-      if (task->fd_list[fd].file_struct->count == 0)
-        task->fd_list[fd].file_struct->fs_operations->close_f(
-          task->fd_list[fd].file_struct);
-      // Clear the pointer to the file structure.
-      task->fd_list[fd].file_struct = NULL;
+  files_struct_t *files = task->files;
+  // Only the last task using the table closes the files.
+  if (files && (--files->count == 0)) {
+    // Decrease the counters to the open files.
+    for (int fd = 0; fd < files->max_fd; fd++) {
+      // Check if the file descriptor is associated with a file.
+      if (files->fd_list[fd].file_struct) {
+        // Decrease the counter.
+        --files->fd_list[fd].file_struct->count;
+        // If counter is zero, close the file.
+        if (files->fd_list[fd].file_struct->count == 0)
+          files->fd_list[fd].file_struct->fs_operations->close_f(
+            files->fd_list[fd].file_struct);
+        // Clear the pointer to the file structure.
+        files->fd_list[fd].file_struct = NULL;
+      }
     }
+    // Free the memory of the list, and of the table.
+    kfree(files->fd_list);
+    kfree(files);
   }
-  // Set the maximum file descriptors to 0.
-  task->max_fd = 0;
-  // Free the memory of the list.
-  kfree(task->fd_list);
+  task->files = NULL;
   // Remove the proc entry.
   if (procr_destroy_entry_pid(task)) {
     dprintf("Error while trying to remove proc entry for '%d': %s\n", task->pid,
@@ -6,6 +6,7 @@
 #include <kernel/process/elf.h>
 #include <kernel/system/signal.h>
 #include <kernel/system/syscall.h>
+#include <kernel/system/vdso.h>
 #include <kernel/memory/mmu.h>
 
 #include <kernel/drivers/video.h>
@@ -15,8 +16,12 @@
 
 #include <kernel/fs/vfs.h>
 #include <kernel/fs/procfs.h>
+#include <kernel/fs/tmpfs.h>
 #include <kernel/fs/modules.h>
 #include "kernel/fs/ata.h"
+#include "kernel/fs/ahci.h"
+#include "kernel/fs/virtio_blk.h"
+#include "kernel/fs/ramdisk.h"
 #include "kernel/fs/ext2.h"
 
 #include <kernel/printf.h>
@@ -35,22 +40,54 @@ int kinit(boot_info_t *_boot_info) {
   dprintf("Initialize the filesystem...\n");
   vfs_init();
 
+  dprintf("Initialize EXT2 filesystem...\n");
+  if (ext2_init()) {
+    dprintf("Failed to initialize EXT2 filesystem!\n");
+    return 1;
+  }
+
+  // When the bootloader provides an initrd, it is mounted as root before the
+  // disk is brought up, so that the kernel has a root filesystem even when
+  // there is no disk, or its driver fails.
+  dprintf("Initialize the initial ramdisk...\n");
+  bool_t has_initrd = !initrd_init(boot_info);
+  if (has_initrd) {
+    dprintf("Mount the initial ramdisk...\n");
+    if (do_mount(EXT2, "/", "/dev/initrd")) {
+      dprintf("Failed to mount the initial ramdisk...\n");
+      return 1;
+    }
+  }
+
   dprintf("Initialize ATA devices...\n");
   if (ata_init()) {
     dprintf("Failed to initialize ATA devices!\n");
-    return 1;
+    if (!has_initrd)
+      return 1;
   }
 
-  dprintf("Initialize EXT2 filesystem...\n");
-  if (ext2_init()) {
-    dprintf("Failed to initialize EXT2 filesystem!\n");
-    return 1;
+  dprintf("Initialize AHCI devices...\n");
+  if (ahci_init()) {
+    dprintf("No AHCI devices initialized.\n");
+  }
+
+  dprintf("Initialize virtio-blk devices...\n");
+  if (virtio_blk_init()) {
+    dprintf("No virtio-blk devices initialized.\n");
   }
 
+  dprintf("Initialize RAM disks...\n");
+  if (ramdisk_init(RAMDISK_COUNT, RAMDISK_SIZE)) {
+    dprintf("Failed to create the RAM disks!\n");
+  }
+
+  // The disk is the first IDE drive, or the first virtio one.
   dprintf("Mount EXT2 filesystem...\n");
-  if (do_mount(EXT2, "/", "/dev/hda")) {
+  if (do_mount(EXT2, has_initrd ? "/mnt" : "/", "/dev/hda") &&
+      do_mount(EXT2, has_initrd ? "/mnt" : "/", "/dev/vda")) {
     dprintf("Failed to mount EXT2 filesystem...\n");
-    return 1;
+    if (!has_initrd)
+      return 1;
   }
 
   dprintf("Initialize 'procfs'...\n");
@@ -77,6 +114,19 @@ int kinit(boot_info_t *_boot_info) {
     return 1;
   }
 
+  dprintf("Initialize 'tmpfs'...\n");
+  if (tmpfs_init()) {
+    dprintf("Failed to register `tmpfs`!\n");
+    return 1;
+  }
+
+  dprintf("Mounting 'tmpfs'...\n");
+  // Bound the memory any process can pin by writing to /tmp.
+  if (do_mount(TMPFS, "/tmp", "size=16m")) {
+    dprintf("Failed to mount tmpfs at `/tmp`!\n");
+    return 1;
+  }
+
   dprintf("Initialize random device...\n");
   if (random_init()) {
     dprintf("Failed to initialize random device!\n");
@@ -100,6 +150,12 @@ int kinit(boot_info_t *_boot_info) {
   dprintf("Set the keyboard layout: 'US'\n");
   set_keymap_type(KEYMAP_US);
 
+  dprintf("Initialize the vDSO data page...\n");
+  if (vdso_init()) {
+    dprintf("Failed to initialize the vDSO data page!\n");
+    return 1;
+  }
+
   dprintf("Initialize the scheduler.\n");
   scheduler_init();
 
@@ -151,6 +207,12 @@ int kmain() {
     dprintf("Failed to create task test.\n");
   }
 
+  // Create the idle task, it runs when nothing else is runnable.
+  if (!process_create_idle()) {
+    dprintf("Failed to create the idle task.\n");
+    return 1;
+  }
+
   // We have completed the booting procedure.
   dprintf("Booting done, jumping into userspace process.\n");
   // Switch to the page directory of init.
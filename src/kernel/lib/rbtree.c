@@ -0,0 +1,254 @@
+/// @file rbtree.c
+/// @brief Red-black tree, whose nodes are embedded inside the structures
+/// they order (like list_head).
+/// @copyright (c) 2014-2022 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <kernel/rbtree.h>
+
+/// @brief Checks if the node is black, missing leaves are black.
+/// @param node The node.
+/// @return 1 if the node is black, 0 otherwise.
+static inline int __rb_is_black(const rb_node *node) {
+  return !node || (node->color == RB_BLACK);
+}
+
+/// @brief Puts `new_node` in place of `old_node` as child of its parent.
+/// @param root     The root of the tree.
+/// @param old_node The node which is replaced.
+/// @param new_node The node which takes its place, can be NULL.
+static inline void __rb_replace_child(rb_root *root, rb_node *old_node,
+                                      rb_node *new_node) {
+  rb_node *parent = old_node->parent;
+  if (!parent)
+    root->node = new_node;
+  else if (parent->left == old_node)
+    parent->left = new_node;
+  else
+    parent->right = new_node;
+  if (new_node)
+    new_node->parent = parent;
+}
+
+/// @brief Rotates the subtree to the left, the right child becomes its root.
+/// @param root The root of the tree.
+/// @param node The root of the subtree.
+static void __rb_rotate_left(rb_root *root, rb_node *node) {
+  rb_node *right = node->right;
+  node->right    = right->left;
+  if (right->left)
+    right->left->parent = node;
+  __rb_replace_child(root, node, right);
+  right->left  = node;
+  node->parent = right;
+}
+
+/// @brief Rotates the subtree to the right, the left child becomes its root.
+/// @param root The root of the tree.
+/// @param node The root of the subtree.
+static void __rb_rotate_right(rb_root *root, rb_node *node) {
+  rb_node *left = node->left;
+  node->left    = left->right;
+  if (left->right)
+    left->right->parent = node;
+  __rb_replace_child(root, node, left);
+  left->right  = node;
+  node->parent = left;
+}
+
+void rb_insert_color(rb_node *node, rb_root *root) {
+  rb_node *parent, *gparent, *uncle;
+  // A red node cannot have a red parent, fix it going up the tree.
+  while ((parent = node->parent) && (parent->color == RB_RED)) {
+    // The parent is red, so it is not the root.
+    gparent = parent->parent;
+    if (parent == gparent->left) {
+      uncle = gparent->right;
+      if (!__rb_is_black(uncle)) {
+        // Push the black down from the grandparent, and go on from there.
+        parent->color  = RB_BLACK;
+        uncle->color   = RB_BLACK;
+        gparent->color = RB_RED;
+        node           = gparent;
+        continue;
+      }
+      if (node == parent->right) {
+        __rb_rotate_left(root, parent);
+        node   = parent;
+        parent = node->parent;
+      }
+      parent->color  = RB_BLACK;
+      gparent->color = RB_RED;
+      __rb_rotate_right(root, gparent);
+    } else {
+      uncle = gparent->left;
+      if (!__rb_is_black(uncle)) {
+        // Push the black down from the grandparent, and go on from there.
+        parent->color  = RB_BLACK;
+        uncle->color   = RB_BLACK;
+        gparent->color = RB_RED;
+        node           = gparent;
+        continue;
+      }
+      if (node == parent->left) {
+        __rb_rotate_right(root, parent);
+        node   = parent;
+        parent = node->parent;
+      }
+      parent->color  = RB_BLACK;
+      gparent->color = RB_RED;
+      __rb_rotate_left(root, gparent);
+    }
+  }
+  root->node->color = RB_BLACK;
+}
+
+/// @brief Restores the black height after a black node has been removed.
+/// @param root   The root of the tree.
+/// @param node   The node which took the place of the removed one, can be NULL.
+/// @param parent The parent of `node`.
+static void __rb_erase_color(rb_root *root, rb_node *node, rb_node *parent) {
+  rb_node *sibling;
+  // The path through `node` misses a black node.
+  while ((node != root->node) && __rb_is_black(node)) {
+    if (node == parent->left) {
+      sibling = parent->right;
+      if (!__rb_is_black(sibling)) {
+        sibling->color = RB_BLACK;
+        parent->color  = RB_RED;
+        __rb_rotate_left(root, parent);
+        sibling = parent->right;
+      }
+      if (__rb_is_black(sibling->left) && __rb_is_black(sibling->right)) {
+        // Remove a black from the sibling path too, and go up.
+        sibling->color = RB_RED;
+        node           = parent;
+        parent         = node->parent;
+        continue;
+      }
+      if (__rb_is_black(sibling->right)) {
+        sibling->left->color = RB_BLACK;
+        sibling->color       = RB_RED;
+        __rb_rotate_right(root, sibling);
+        sibling = parent->right;
+      }
+      sibling->color = parent->color;
+      parent->color  = RB_BLACK;
+      if (sibling->right)
+        sibling->right->color = RB_BLACK;
+      __rb_rotate_left(root, parent);
+    } else {
+      sibling = parent->left;
+      if (!__rb_is_black(sibling)) {
+        sibling->color = RB_BLACK;
+        parent->color  = RB_RED;
+        __rb_rotate_right(root, parent);
+        sibling = parent->left;
+      }
+      if (__rb_is_black(sibling->left) && __rb_is_black(sibling->right)) {
+        // Remove a black from the sibling path too, and go up.
+        sibling->color = RB_RED;
+        node           = parent;
+        parent         = node->parent;
+        continue;
+      }
+      if (__rb_is_black(sibling->left)) {
+        sibling->right->color = RB_BLACK;
+        sibling->color        = RB_RED;
+        __rb_rotate_left(root, sibling);
+        sibling = parent->left;
+      }
+      sibling->color = parent->color;
+      parent->color  = RB_BLACK;
+      if (sibling->left)
+        sibling->left->color = RB_BLACK;
+      __rb_rotate_right(root, parent);
+    }
+    node = root->node;
+    break;
+  }
+  if (node)
+    node->color = RB_BLACK;
+}
+
+void rb_erase(rb_node *node, rb_root *root) {
+  rb_node *child, *parent;
+  int color = node->color;
+  if (!node->left) {
+    child  = node->right;
+    parent = node->parent;
+    __rb_replace_child(root, node, child);
+  } else if (!node->right) {
+    child  = node->left;
+    parent = node->parent;
+    __rb_replace_child(root, node, child);
+  } else {
+    // Replace the node with its successor, the leftmost of the right subtree.
+    rb_node *successor = node->right;
+    while (successor->left)
+      successor = successor->left;
+    color = successor->color;
+    child = successor->right;
+    if (successor->parent == node) {
+      parent = successor;
+    } else {
+      parent = successor->parent;
+      __rb_replace_child(root, successor, child);
+      successor->right         = node->right;
+      successor->right->parent = successor;
+    }
+    __rb_replace_child(root, node, successor);
+    successor->left         = node->left;
+    successor->left->parent = successor;
+    successor->color        = node->color;
+  }
+  if (color == RB_BLACK)
+    __rb_erase_color(root, child, parent);
+  rb_node_init(node);
+}
+
+rb_node *rb_first(const rb_root *root) {
+  rb_node *node = root->node;
+  if (node)
+    while (node->left)
+      node = node->left;
+  return node;
+}
+
+rb_node *rb_last(const rb_root *root) {
+  rb_node *node = root->node;
+  if (node)
+    while (node->right)
+      node = node->right;
+  return node;
+}
+
+rb_node *rb_next(const rb_node *node) {
+  rb_node *parent;
+  // The leftmost node of the right subtree.
+  if (node->right) {
+    node = node->right;
+    while (node->left)
+      node = node->left;
+    return (rb_node *)node;
+  }
+  // Otherwise, the first ancestor of which we are in the left subtree.
+  while ((parent = node->parent) && (node == parent->right))
+    node = parent;
+  return parent;
+}
+
+rb_node *rb_prev(const rb_node *node) {
+  rb_node *parent;
+  // The rightmost node of the left subtree.
+  if (node->left) {
+    node = node->left;
+    while (node->right)
+      node = node->right;
+    return (rb_node *)node;
+  }
+  // Otherwise, the first ancestor of which we are in the right subtree.
+  while ((parent = node->parent) && (node == parent->left))
+    node = parent;
+  return parent;
+}
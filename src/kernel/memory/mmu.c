@@ -285,6 +285,8 @@ mm_struct_t *mmu_create_blank_process_image(size_t stack_size) {
   // mm_struct_t *mm = kmem_cache_alloc(mm_cache, GFP_KERNEL);
   mm_struct_t *mm_new = kmalloc(sizeof(mm_struct_t));
   memset(mm_new, 0, sizeof(mm_struct_t));
+  // Only the creating task uses it.
+  mm_new->mm_users = 1;
 
   // list_head_init(&mm_new->mmap_list);
 
@@ -360,6 +362,14 @@ void mmu_destroy_process_image(mm_struct_t *mm) {
   kfree(mm);
 }
 
+void mmu_put_process_image(mm_struct_t *mm) {
+  assert(mm != NULL);
+  assert(mm->mm_users > 0);
+  // The last task using the memory destroys it.
+  if (--mm->mm_users == 0)
+    mmu_destroy_process_image(mm);
+}
+
 mm_struct_t *mmu_clone_process_image(mm_struct_t *mm) {
   // Allocate the mm_struct.
   // mm_struct_t *mm = kmem_cache_alloc(mm_cache, GFP_KERNEL);
@@ -380,6 +390,8 @@ mm_struct_t *mmu_clone_process_image(mm_struct_t *mm) {
   list_head_init(&mm_new->mmap_list);
   mm_new->map_count = 0;
   mm_new->total_vm  = 0;
+  // The copy is not shared with the threads of the old process.
+  mm_new->mm_users = 1;
 
   // Clone each memory area to the new process!
   list_head *it;
@@ -6,6 +6,10 @@
 
 #include <kernel/printf.h>
 
+/// Physical memory mapped by bootstrap.S before paging is set up, both
+/// identity and at KERNEL_HIGHER_HALF (KERNEL_INIT_NPTE page tables).
+#define PMM_BOOT_MAPPED_SIZE (KERNEL_INIT_NPTE * 1024 * FRAME_SIZE)
+
 static uint32_t memsize                 = 0;
 static volatile uint32_t *frames_bitmap = NULL;
 static uint32_t max_frames              = 0;
@@ -35,14 +39,14 @@ void pmm_frame_set(uint32_t frame) {
  * @param frame_addr Address of the frame (not index!)
  */
 void pmm_frame_seta(uintptr_t frame_addr) {
-  /* If the frame is within bounds... */
-  // if (frame_addr < max_frames * FRAME_SIZE) {
   uint32_t frame  = frame_addr >> FRAME_SHIFT;
+  /* If the frame is within bounds, device memory is not tracked. */
+  if (frame >= max_frames)
+    return;
   uint32_t index  = FRAME_INDEX(frame);
   uint32_t offset = FRAME_OFFSET(frame);
   frames_bitmap[index] |= ((uint32_t)1 << offset);
   asm("" ::: "memory");
-  // }
 }
 
 /**
@@ -347,6 +351,24 @@ void pmm_init(boot_info_t *boot_info) {
   // and the size of bitmap for 4GB memory is 128KB so if 3MB is not enough
   // for those we must increase them in bootstrap.S or (maybe use another approach?
   // that setup an temporary paging after boot)
+  // The bootloader loads the initrd right after the kernel, if the bitmap
+  // would overlap it, move the bitmap past its end. It must still fit inside
+  // the memory mapped by bootstrap.S, otherwise the initrd is ignored (and
+  // overwritten by the bitmap).
+  if ((boot_info->module_start < addressable_phy + frames_bitmap_size) &&
+      (boot_info->module_end > addressable_phy)) {
+    if (PAGE_ALIGN(boot_info->module_end) + frames_bitmap_size <=
+        PMM_BOOT_MAPPED_SIZE) {
+      addressable += PAGE_ALIGN(boot_info->module_end) - addressable_phy;
+      addressable_phy = PAGE_ALIGN(boot_info->module_end);
+    } else {
+      dprintf("pmm: the initrd (%uKB) does not fit in the boot mapping, "
+              "ignoring it.\n",
+              (boot_info->module_end - boot_info->module_start) / KB);
+      boot_info->module_start = 0;
+      boot_info->module_end   = 0;
+    }
+  }
   frames_bitmap = (uint32_t *)(addressable);
   /* Mark all frames as used */
   memset((void *)frames_bitmap, 0xFF, frames_bitmap_size);
@@ -382,6 +404,12 @@ void pmm_init(boot_info_t *boot_info) {
   // video region
   pmm_deinit_region(boot_info->video_phy_start,
                     boot_info->video_phy_end - boot_info->video_phy_start);
+  // initrd region
+  if (boot_info->module_start) {
+    uint32_t module_phy = __ALIGN_DOWN(boot_info->module_start, FRAME_SIZE);
+    pmm_deinit_region(module_phy,
+                      FRAME_ALIGN(boot_info->module_end) - module_phy);
+  }
 
   /* Count available and used frames */
   for (uint32_t i = 0; i < FRAME_INDEX(max_frames); ++i) {
@@ -325,6 +325,79 @@ void vmm_map_range(uintptr_t virtAddr, uintptr_t physAddr, uint32_t size,
   }
 }
 
+/**
+ * @brief Map a physical range inside the MMIO window.
+ *
+ * The mappings are never released.
+ */
+static void *__vmm_map_window(uintptr_t physAddr, uint32_t size,
+                              uint32_t flags) {
+  static uintptr_t next = MMIO_START;
+  uintptr_t offset      = physAddr & PAGE_LOW_MASK;
+  uint32_t length       = __ALIGN_UP(offset + size, PAGE_SIZE);
+  if (next + length > MMIO_END) {
+    dprintf("vmm: the MMIO window is full!\n");
+    return NULL;
+  }
+  uintptr_t virtAddr = next;
+  next += length;
+  vmm_map_range(virtAddr, physAddr, offset + size, flags);
+  return (void *)(virtAddr + offset);
+}
+
+/**
+ * @brief Map the registers of a device inside the MMIO window.
+ *
+ * The mappings are uncached and they are never released.
+ */
+void *vmm_map_mmio(uintptr_t physAddr, uint32_t size) {
+  return __vmm_map_window(physAddr, size,
+                          PML_KERNEL_ACCESS | I86_PTE_WRITETHOUGH |
+                            I86_PTE_NOT_CACHEABLE);
+}
+
+/**
+ * @brief Allocate physically contiguous memory, for the structures a device
+ * reads and writes on its own (e.g. descriptor rings).
+ *
+ * The memory is mapped inside the MMIO window and it is never released.
+ */
+void *vmm_alloc_dma(uint32_t size, uintptr_t *physAddr) {
+  *physAddr = pmm_allocate_frames_addr(__ALIGN_UP(size, PAGE_SIZE) / PAGE_SIZE);
+  return __vmm_map_window(*physAddr, size, PML_KERNEL_ACCESS);
+}
+
+/// The slots of the KMAP window currently in use, one bit per page.
+static uint32_t kmap_slots;
+
+/**
+ * @brief Temporarily map a frame inside the KMAP window.
+ *
+ * The mapping must be released with vmm_kunmap as soon as the frame has been
+ * accessed, the window has only a few slots.
+ */
+void *vmm_kmap(uintptr_t physAddr) {
+  for (uint32_t slot = 0; slot < (KMAP_END - KMAP_START) / PAGE_SIZE; ++slot) {
+    if (!(kmap_slots & (1u << slot))) {
+      kmap_slots |= 1u << slot;
+      uintptr_t virtAddr = KMAP_START + slot * PAGE_SIZE;
+      vmm_map_page(virtAddr, physAddr & PAGE_MASK, PML_KERNEL_ACCESS);
+      return (void *)virtAddr;
+    }
+  }
+  dprintf("vmm: the KMAP window is full!\n");
+  return NULL;
+}
+
+/**
+ * @brief Release a mapping made by vmm_kmap, the frame is not freed.
+ */
+void vmm_kunmap(void *virtAddr) {
+  uint32_t slot = ((uintptr_t)virtAddr - KMAP_START) / PAGE_SIZE;
+  vmm_unmap_page((uintptr_t)virtAddr);
+  kmap_slots &= ~(1u << slot);
+}
+
 void vmm_unmap_page(uintptr_t virtAddr) {
   virtAddr           = __ALIGN_DOWN(virtAddr, PAGE_SIZE);
   uintptr_t pageAddr = virtAddr >> PAGE_SHIFT;
@@ -424,7 +497,12 @@ void vmm_init(struct boot_info_t *boot_info) {
 
   /* Preallocate ptable for higher half kernel and set KERNEL ACCESS protected */
   for (int i = KERNEL_PDE_START_IDX + KERNEL_INIT_NPTE; i < 1023; ++i) {
-    vmm_pde_allocate(&k_pdir->entries[i], PML_KERNEL_ACCESS);
+    // The table of the vdso page must let userspace through, its pages keep
+    // their own protection.
+    if (i == PDE_INDEX(VDSO_DATA_START))
+      vmm_pde_allocate(&k_pdir->entries[i], PML_USER_ACCESS);
+    else
+      vmm_pde_allocate(&k_pdir->entries[i], PML_KERNEL_ACCESS);
   }
 
   /* Recursive mapping */
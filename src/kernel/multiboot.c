@@ -31,12 +31,15 @@ void multiboot_init(uint32_t magic, uint32_t addr) {
       //   printf("Boot loader name = %s\n",
       //          ((struct multiboot_tag_string *)tag)->string);
       //   break;
-      // case MULTIBOOT_TAG_TYPE_MODULE:
-      //   printf("Module at 0x%x-0x%x. Command line %s\n",
-      //          ((struct multiboot_tag_module *)tag)->mod_start,
-      //          ((struct multiboot_tag_module *)tag)->mod_end,
-      //          ((struct multiboot_tag_module *)tag)->cmdline);
-      //   break;
+      case MULTIBOOT_TAG_TYPE_MODULE:
+        dprintf("Module at 0x%x-0x%x. Command line %s\n",
+                ((struct multiboot_tag_module *)tag)->mod_start,
+                ((struct multiboot_tag_module *)tag)->mod_end,
+                ((struct multiboot_tag_module *)tag)->cmdline);
+        // The first module is the initial ramdisk.
+        if (!mboot.multiboot_module)
+          mboot.multiboot_module = (struct multiboot_tag_module *)tag;
+        break;
       case MULTIBOOT_TAG_TYPE_BASIC_MEMINFO:
         // dprintf("mem_lower = %uKB, mem_upper = %uKB\n",
         //         ((struct multiboot_tag_basic_meminfo *)tag)->mem_lower,
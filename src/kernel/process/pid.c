@@ -0,0 +1,106 @@
+/// @file pid.c
+/// @brief Process identifiers allocation, and lookup of the tasks by pid,
+/// process group and session.
+/// @copyright (c) 2014-2022 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <kernel/process/pid.h>
+#include <kernel/process/task.h>
+#include <kernel/bitops.h>
+#include <kernel/errno.h>
+
+/// The number of words of the pid bitmap.
+#define PIDMAP_SIZE (PID_MAX / 32)
+
+/// Bit `pid` is set when the pid is in use, pid 0 is never given.
+static unsigned long pidmap[PIDMAP_SIZE] = { 1 };
+/// The last pid given, the search for a free one starts after it so that
+/// pids are not reused right away.
+static pid_t last_pid = 0;
+/// The hash tables, one for each kind of identifier.
+static list_head pid_hash[PIDTYPE_MAX][PIDHASH_SIZE];
+
+/// @brief Returns the identifier of the given kind of the task.
+/// @param task the task.
+/// @param type the kind of identifier.
+/// @return the identifier.
+static inline pid_t __pid_nr(task_struct *task, pid_type_t type) {
+  if (type == PIDTYPE_PGID)
+    return task->pgid;
+  if (type == PIDTYPE_SID)
+    return task->sid;
+  return task->pid;
+}
+
+/// @brief Returns the bucket where the identifier is kept.
+/// @param type the kind of identifier.
+/// @param nr the identifier.
+/// @return the bucket.
+static inline list_head *__pid_bucket(pid_type_t type, pid_t nr) {
+  // Pids are given in sequence, so the low bits spread them evenly.
+  return &pid_hash[type][(unsigned)nr % PIDHASH_SIZE];
+}
+
+void pid_init(void) {
+  for (int type = 0; type < PIDTYPE_MAX; ++type)
+    for (int i = 0; i < PIDHASH_SIZE; ++i)
+      list_head_init(&pid_hash[type][i]);
+}
+
+pid_t pid_alloc(void) {
+  pid_t start = last_pid + 1;
+  if (start >= PID_MAX)
+    start = 1;
+  int word = start / 32;
+  // The pids before `start` in its word are looked at last, after wrapping.
+  unsigned long bits = pidmap[word] | ((1U << (start % 32)) - 1);
+  for (int i = 0; i <= PIDMAP_SIZE; ++i) {
+    if (~bits) {
+      int bit = find_first_zero(bits);
+      bit_set_assign(pidmap[word], bit);
+      last_pid = word * 32 + bit;
+      return last_pid;
+    }
+    word = (word + 1) % PIDMAP_SIZE;
+    bits = pidmap[word];
+  }
+  return -EAGAIN;
+}
+
+void pid_free(pid_t pid) {
+  if ((pid > 0) && (pid < PID_MAX))
+    bit_clear_assign(pidmap[pid / 32], pid % 32);
+}
+
+void pid_hash_add(task_struct *task) {
+  for (int type = 0; type < PIDTYPE_MAX; ++type)
+    list_head_insert_before(&task->pid_links[type],
+                            __pid_bucket(type, __pid_nr(task, type)));
+}
+
+void pid_hash_del(task_struct *task) {
+  for (int type = 0; type < PIDTYPE_MAX; ++type)
+    list_head_remove(&task->pid_links[type]);
+}
+
+void pid_hash_change(task_struct *task, pid_type_t type, pid_t nr) {
+  // The task could not be in the tables yet, while it is being created.
+  int hashed = !list_head_empty(&task->pid_links[type]);
+  if (hashed)
+    list_head_remove(&task->pid_links[type]);
+  if (type == PIDTYPE_PGID)
+    task->pgid = nr;
+  else if (type == PIDTYPE_SID)
+    task->sid = nr;
+  if (hashed)
+    list_head_insert_before(&task->pid_links[type], __pid_bucket(type, nr));
+}
+
+task_struct *pid_find_task(pid_type_t type, pid_t nr) {
+  list_for_each_decl(it, __pid_bucket(type, nr)) {
+    task_struct *entry = list_entry(it, task_struct, pid_links[type]);
+    if (__pid_nr(entry, type) == nr)
+      return entry;
+  }
+  return NULL;
+}
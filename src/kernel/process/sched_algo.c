@@ -3,112 +3,147 @@
 #include <kernel/process/wait.h>
 #include <kernel/process/scheduler.h>
 #include <kernel/list_head.h>
+#include <kernel/bitops.h>
+#include <kernel/math.h>
 #include <kernel/assert.h>
 #include <kernel/printf.h>
 
+/// The runqueue, it lives in scheduler.c.
+extern runqueue_t runqueue;
+
+/// The ticks a SCHED_RR task runs before the other tasks with its priority.
+#define RR_TIMESLICE (TICKS_PER_SECOND / 10)
+
 /// @brief Updates task execution statistics.
 /// @param task the task to update.
 static void __update_task_statistics(task_struct *task);
 
-/// @brief Checks if the given task is actually a periodic task.
-/// @param task the task to check.
-/// @return true if the task is periodic, false otherwise.
-static inline bool_t __is_periodic_task(task_struct *task) {
-  // Check if the task is a periodic one and it is not under analysis.
-  return task->se.is_periodic && !task->se.is_under_analysis;
+/// @brief Compares two times (or virtual runtimes), it works even when they
+/// wrap around.
+/// @param a the first time.
+/// @param b the second time.
+/// @return true if `a` comes before `b`.
+static inline bool_t __time_before(time_t a, time_t b) {
+  return (int)(a - b) < 0;
 }
 
-/// @brief Employs time-sharing, giving each job a timeslice, and is also
-/// preemptive since the scheduler forces the task out of the CPU once
-/// the timeslice expires.
-/// @param runqueue list of all processes.
-/// @param skip_periodic tells the algorithm if there are periodic processes in
-/// the list, and in that case it needs to skip them.
-/// @return the next task on success, NULL on failure.
-static inline task_struct *__scheduler_rr(runqueue_t *runqueue,
-                                          bool_t skip_periodic) {
-  // If there is just one task, return it; no need to do anything.
-  if (list_head_size(&runqueue->curr->run_list) <= 1) {
-    return runqueue->curr;
-  }
-  // Search for the next task (we do not start from the head, so INSIDE, skip the head).
-  list_for_each_decl(it, &runqueue->curr->run_list) {
-    // Check if we reached the head of list_head, and skip it.
-    if (it == &runqueue->queue)
-      continue;
-    // Get the current entry.
-    task_struct *entry = list_entry(it, task_struct, run_list);
-    // We consider only runnable processes
-    if (entry->state != TASK_RUNNING)
-      continue;
-    // If entry is a periodic task, and we were asked to skip periodic tasks, skip it.
-    if (__is_periodic_task(entry) && skip_periodic)
-      continue;
-    // We have our next entry.
-    return entry;
-  }
-  return NULL;
+// == IDLE CLASS ==============================================================
+
+static void __idle_enqueue(runqueue_t *runqueue, task_struct *process) {
+  if (list_head_empty(&process->prio_list))
+    list_head_insert_before(&process->prio_list, &runqueue->idle);
 }
 
-/// @brief Is a non-preemptive algorithm, where each task is assigned a
-/// priority. Processes with highest priority are executed first, while
-/// processes with same priority are executed on first-come/first-served basis.
-/// Priority can be decided based on memory requirements, time requirements or
-/// any other resource requirement.
-/// @param runqueue list of all processes.
-/// @param skip_periodic tells the algorithm if there are periodic processes in
-/// the list, and in that case it needs to skip them.
-/// @return the next task on success, NULL on failure.
-/// @details
-/// When implementing this algorithm, beware of the following pitfal. If you
-/// have the following runqueue (reports task position in the runqueue, priority
-/// and name):
-///      Position | Priority | Name
-///          1    |    120   | init
-///          2    |    120   | shell
-///          3    |    122   | echo
-///          4    |    128   | ps
-/// If you pick the first task every time (i.e., init), and use its prio (i.e.,
-/// 120), what would happen if inside the for-loop when you check "if the entry
-/// has a lower priority", you use a lesser-than sign?
-/// First, it will check against init itself, so 120 < 120 is false.
-/// Then, it will check against shell, again, 120 < 120 is false.
-/// As such, shell or the other processes will never be selected. There are
-/// different ways of solving this problem, each of which requires changes only
-/// inside this same function. Good luck.
-static inline task_struct *__scheduler_priority(runqueue_t *runqueue,
-                                                bool_t skip_periodic) {
-#ifdef SCHEDULER_PRIORITY
-  // Get the first element of the list.
-  task_struct *next =
-    list_entry(runqueue->queue.next, struct task_struct, run_list);
-
-  // Get its static priority.
-  time_t min = /*...*/;
-
-  // Search for the task with the smallest static priority.
-  list_for_each_decl(it, &runqueue->queue) {
-    // Check if we reached the head of list_head, and skip it.
-    if (it == &runqueue->queue)
-      continue;
-    // Get the current entry.
-    task_struct *entry = list_entry(it, task_struct, run_list);
-    // We consider only runnable processes
-    if (entry->state != TASK_RUNNING)
-      continue;
-    // If entry is a periodic task, and we were asked to skip periodic tasks, skip it.
-    if (__is_periodic_task(entry) && skip_periodic)
-      continue;
-    // Check if the entry has a lower priority.
-    if (/*...*/) {
-      // Chose the `entry` as the `next` task.
-      /*...*/
+static int __idle_dequeue(runqueue_t *runqueue, task_struct *process) {
+  if (list_head_empty(&process->prio_list))
+    return 0;
+  list_head_remove(&process->prio_list);
+  return 1;
+}
+
+/// @brief Picks the first runnable idle task, and moves it at the end of the
+/// list so that idle tasks take turns.
+/// @param runqueue the runqueue.
+/// @return the next task, NULL if there are no runnable idle tasks.
+static task_struct *__idle_pick(runqueue_t *runqueue) {
+  if (list_head_empty(&runqueue->idle))
+    return NULL;
+  task_struct *next = list_entry(runqueue->idle.next, task_struct, prio_list);
+  list_head_remove(&next->prio_list);
+  list_head_insert_before(&next->prio_list, &runqueue->idle);
+  return next;
+}
+
+static void __idle_task_tick(runqueue_t *runqueue, task_struct *process) {
+}
+
+/// The idle class, it runs only when no other class has runnable tasks.
+static const sched_class_t idle_sched_class = {
+  .name           = "idle",
+  .next           = NULL,
+  .enqueue_task   = __idle_enqueue,
+  .dequeue_task   = __idle_dequeue,
+  .pick_next_task = __idle_pick,
+  .task_tick      = __idle_task_tick,
+};
+
+// == FAIR CLASS ==============================================================
+
+/// Fixed point shift of the virtual runtime, with respect to the timer ticks,
+/// so that the heaviest weights still advance it.
+#define VRUNTIME_SHIFT 10
+
+/// The maximum ticks charged at once, which keeps the weighted value in 32 bits.
+#define VRUNTIME_MAX_DELTA (4 * TICKS_PER_SECOND)
+
+/// @brief Returns the weight of the task, from its priority.
+/// @param process the process.
+/// @return the weight.
+static inline time_t __task_weight(task_struct *process) {
+  // Real-time and invalid priorities get the closest nice weight.
+  return GET_WEIGHT(max(MAX_RT_PRIO, min(process->se.prio, MAX_PRIO - 1)));
+}
+
+/// @brief Weights the execution time of the task.
+/// @param delta_exec the execution time, in ticks.
+/// @param weight the weight of the task.
+/// @return the amount of virtual runtime.
+static inline time_t __calc_delta_vruntime(time_t delta_exec, time_t weight) {
+  delta_exec = min(delta_exec, VRUNTIME_MAX_DELTA);
+  // A task with the default weight advances at the same pace as time.
+  if (weight == (time_t)NICE_0_LOAD)
+    return delta_exec << VRUNTIME_SHIFT;
+  return delta_exec * (((time_t)NICE_0_LOAD << VRUNTIME_SHIFT) / weight);
+}
+
+/// @brief Inserts the task inside the tree, ordered by vruntime.
+/// @param cfs the fair runqueue.
+/// @param process the process.
+static inline void __cfs_enqueue(cfs_rq_t *cfs, task_struct *process) {
+  rb_node **link = &cfs->tasks_timeline.root.node, *parent = NULL;
+  int leftmost   = 1;
+  // Tasks with the same vruntime go after the ones already there.
+  while (*link) {
+    parent             = *link;
+    task_struct *entry = rb_entry(parent, task_struct, se.run_node);
+    if (__time_before(process->se.vruntime, entry->se.vruntime)) {
+      link = &parent->left;
+    } else {
+      link     = &parent->right;
+      leftmost = 0;
     }
   }
-  return next;
-#else
-  return __scheduler_rr(runqueue, skip_periodic);
-#endif
+  rb_link_node(&process->se.run_node, parent, link);
+  rb_insert_color_cached(&process->se.run_node, &cfs->tasks_timeline, leftmost);
+  ++cfs->nr_running;
+}
+
+/// @brief Removes the task from the tree.
+/// @param cfs the fair runqueue.
+/// @param process the process.
+/// @return 1 if the task was inside the tree, 0 otherwise.
+static inline int __cfs_dequeue(cfs_rq_t *cfs, task_struct *process) {
+  if (rb_node_empty(&process->se.run_node))
+    return 0;
+  rb_erase_cached(&process->se.run_node, &cfs->tasks_timeline);
+  --cfs->nr_running;
+  return 1;
+}
+
+static void __fair_enqueue(runqueue_t *runqueue, task_struct *process) {
+  cfs_rq_t *cfs = &runqueue->cfs;
+  if (!rb_node_empty(&process->se.run_node))
+    return;
+  // Tasks coming back from sleep, and new ones, start from the smallest
+  // vruntime: they get to run soon, without starving the others for the
+  // time they have not been running.
+  if (__time_before(process->se.vruntime, cfs->min_vruntime))
+    process->se.vruntime = cfs->min_vruntime;
+  __cfs_enqueue(cfs, process);
+}
+
+static int __fair_dequeue(runqueue_t *runqueue, task_struct *process) {
+  return __cfs_dequeue(&runqueue->cfs, process);
 }
 
 /// @brief It aims at giving a fair share of CPU time to processes, and achieves
@@ -117,95 +152,245 @@ static inline task_struct *__scheduler_priority(runqueue_t *runqueue,
 /// so far). It always tries to split up CPU time between runnable tasks as
 /// close to "ideal multitasking hardware" as possible.
 /// @param runqueue list of all processes.
-/// @param skip_periodic tells the algorithm if there are periodic processes in
-/// the list, and in that case it needs to skip them.
 /// @return the next task on success, NULL on failure.
-static inline task_struct *__scheduler_cfs(runqueue_t *runqueue,
-                                           bool_t skip_periodic) {
-#ifdef SCHEDULER_CFS
-  // Get the first element of the list.
-  task_struct *next =
-    list_entry(runqueue->queue.next, struct task_struct, run_list);
-
-  // Get its virtual runtime.
-  time_t min = /* ... */;
-
-  // Search for the task with the smallest vruntime value.
-  list_for_each_decl(it, &runqueue->queue) {
-    // Check if we reached the head of list_head, and skip it.
-    if (it == &runqueue->queue)
-      continue;
-    // Get the current entry.
-    task_struct *entry = list_entry(it, task_struct, run_list);
-    // We consider only runnable processes
-    if (entry->state != TASK_RUNNING)
-      continue;
-    // If entry is a periodic task, and we were asked to skip periodic tasks, skip it.
-    if (__is_periodic_task(entry) && skip_periodic)
-      continue;
-
-    // Check if the element in the list has a smaller vruntime value.
-    /* ... */
-  }
+/// @details The runnable tasks are kept inside a red-black tree ordered by
+/// vruntime, which caches its leftmost node: the next task is found in
+/// constant time, while inserting and removing tasks is logarithmic.
+static task_struct *__fair_pick(runqueue_t *runqueue) {
+  cfs_rq_t *cfs = &runqueue->cfs;
+  rb_node *node = rb_first_cached(&cfs->tasks_timeline);
+  if (node == NULL)
+    return NULL;
+  task_struct *next = rb_entry(node, task_struct, se.run_node);
+  // Advance the minimum vruntime, from where sleeping tasks restart.
+  if (__time_before(cfs->min_vruntime, next->se.vruntime))
+    cfs->min_vruntime = next->se.vruntime;
   return next;
-#else
-  return __scheduler_rr(runqueue, skip_periodic);
-#endif
+}
+
+static void __fair_task_tick(runqueue_t *runqueue, task_struct *process) {
+  // The vruntime of the task changes, take it out of the tree and put it back
+  // in its new position.
+  int queued = __cfs_dequeue(&runqueue->cfs, process);
+  // Weight the execution time, lighter tasks advance faster.
+  process->se.vruntime +=
+    __calc_delta_vruntime(process->se.exec_runtime, __task_weight(process));
+  if (queued)
+    __cfs_enqueue(&runqueue->cfs, process);
+}
+
+/// The fair class, for the time-sharing tasks.
+static const sched_class_t fair_sched_class = {
+  .name           = "fair",
+  .next           = &idle_sched_class,
+  .enqueue_task   = __fair_enqueue,
+  .dequeue_task   = __fair_dequeue,
+  .pick_next_task = __fair_pick,
+  .task_tick      = __fair_task_tick,
+};
+
+// == REAL-TIME CLASS =========================================================
+
+/// @brief Returns the list of the priority array where the task is queued.
+/// @param process the process.
+/// @return the index of the list.
+static inline int __rt_index(task_struct *process) {
+  // The priority comes from userspace too, keep it inside the array.
+  return max(0, min(process->se.prio, MAX_RT_PRIO - 1));
+}
+
+static void __rt_enqueue(runqueue_t *runqueue, task_struct *process) {
+  prio_array_t *array = &runqueue->rt;
+  if (!list_head_empty(&process->prio_list))
+    return;
+  int prio = __rt_index(process);
+  list_head_insert_before(&process->prio_list, &array->queue[prio]);
+  bit_set_assign(array->bitmap[prio / 32], prio % 32);
+  ++array->nr_active;
+}
+
+static int __rt_dequeue(runqueue_t *runqueue, task_struct *process) {
+  prio_array_t *array = &runqueue->rt;
+  if (list_head_empty(&process->prio_list))
+    return 0;
+  int prio = __rt_index(process);
+  list_head_remove(&process->prio_list);
+  if (list_head_empty(&array->queue[prio]))
+    bit_clear_assign(array->bitmap[prio / 32], prio % 32);
+  --array->nr_active;
+  return 1;
+}
+
+/// @brief Picks the first runnable task of the priority array, starting from
+/// the highest priority. Tasks with the same priority are served in the order
+/// they became runnable.
+/// @param runqueue the runqueue.
+/// @return the next task on success, NULL if nothing is runnable.
+/// @details The first non-empty list is found with a bit scan of the bitmap,
+/// so the cost does not depend on the number of tasks. Only runnable tasks
+/// are inside the array, so the head of that list is the next task.
+static task_struct *__rt_pick(runqueue_t *runqueue) {
+  prio_array_t *array = &runqueue->rt;
+  for (int word = 0; word < PRIO_BITMAP_SIZE; ++word) {
+    if (array->bitmap[word]) {
+      int prio = word * 32 + find_first_non_zero(array->bitmap[word]);
+      return list_entry(array->queue[prio].next, task_struct, prio_list);
+    }
+  }
+  return NULL;
+}
+
+static void __rt_task_tick(runqueue_t *runqueue, task_struct *process) {
+  // SCHED_FIFO tasks run until they block, or a higher priority task arrives.
+  if (process->se.policy != SCHED_RR)
+    return;
+  if (process->se.time_slice > process->se.exec_runtime) {
+    process->se.time_slice -= process->se.exec_runtime;
+    return;
+  }
+  // The timeslice expired, go after the tasks with the same priority.
+  process->se.time_slice = RR_TIMESLICE;
+  if (!list_head_empty(&process->prio_list)) {
+    list_head_remove(&process->prio_list);
+    list_head_insert_before(&process->prio_list,
+                            &runqueue->rt.queue[__rt_index(process)]);
+  }
+}
+
+/// The real-time class, for SCHED_FIFO and SCHED_RR tasks. Periodic tasks
+/// scheduled with fixed priorities (rate monotonic) belong here too.
+static const sched_class_t rt_sched_class = {
+  .name           = "rt",
+  .next           = &fair_sched_class,
+  .enqueue_task   = __rt_enqueue,
+  .dequeue_task   = __rt_dequeue,
+  .pick_next_task = __rt_pick,
+  .task_tick      = __rt_task_tick,
+};
+
+// == DEADLINE CLASS ==========================================================
+
+static void __dl_enqueue(runqueue_t *runqueue, task_struct *process) {
+  dl_rq_t *dl    = &runqueue->dl;
+  rb_node **link = &dl->root.root.node, *parent = NULL;
+  int leftmost   = 1;
+  if (!rb_node_empty(&process->se.dl_node))
+    return;
+  // Tasks with the same deadline go after the ones already there.
+  while (*link) {
+    parent             = *link;
+    task_struct *entry = rb_entry(parent, task_struct, se.dl_node);
+    if (__time_before(process->se.deadline, entry->se.deadline)) {
+      link = &parent->left;
+    } else {
+      link     = &parent->right;
+      leftmost = 0;
+    }
+  }
+  rb_link_node(&process->se.dl_node, parent, link);
+  rb_insert_color_cached(&process->se.dl_node, &dl->root, leftmost);
+  ++dl->nr_running;
+}
+
+static int __dl_dequeue(runqueue_t *runqueue, task_struct *process) {
+  if (rb_node_empty(&process->se.dl_node))
+    return 0;
+  rb_erase_cached(&process->se.dl_node, &runqueue->dl.root);
+  --runqueue->dl.nr_running;
+  return 1;
 }
 
 /// @brief Executes the task with the earliest absolute deadline among all the
 /// ready tasks.
 /// @param runqueue list of all processes.
-/// @return the next task on success, NULL on failure.
-static inline task_struct *__scheduler_aedf(runqueue_t *runqueue) {
-  return __scheduler_rr(runqueue, false);
+/// @return the next task, NULL if there are no runnable deadline tasks.
+/// @details Periodic tasks leave the tree when they call `waitperiod`, and a
+/// dynamic timer releases them again at their next period, with a new
+/// deadline. Aperiodic deadline tasks are refused by sched_setparam, with no
+/// runtime budget they would keep their deadline forever.
+static task_struct *__dl_pick(runqueue_t *runqueue) {
+  rb_node *node = rb_first_cached(&runqueue->dl.root);
+  if (node == NULL)
+    return NULL;
+  return rb_entry(node, task_struct, se.dl_node);
 }
 
-/// @brief Executes the task with the earliest absolute DEADLINE among all the
-/// ready tasks. When a task was executed, and its period is starting again, it
-/// must be set as 'executable again', and its deadline and next_period must be
-/// updated.
-/// @param runqueue list of all processes.
-/// @return the next task on success, NULL on failure.
-static inline task_struct *__scheduler_edf(runqueue_t *runqueue) {
-  return __scheduler_rr(runqueue, false);
+static void __dl_task_tick(runqueue_t *runqueue, task_struct *process) {
 }
 
-/// @brief Executes the task with the earliest next PERIOD among all the ready
-/// tasks.
-/// @details When a task was executed, and its period is starting again, it must
-/// be set as 'executable again', and its deadline and next_period must be
-/// updated.
-/// @param runqueue list of all processes.
-/// @return the next task on success, NULL on failure.
-static inline task_struct *__scheduler_rm(runqueue_t *runqueue) {
-  return __scheduler_rr(runqueue, false);
+/// The deadline class, for SCHED_DEADLINE tasks.
+static const sched_class_t dl_sched_class = {
+  .name           = "deadline",
+  .next           = &rt_sched_class,
+  .enqueue_task   = __dl_enqueue,
+  .dequeue_task   = __dl_dequeue,
+  .pick_next_task = __dl_pick,
+  .task_tick      = __dl_task_tick,
+};
+
+/// The class with the highest priority.
+#define sched_class_highest (&dl_sched_class)
+
+// == RUNNABLE TASKS ==========================================================
+
+/// @brief Returns the scheduling class of the task, from its policy.
+/// @param process the process.
+/// @return the scheduling class.
+static inline const sched_class_t *__sched_class_of(task_struct *process) {
+  // While the periodic tasks are under analysis, they share the CPU with the
+  // time-sharing tasks.
+  if (process->se.is_periodic && process->se.is_under_analysis)
+    return &fair_sched_class;
+  switch (process->se.policy) {
+  case SCHED_DEADLINE:
+    return &dl_sched_class;
+  case SCHED_FIFO:
+  case SCHED_RR:
+    return &rt_sched_class;
+  case SCHED_IDLE:
+    return &idle_sched_class;
+  default:
+    return &fair_sched_class;
+  }
+}
+
+void scheduler_set_sched_class(task_struct *process) {
+  const sched_class_t *sched_class = __sched_class_of(process);
+  // A task joining the real-time class starts with a whole timeslice.
+  if (process->sched_class != sched_class)
+    process->se.time_slice = RR_TIMESLICE;
+  process->sched_class = sched_class;
+}
+
+void scheduler_enqueue_runnable(task_struct *process) {
+  process->sched_class->enqueue_task(&runqueue, process);
+}
+
+int scheduler_dequeue_runnable(task_struct *process) {
+  return process->sched_class->dequeue_task(&runqueue, process);
 }
 
 task_struct *scheduler_pick_next_task(runqueue_t *runqueue) {
+  task_struct *curr = runqueue->curr;
+
   // Update task statistics.
-  __update_task_statistics(runqueue->curr);
+  __update_task_statistics(curr);
+  // Let the class of the current task charge it for the time it has run.
+  curr->sched_class->task_tick(runqueue, curr);
 
   // Pointer to the next task to schedule.
   task_struct *next = NULL;
 
-#if defined(SCHEDULER_RR)
-  next = __scheduler_rr(runqueue, false);
-#elif defined(SCHEDULER_PRIORITY)
-  next = __scheduler_priority(runqueue, false);
-#elif defined(SCHEDULER_CFS)
-  next = __scheduler_cfs(runqueue, false);
-#elif defined(SCHEDULER_EDF)
-  next = __scheduler_edf(runqueue);
-#elif defined(SCHEDULER_RM)
-  next = __scheduler_rm(runqueue);
-#elif defined(SCHEDULER_AEDF)
-  next = __scheduler_aedf(runqueue);
-#else
-  next = __scheduler_rr(runqueue, false);
-// #error "You should enable a scheduling algorithm!"
-#endif
+  // Ask the classes, from the highest priority one.
+  for (const sched_class_t *sched_class = sched_class_highest; sched_class;
+       sched_class = sched_class->next) {
+    next = sched_class->pick_next_task(runqueue);
+    if (next)
+      break;
+  }
 
+  // The idle task is always runnable, the current task runs again only if it
+  // is still runnable.
   assert(next && "No valid task selected by the scheduling algorithm.");
 
   // Update the last context switch time of the next task.
@@ -216,8 +401,6 @@ task_struct *scheduler_pick_next_task(runqueue_t *runqueue) {
 
 static void __update_task_statistics(task_struct *task) {
   // See `prio.h` for more support functions.
-#if defined(SCHEDULER_CFS) || defined(SCHEDULER_EDF) ||                        \
-  defined(SCHEDULER_RM) || defined(SCHEDULER_AEDF)
   assert(task && "Current task is not valid.");
 
   // While periodic task is under analysis is executed with aperiodic
@@ -232,20 +415,4 @@ static void __update_task_statistics(task_struct *task) {
 
   // Set the sum_exec_runtime.
   task->se.sum_exec_runtime += task->se.exec_runtime;
-
-  // If the task is not a periodic task we have to update the virtual runtime.
-  if (!task->se.is_periodic) {
-    // Get the weight of the current task.
-    time_t weight = /* ... */;
-    // If the weight is different from the default load, compute it.
-    if (weight != NICE_0_LOAD) {
-      // Get the multiplicative factor for its delta_exec.
-      double factor = /* ... */;
-      // Weight the delta_exec with the multiplicative factor.
-      task->se.exec_runtime = /* ... */;
-    }
-    // Update vruntime of the current task.
-    task->se.vruntime += /* ... */;
-  }
-#endif
 }
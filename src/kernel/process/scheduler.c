@@ -1,4 +1,5 @@
 #include <arch/i386/tss.h>
+#include <arch/i386/gdt.h>
 #include <arch/i386/fpu.h>
 #include <arch/i386/timer.h>
 
@@ -7,14 +8,17 @@
 #include <kernel/fs/vfs.h>
 #include <kernel/process/scheduler.h>
 #include <kernel/process/prio.h>
+#include <kernel/process/pid.h>
 #include <kernel/process/wait.h>
 #include <kernel/memory/mmu.h>
 #include <kernel/memory/vmm.h>
 #include <kernel/system/panic.h>
+#include <kernel/system/vdso.h>
 #include <kernel/time.h>
 #include <kernel/errno.h>
 #include <kernel/list_head.h>
 #include <kernel/math.h>
+#include <kernel/string.h>
 #include <kernel/printf.h>
 
 /// @brief          Assembly function setting the kernel stack to jump into
@@ -29,42 +33,51 @@ runqueue_t runqueue;
 void scheduler_init() {
   // Initialize the runqueue list of tasks.
   list_head_init(&runqueue.queue);
+  // Initialize the tables to find the tasks by pid.
+  pid_init();
+  // Initialize the tree of the deadline class.
+  rb_root_init(&runqueue.dl.root);
+  runqueue.dl.nr_running = 0;
+  // Initialize the priority array of the real-time class.
+  for (int prio = 0; prio < MAX_RT_PRIO; ++prio) {
+    list_head_init(&runqueue.rt.queue[prio]);
+  }
+  memset(runqueue.rt.bitmap, 0, sizeof(runqueue.rt.bitmap));
+  runqueue.rt.nr_active = 0;
+  // Initialize the tree of the fair class.
+  rb_root_init(&runqueue.cfs.tasks_timeline);
+  runqueue.cfs.nr_running   = 0;
+  runqueue.cfs.min_vruntime = 0;
+  // Initialize the list of the idle class.
+  list_head_init(&runqueue.idle);
   // Reset the current task.
   runqueue.curr = NULL;
   // Reset the number of active tasks.
-  runqueue.num_active = 0;
+  runqueue.num_active   = 0;
+  runqueue.need_resched = false;
 }
 
-uint32_t scheduler_getpid(void) {
-  /// The current unused PID.
-  static unsigned long int tid = 1;
+task_struct *scheduler_get_current_process() {
+  return runqueue.curr;
+}
 
-  // Return the pid and increment.
-  return tid++;
+void scheduler_init_idle(task_struct *process) {
+  process->se.policy = SCHED_IDLE;
+  scheduler_set_sched_class(process);
+  runqueue.idle_task = process;
+  scheduler_enqueue_task(process);
 }
 
-task_struct *scheduler_get_current_process() {
-  return runqueue.curr;
+task_struct *scheduler_get_idle_process() {
+  return runqueue.idle_task;
 }
 
 time_t scheduler_get_maximum_vruntime() {
-  time_t vruntime = 0;
-  task_struct *entry;
-  list_for_each_decl(it, &runqueue.queue) {
-    // Check if we reached the head of list_head, and skip it.
-    if (it == &runqueue.queue)
-      continue;
-    // Get the current entry.
-    entry = list_entry(it, task_struct, run_list);
-    // Skip the process if it is a periodic one, we are issued to skip
-    // periodic tasks, and the entry is not a periodic task under
-    // analysis.
-    if (entry->se.is_periodic && !entry->se.is_under_analysis)
-      continue;
-    if (entry->se.vruntime > vruntime)
-      vruntime = entry->se.vruntime;
-  }
-  return vruntime;
+  // The rightmost task of the tree.
+  rb_node *last = rb_last(&runqueue.cfs.tasks_timeline.root);
+  if (last)
+    return rb_entry(last, task_struct, se.run_node)->se.vruntime;
+  return runqueue.cfs.min_vruntime;
 }
 
 size_t scheduler_get_active_processes() {
@@ -72,13 +85,7 @@ size_t scheduler_get_active_processes() {
 }
 
 task_struct *scheduler_get_running_process(pid_t pid) {
-  task_struct *entry;
-  list_for_each_decl(it, &runqueue.queue) {
-    entry = list_entry(it, task_struct, run_list);
-    if (entry->pid == pid)
-      return entry;
-  }
-  return NULL;
+  return pid_find_task(PIDTYPE_PID, pid);
 }
 
 void scheduler_enqueue_task(task_struct *process) {
@@ -88,19 +95,38 @@ void scheduler_enqueue_task(task_struct *process) {
   }
   // Add the new process at the end.
   list_head_insert_before(&process->run_list, &runqueue.queue);
+  // Make it reachable through its identifiers.
+  pid_hash_add(process);
   // Increment the number of active processes.
   ++runqueue.num_active;
+  // Make it runnable.
+  if (process->state == TASK_RUNNING)
+    scheduler_enqueue_runnable(process);
 }
 
 void scheduler_dequeue_task(task_struct *process) {
+  // The process could have been removed already, when it became a zombie.
+  if (list_head_empty(&process->run_list))
+    return;
+  // Remove the process from the runnable ones.
+  scheduler_dequeue_runnable(process);
   // Delete the process from the list of running processes.
   list_head_remove(&process->run_list);
+  pid_hash_del(process);
   // Decrement the number of active processes.
   --runqueue.num_active;
   if (process->se.is_periodic)
     runqueue.num_periodic--;
 }
 
+void scheduler_set_need_resched() {
+  runqueue.need_resched = true;
+}
+
+int scheduler_need_resched() {
+  return runqueue.need_resched;
+}
+
 void scheduler_run(pt_regs *f) {
   // Check if there is a running process.
   if (runqueue.curr == NULL)
@@ -114,18 +140,17 @@ void scheduler_run(pt_regs *f) {
   // We check the existence of pending signals every time we finish
   // handling an interrupt or an exception.
   if (!do_signal(f)) {
+    // We are going to pick the next process.
+    runqueue.need_resched = false;
 #if 1
     if (runqueue.curr->state == EXIT_ZOMBIE) {
       //==== Handle Zombies =================================================
       //dprintf("Handle zombie %d\n", runqueue.curr->pid);
-      // get the next process after the current one
-      list_head *nNode = runqueue.curr->run_list.next;
-      // check if we reached the head of list_head
-      if (nNode == &runqueue.queue) {
-        nNode = nNode->next;
-      }
-      // get the task_struct
-      next = list_entry(nNode, task_struct, run_list);
+      // The zombie cannot run anymore.
+      scheduler_dequeue_runnable(runqueue.curr);
+      // Pick the next process among the runnable ones, the idle task at
+      // least.
+      next = scheduler_pick_next_task(&runqueue);
       // Remove the zombie task.
       scheduler_dequeue_task(runqueue.curr);
       assert(next && "No valid task selected after removing ZOMBIE.");
@@ -133,13 +158,6 @@ void scheduler_run(pt_regs *f) {
     } else {
 #endif
       //==== Scheduling =====================================================
-      // If we are currently executing a periodic process, and this process
-      //  has yet to complete, keep executing it.
-#ifdef SCHEDULER_EDF
-      if (runqueue.curr->se.is_periodic)
-        if (!runqueue.curr->se.executed)
-          return;
-#endif
       // Pointer to the next process to be executed.
       next = scheduler_pick_next_task(&runqueue);
       //=====================================================================
@@ -163,6 +181,10 @@ void scheduler_restore_context(task_struct *process, pt_regs *f) {
   runqueue.curr = process;
   // Restore the registers.
   *f = process->thread.regs;
+  // Show its identity to userspace.
+  vdso_update_task(process);
+  // Point the TLS segment to its storage, %gs is loaded from the frame.
+  gdt_set_tls(process->thread.tls);
   // TODO: Explain paging switch (ring 0 doesn't need page switching)
   // Switch to process page directory
   vmm_switch_directory(process->mm->pgd);
@@ -178,6 +200,11 @@ void scheduler_enter_user_jmp(uintptr_t location, uintptr_t stack) {
   // last context switch time.
   runqueue.curr->se.exec_start = timer_get_ticks();
 
+  // Show its identity to userspace.
+  vdso_update_task(runqueue.curr);
+  // Point the TLS segment to its storage.
+  gdt_set_tls(runqueue.curr->thread.tls);
+
   // Jump in location.
   enter_userspace(location, stack);
 }
@@ -188,11 +215,16 @@ void scheduler_enter_user_jmp(uintptr_t location, uintptr_t stack) {
 /// @param sync Specifies if the wakeup should be synchronous.
 /// @return 1 on success, 0 on failure.
 static inline int try_to_wake_up(task_struct *process, int mode, int sync) {
-  // Only tasks in the state TASK_UNINTERRUPTIBLE can be woke up
-  if (process->state == TASK_UNINTERRUPTIBLE ||
+  // Only sleeping or stopped tasks can be woke up
+  if (process->state == TASK_INTERRUPTIBLE ||
+      process->state == TASK_UNINTERRUPTIBLE ||
       process->state == TASK_STOPPED) {
     //TODO: Recalc task priority
     process->state = TASK_RUNNING;
+    // Put it back among the runnable processes.
+    scheduler_enqueue_runnable(process);
+    // It may be more urgent than the current process.
+    runqueue.need_resched = true;
     return 1;
   }
   return 0;
@@ -203,54 +235,60 @@ int default_wake_function(wait_queue_entry_t *wait, unsigned mode, int sync) {
   return try_to_wake_up(p, mode, sync);
 }
 
-wait_queue_entry_t *sleep_on(wait_queue_head_t *wq) {
-  // Save the sleeping process registers state
+void scheduler_block_task(task_struct *process, long state) {
+  process->state = state;
+  // The scheduler looks only at the runnable processes, try_to_wake_up puts
+  // it back among them.
+  scheduler_dequeue_runnable(process);
+  // Another process has to run in place of the current one.
+  if (process == runqueue.curr)
+    runqueue.need_resched = true;
+}
+
+/// @brief Puts the current process to sleep on the given wait queue.
+/// @param wq Waitqueue where to sleep.
+/// @param state The sleeping state (TASK_INTERRUPTIBLE or TASK_UNINTERRUPTIBLE).
+/// @return Pointer to the entry inside the wq representing the sleeping
+///         process.
+static inline wait_queue_entry_t *__sleep_on(wait_queue_head_t *wq,
+                                             long state) {
+  // Get the sleeping process.
   task_struct *sleeping_task = scheduler_get_current_process();
 
-#if 0
-    pt_regs* f = get_current_interrupt_stack_frame();
-    scheduler_store_context(f, sleeping_task);
-
-    // Select next process in the runqueue as the current, restore it's context,
-    // we assume that the first process is init wich does not sleep (I hope).
-    // This is necessary to make the scheduler_run() in syscall_handler work.
-    task_struct *next = list_entry(runqueue.queue.next, task_struct, run_list);
-    assert((next != sleeping_task) && "The next selected process in the runqueue is the sleeping process");
-    scheduler_restore_context(next, f);
-#endif
+  // The entry of the task can be in a single wait queue, inserting it twice
+  // would corrupt the queue.
+  if (!list_head_empty(&sleeping_task->wait.task_list)) {
+    dprintf("Process %d is already sleeping on a wait queue.\n",
+            sleeping_task->pid);
+    return NULL;
+  }
 
   // Stops task from runqueue making it unrunnable
-  sleeping_task->state = TASK_UNINTERRUPTIBLE;
+  scheduler_block_task(sleeping_task, state);
 
-  // Add sleeping process to sleep wait queue
-  wait_queue_entry_t *wait_entry = kmalloc(sizeof(struct wait_queue_entry_t));
+  // Add sleeping process to sleep wait queue, with the entry of the task.
+  wait_queue_entry_t *wait_entry = &sleeping_task->wait;
   init_waitqueue_entry(wait_entry, sleeping_task);
   add_wait_queue(wq, wait_entry);
 
   return wait_entry;
 }
 
-int is_orphaned_pgrp(pid_t pgid) {
-  pid_t sid = 0;
+wait_queue_entry_t *sleep_on(wait_queue_head_t *wq) {
+  return __sleep_on(wq, TASK_UNINTERRUPTIBLE);
+}
 
-  // Obtain SID of the group from a member
-  list_head *it;
-  list_for_each(it, &runqueue.queue) {
-    task_struct *task = list_entry(it, task_struct, run_list);
-    if (task->pgid == pgid) {
-      sid = task->sid;
-      break;
-    }
-  }
+wait_queue_entry_t *sleep_on_interruptible(wait_queue_head_t *wq) {
+  return __sleep_on(wq, TASK_INTERRUPTIBLE);
+}
 
+int is_orphaned_pgrp(pid_t pgid) {
+  // Obtain SID of the group from a member
+  task_struct *member = pid_find_task(PIDTYPE_PGID, pgid);
+  pid_t sid           = member ? member->sid : 0;
   // Check if the process leader of the session is alive
-  list_for_each(it, &runqueue.queue) {
-    task_struct *task = list_entry(it, task_struct, run_list);
-    if (task->pid == sid) {
-      return 0;
-    }
-  }
-
+  if (pid_find_task(PIDTYPE_PID, sid))
+    return 0;
   return 1;
 }
 
@@ -274,17 +312,12 @@ pid_t sys_getsid(pid_t pid) {
     return runqueue.curr->sid;
   }
   //If != 0 get SID of the specified process
-  list_head *it;
-  list_for_each(it, &runqueue.queue) {
-    task_struct *task = list_entry(it, task_struct, run_list);
-    if (task->pid == pid) {
-      if (runqueue.curr->sid != task->sid)
-        return -EPERM;
-
-      return task->sid;
-    }
-  }
-  return -ESRCH;
+  task_struct *task = pid_find_task(PIDTYPE_PID, pid);
+  if (task == NULL)
+    return -ESRCH;
+  if (runqueue.curr->sid != task->sid)
+    return -EPERM;
+  return task->sid;
 }
 
 pid_t sys_setsid() {
@@ -297,8 +330,8 @@ pid_t sys_setsid() {
     return -EPERM;
   }
 
-  task->sid  = task->pid;
-  task->pgid = task->pid;
+  pid_hash_change(task, PIDTYPE_SID, task->pid);
+  pid_hash_change(task, PIDTYPE_PGID, task->pid);
 
   return task->sid;
 }
@@ -323,7 +356,7 @@ int sys_setpgid(pid_t pid, pid_t pgid) {
   if (task) {
     if (task->pgid == task->pid)
       dprintf("Process %d is already a session leader.", task->pid);
-    task->pgid = pgid;
+    pid_hash_change(task, PIDTYPE_PGID, pgid);
   }
   return 0;
 }
@@ -389,7 +422,12 @@ int sys_nice(int increment) {
 
   if (PRIO_TO_NICE(runqueue.curr->se.prio) != newNice && newNice >= MIN_NICE &&
       newNice <= MAX_NICE) {
+    // Move the process to the list of its new priority.
+    int runnable = scheduler_dequeue_runnable(runqueue.curr);
     runqueue.curr->se.prio = NICE_TO_PRIO(newNice);
+    if (runnable)
+      scheduler_enqueue_runnable(runqueue.curr);
+    runqueue.need_resched = true;
   }
   int actualNice = PRIO_TO_NICE(runqueue.curr->se.prio);
 
@@ -424,16 +462,11 @@ pid_t sys_waitpid(pid_t pid, int *status, int options) {
   if (list_head_empty(&runqueue.curr->children)) {
     return -ECHILD;
   }
+  // Children put themselves in the list of zombies when they exit.
   list_head *it;
-  list_for_each(it, &runqueue.curr->children) {
-    task_struct *entry = list_entry(it, task_struct, sibling);
-    if (entry == NULL) {
-      continue;
-    }
-    if (entry->state != EXIT_ZOMBIE) {
-      continue;
-    }
-    if ((pid > 1) && (entry->pid != pid)) {
+  list_for_each(it, &runqueue.curr->zombies) {
+    task_struct *entry = list_entry(it, task_struct, zombie_node);
+    if ((pid > 0) && (entry->pid != pid)) {
       continue;
     }
     // Save the pid to return.
@@ -443,17 +476,38 @@ pid_t sys_waitpid(pid_t pid, int *status, int options) {
       (*status) = entry->state;
     // Finalize the VFS structures.
     vfs_destroy_task(entry);
+    // Release the signal handlers.
+    sighand_put(entry->sighand);
     // Remove entry from children of parent.
     list_head_remove(&entry->sibling);
+    list_head_remove(&entry->zombie_node);
     // Remove entry from the scheduling queue.
     scheduler_dequeue_task(entry);
+    // Its pid can be given again.
+    pid_free(entry->pid);
     // Delete the task_struct.
     kfree(entry);
     dprintf("Process %d is freeing memory of process %d.\n", runqueue.curr->pid,
             ppid);
     return ppid;
   }
-  return 0;
+  // The process we are waiting for must be one of our children.
+  if (pid > 0) {
+    task_struct *child = pid_find_task(PIDTYPE_PID, pid);
+    if ((child == NULL) || (child->parent != runqueue.curr))
+      return -ECHILD;
+  }
+  if (options & WNOHANG) {
+    return 0;
+  }
+  // A signal interrupts the wait.
+  if (runqueue.curr->sigpending) {
+    return -EINTR;
+  }
+  // Sleep until a child exits, then look again, or until a signal arrives,
+  // which makes the system call fail with -EINTR.
+  sleep_on_interruptible(&runqueue.curr->wait_chldexit);
+  return -ERESTART;
 }
 
 void sys_exit(int exit_code) {
@@ -470,8 +524,14 @@ void sys_exit(int exit_code) {
 
   // Set the termination code of the process.
   runqueue.curr->exit_code = (exit_code << 8) & 0xFF00;
-  // Set the state of the process to zombie.
-  runqueue.curr->state = EXIT_ZOMBIE;
+  // Set the state of the process to zombie, it cannot run anymore.
+  scheduler_block_task(runqueue.curr, EXIT_ZOMBIE);
+  // Let the parent reap it, and wake it up if it is waiting for us.
+  if (runqueue.curr->parent) {
+    list_head_insert_before(&runqueue.curr->zombie_node,
+                            &runqueue.curr->parent->zombies);
+    wake_up_all(&runqueue.curr->parent->wait_chldexit);
+  }
   // Send a SIGCHLD to the parent process.
   if (runqueue.curr->parent) {
     int ret = sys_kill(runqueue.curr->parent->pid, SIGCHLD);
@@ -495,6 +555,15 @@ void sys_exit(int exit_code) {
     dprintf("}\n");
     // Plug the list of children.
     list_head_append(&init_proc->children, &runqueue.curr->children);
+    // The children which already exited are reaped by init too.
+    if (!list_head_empty(&runqueue.curr->zombies)) {
+      list_head *zombie, *store;
+      list_for_each_safe (zombie, store, &runqueue.curr->zombies) {
+        list_head_remove(zombie);
+        list_head_insert_before(zombie, &init_proc->zombies);
+      }
+      wake_up_all(&init_proc->wait_chldexit);
+    }
     // Print the list of children.
     dprintf("New list of init children (%d): {\n", init_proc->pid);
     list_for_each_decl(it, &init_proc->children) {
@@ -503,82 +572,142 @@ void sys_exit(int exit_code) {
     }
     dprintf("}\n");
   }
-  // Free the space occupied by the stack.
-  mmu_destroy_process_image(runqueue.curr->mm);
+  // Stop the timer releasing the next period.
+  if (runqueue.curr->se.period_timer) {
+    del_timer(runqueue.curr->se.period_timer);
+    kfree(runqueue.curr->se.period_timer);
+    runqueue.curr->se.period_timer = NULL;
+  }
+  // Free the space occupied by the stack, unless other threads still use it.
+  mmu_put_process_image(runqueue.curr->mm);
   // Debugging message.
   dprintf("Process %d exited with value %d\n", runqueue.curr->pid, exit_code);
 }
 
-int sys_sched_setparam(pid_t pid, const sched_param_t *param) {
-  list_head *it;
-  // Iter over the runqueue to find the task
-  list_for_each(it, &runqueue.queue) {
-    task_struct *entry = list_entry(it, task_struct, run_list);
-    if (entry->pid == pid) {
-      if (!entry->se.is_periodic && param->is_periodic)
-        runqueue.num_periodic++;
-      else if (entry->se.is_periodic && !param->is_periodic)
-        runqueue.num_periodic--;
-      // Sets the parameters from param to the "se" struct parameters.
-      entry->se.prio        = param->sched_priority;
-      entry->se.period      = param->period;
-      entry->se.arrivaltime = param->arrivaltime;
-      entry->se.is_periodic = param->is_periodic;
-      entry->se.deadline    = timer_get_ticks() + param->deadline;
-      entry->se.next_period = timer_get_ticks();
-
-      entry->se.is_under_analysis = true;
-      entry->se.executed          = false;
-      return 1;
-    }
+/// @brief Checks the scheduling parameters given by the user.
+/// @param param the parameters.
+/// @return 0 if they are valid, -EINVAL otherwise.
+static inline int __sched_param_check(const sched_param_t *param) {
+  // Periodic tasks must have a period.
+  if (param->is_periodic && (param->period == 0))
+    return -EINVAL;
+  switch (param->sched_policy) {
+  case SCHED_FIFO:
+  case SCHED_RR:
+    // Real-time tasks take the priorities above the time-sharing ones.
+    if ((param->sched_priority < 0) || (param->sched_priority >= MAX_RT_PRIO))
+      return -EINVAL;
+    return 0;
+  case SCHED_NORMAL:
+  case SCHED_BATCH:
+  case SCHED_IDLE:
+    if ((param->sched_priority < MAX_RT_PRIO) ||
+        (param->sched_priority >= MAX_PRIO))
+      return -EINVAL;
+    return 0;
+  case SCHED_DEADLINE:
+    // Deadline tasks get their deadlines from the period. The class has no
+    // runtime budget, an aperiodic task would keep its deadline forever and
+    // starve the other classes.
+    if (!param->is_periodic)
+      return -EINVAL;
+    return 0;
+  default:
+    return -EINVAL;
   }
-  return -1;
+}
+
+int sys_sched_setparam(pid_t pid, const sched_param_t *param) {
+  int ret = __sched_param_check(param);
+  if (ret < 0)
+    return ret;
+  // Find the task.
+  task_struct *entry = scheduler_get_running_process(pid);
+  if (entry == NULL)
+    return -ESRCH;
+  if (!entry->se.is_periodic && param->is_periodic)
+    runqueue.num_periodic++;
+  else if (entry->se.is_periodic && !param->is_periodic)
+    runqueue.num_periodic--;
+  // Take the process out of its class, before changing what its class uses to
+  // keep it.
+  int runnable = scheduler_dequeue_runnable(entry);
+  // Sets the parameters from param to the "se" struct parameters.
+  if (param->sched_policy != SCHED_DEADLINE)
+    entry->se.prio = param->sched_priority;
+  entry->se.policy      = param->sched_policy;
+  entry->se.period      = param->period;
+  entry->se.arrivaltime = param->arrivaltime;
+  entry->se.is_periodic = param->is_periodic;
+  entry->se.deadline    = timer_get_ticks() + param->deadline;
+  entry->se.next_period = timer_get_ticks();
+
+  entry->se.is_under_analysis = true;
+  entry->se.executed          = false;
+  // Move the process to the class of its new policy.
+  scheduler_set_sched_class(entry);
+  if (runnable)
+    scheduler_enqueue_runnable(entry);
+  runqueue.need_resched = true;
+  return 1;
 }
 
 int sys_sched_getparam(pid_t pid, sched_param_t *param) {
-  list_head *it;
-  // Iter over the runqueue to find the task
-  list_for_each(it, &runqueue.queue) {
-    task_struct *entry = list_entry(it, task_struct, run_list);
-    if (entry->pid == pid) {
-      //Sets the parameters from the "se" struct to param
-      param->sched_priority = entry->se.prio;
-      param->period         = entry->se.period;
-      param->deadline       = entry->se.deadline;
-      param->arrivaltime    = entry->se.arrivaltime;
-      return 1;
-    }
-  }
-  return -1;
+  // Find the task.
+  task_struct *entry = scheduler_get_running_process(pid);
+  if (entry == NULL)
+    return -ESRCH;
+  //Sets the parameters from the "se" struct to param
+  param->sched_priority = entry->se.prio;
+  param->sched_policy   = entry->se.policy;
+  param->period         = entry->se.period;
+  param->deadline       = entry->se.deadline;
+  param->arrivaltime    = entry->se.arrivaltime;
+  return 1;
+}
+
+/// @brief Checks if two periodic tasks are admitted in the same class. Their
+/// current class is not used, since tasks under analysis are time-sharing.
+/// @param a the first task.
+/// @param b the second task.
+/// @return true if both are deadline tasks, or both are fixed priority tasks.
+static inline bool_t __same_periodic_class(task_struct *a, task_struct *b) {
+  bool_t a_rt = (a->se.policy == SCHED_FIFO) || (a->se.policy == SCHED_RR);
+  bool_t b_rt = (b->se.policy == SCHED_FIFO) || (b->se.policy == SCHED_RR);
+  return (a->se.policy == b->se.policy) || (a_rt && b_rt);
 }
 
-/// @brief Performs the response time analysis for the current list of periodic
-/// processes.
-/// @return 1 if scheduling periodic processes is feasible, 0 otherwise.
-static int __response_time_analysis() {
+/// @brief Performs the response time analysis for the periodic processes in
+/// the same class of the given task.
+/// @param task the task under analysis.
+/// @return 1 if scheduling periodic processes is not feasible, 0 otherwise.
+/// @details The deadline of each job is the beginning of the next period.
+static int __response_time_analysis(task_struct *task) {
   task_struct *entry, *previous;
   time_t r, previous_r = 0;
   list_for_each_decl(it, &runqueue.queue) {
     // Get the curent entry in the list.
     entry = list_entry(it, task_struct, run_list);
-    // If the process is not periodic we skip it.
-    if (!entry->se.is_periodic)
+    // Skip the processes which are not periodic, or in another class.
+    if (!entry->se.is_periodic || !__same_periodic_class(entry, task))
       continue;
     // Put r equal to worst case exec because is the first point in time
     // that the task could possibly complete.
     r = entry->se.worst_case_exec, previous_r = 0;
     // The analysis can be completed either missing the deadline or reaching
     // a fixed point.
-    while ((r < entry->se.deadline) && (r != previous_r)) {
+    while ((r <= entry->se.period) && (r != previous_r)) {
       // Save the previous response time.
       previous_r = r;
       // Initialize response time.
       r = entry->se.worst_case_exec;
       list_for_each_decl(it2, &runqueue.queue) {
         previous = list_entry(it2, task_struct, run_list);
-        // Check the interferences of higher priority processes.
-        if (previous->se.is_periodic &&
-            (previous->se.period < entry->se.period)) {
+        // Check the interferences of the processes of the same class, with
+        // higher or equal priority (a lower value is a higher priority).
+        if ((previous != entry) && previous->se.is_periodic &&
+            __same_periodic_class(previous, entry) &&
+            (previous->se.prio <= entry->se.prio)) {
           dprintf("%d += (%.2f / %.2f) * %d\n", r, (double)previous_r,
                   (double)previous->se.period, previous->se.worst_case_exec);
 
@@ -593,27 +722,54 @@ static int __response_time_analysis() {
     }
     // Feasibility of scheduler is guaranteed if and only if response time
     // analysis is lower than deadline.
-    if (r > entry->se.deadline)
+    if (r > entry->se.period)
       return 1;
   }
   return 0;
 }
 
-/// @brief Computes the total utilization factor.
+/// @brief Computes the total utilization factor of the periodic tasks in the
+/// same class of the given task.
+/// @param task the task under analysis.
 /// @return the utilization factor.
-static inline double __compute_utilization_factor() {
+static inline double __compute_utilization_factor(task_struct *task) {
   task_struct *entry;
   double U = 0;
   list_for_each_decl(it, &runqueue.queue) {
     // Get the entry.
     entry = list_entry(it, task_struct, run_list);
-    // Sum the utilization factor of all periodic tasks.
-    if (entry->se.is_periodic)
+    // Sum the utilization factor of the periodic tasks of the same class.
+    if (entry->se.is_periodic && __same_periodic_class(entry, task))
       U += entry->se.utilization_factor;
   }
   return U;
 }
 
+/// @brief Releases the next job of a periodic task, which becomes runnable
+/// with a new absolute deadline.
+/// @param task the periodic task.
+static void __periodic_release(task_struct *task) {
+  task->se.executed = false;
+  // The job must complete before the next period begins.
+  task->se.deadline = task->se.next_period + task->se.period;
+  task->state       = TASK_RUNNING;
+  scheduler_enqueue_runnable(task);
+  runqueue.need_resched = true;
+}
+
+/// @brief Function executed when the period timer of a task expires.
+/// @param pid PID of the periodic task.
+static void __periodic_release_timeout(unsigned long pid) {
+  task_struct *task = scheduler_get_running_process(pid);
+  if (task == NULL)
+    return;
+  // The timer is freed once we return.
+  task->se.period_timer = NULL;
+  if (task->se.is_periodic && task->se.executed &&
+      (task->state == TASK_UNINTERRUPTIBLE))
+    __periodic_release(task);
+}
+
 int sys_waitperiod() {
   // Get the current process.
   task_struct *current = scheduler_get_current_process();
@@ -644,44 +800,40 @@ int sys_waitperiod() {
     current->se.worst_case_exec = current->se.sum_exec_runtime;
     // This will keep track if the process can be scheduled.
     bool_t is_not_schedulable = false;
-#if defined(SCHEDULER_EDF)
-    // Compute the total utilization factor.
-    double u = __compute_utilization_factor();
-    // If the utilization factor is above 1, the process cannot be placed
-    // with the other periodic processes.
-    if (u > 1) {
-      is_not_schedulable = true;
-    }
-    dprintf("Utilization factor is : %.2f\n", u);
-#elif defined(SCHEDULER_RM)
-    // Compute the total utilization factor.
-    double u = __compute_utilization_factor();
-    // Calculating Least Upper Bound of utilization factor. For large amount
-    // of processes ulub asymptotically should reach ln(2).
-    double ulub =
-      (runqueue.num_periodic * (pow(2, (1.0 / runqueue.num_periodic)) - 1));
-    // If the sum of utilization factor is bounded between ulub and 1 we
-    // need to calculate the response time analysis for each process.
-    if (u > 1) {
-      is_not_schedulable = true;
-    } else if (u <= ulub) {
-      is_not_schedulable = false;
-    } else {
-      is_not_schedulable = __response_time_analysis();
+    // The test depends on how the policy of the task orders the jobs.
+    if (current->se.policy == SCHED_DEADLINE) {
+      // Compute the total utilization factor.
+      double u = __compute_utilization_factor(current);
+      // If the utilization factor is above 1, the process cannot be placed
+      // with the other periodic processes.
+      if (u > 1) {
+        is_not_schedulable = true;
+      }
+      dprintf("Utilization factor is : %.2f\n", u);
+    } else if ((current->se.policy == SCHED_FIFO) ||
+               (current->se.policy == SCHED_RR)) {
+      // Fixed priorities, set through sched_setparam.
+      // Compute the total utilization factor.
+      double u = __compute_utilization_factor(current);
+      // The least upper bound of Liu and Layland holds only when priorities
+      // are assigned by period, here they are chosen by the user, so below 1
+      // we always calculate the response time analysis for each process.
+      if (u > 1) {
+        is_not_schedulable = true;
+      } else {
+        is_not_schedulable = __response_time_analysis(current);
+      }
+      dprintf("Utilization factor is : %.2f\n", u);
     }
-    dprintf("Utilization factor is : %.2f, Least Upper Bound: %.2f\n", u, ulub);
-#endif
     // If it is not schedulable, we need to tell it to the process.
     if (is_not_schedulable)
       return -ENOTSCHEDULABLE;
     // Otherwise, it is schedulable and thus it is not under analysis
     // anymore.
     current->se.is_under_analysis = false;
-    // The task has been executed as non-periodic process so that his
-    // deadline is not been updated by the scheduling algorithm of periodic
-    // tasks. We need to update it manually.
+    // The task has been executed as non-periodic process, its periods start
+    // from now.
     current->se.next_period = current_time;
-    current->se.deadline    = current_time + current->se.period;
   }
   // If the current time is ahead of the deadline, we need to print a warning.
   if (current_time > current->se.deadline) {
@@ -690,5 +842,23 @@ int sys_waitperiod() {
   }
   // Tell the scheduler that we have executed the periodic process.
   current->se.executed = true;
+  // The next job is released at the beginning of the next period.
+  current->se.next_period += current->se.period;
+  scheduler_block_task(current, TASK_UNINTERRUPTIBLE);
+  // Once admitted, the task leaves the time-sharing tasks for its own class.
+  scheduler_set_sched_class(current);
+  if ((int)(current_time - current->se.next_period) >= 0) {
+    // We are late, the next job is already released.
+    __periodic_release(current);
+    return 0;
+  }
+  // Sleep until the next period.
+  struct timer_list *timer = kmalloc(sizeof(struct timer_list));
+  init_timer(timer);
+  timer->expires           = current->se.next_period;
+  timer->function          = &__periodic_release_timeout;
+  timer->data              = current->pid;
+  current->se.period_timer = timer;
+  add_timer(timer);
   return 0;
 }
@@ -5,6 +5,7 @@
 #include <kernel/process/elf.h>
 
 #include <arch/i386/timer.h>
+#include <arch/i386/gdt.h>
 
 #include <kernel/kernel.h>
 #include <kernel/memory/mmu.h>
@@ -91,6 +92,8 @@ static int __reset_process(task_struct *task) {
   task->thread.regs.useresp = task->thread.regs.ebp;
   // Enable the interrupts.
   task->thread.regs.eflags = task->thread.regs.eflags | EFLAG_IF;
+  // The new program has no thread-local storage yet.
+  task->thread.tls = 0;
 
   // Restore previous pgdir
   vmm_switch_directory(cur_pgd);
@@ -112,12 +115,9 @@ static int __load_executable(const char *path, task_struct *task,
     dprintf("This is not a valid ELF executable `%s`!\n", path);
     return 0;
   }
-  // FIXME: When threads will be implemented
-  // they should share the mm, so the destroy_process_image must be called
-  // only when all the threads are terminated. This can be accomplished by using
-  // an internal counter on the mm.
+  // The threads sharing the mm keep using it, it is destroyed by the last one.
   if (task->mm)
-    mmu_destroy_process_image(task->mm);
+    mmu_put_process_image(task->mm);
   // Return code variable.
   int ret = 0;
   // Recreate the memory of the process.
@@ -133,18 +133,26 @@ static int __load_executable(const char *path, task_struct *task,
 }
 
 static inline task_struct *__alloc_task(task_struct *source,
-                                        task_struct *parent, const char *name) {
+                                        task_struct *parent, const char *name,
+                                        unsigned long clone_flags) {
   // Create a new task_struct.
   // task_struct *proc = kmem_cache_alloc(task_struct_cache, GFP_KERNEL);
   task_struct *proc = kmalloc(sizeof(task_struct));
   // Clear the memory.
   memset(proc, 0, sizeof(task_struct));
   // Set the id of the process.
-  proc->pid = scheduler_getpid();
+  proc->pid = pid_alloc();
+  if (proc->pid < 0) {
+    dprintf("There are no free process identifiers.\n");
+    kfree(proc);
+    return NULL;
+  }
   // Set the state of the process as running.
   proc->state = TASK_RUNNING;
   // Set the current opened file descriptors and the maximum number of file descriptors.
-  if (source)
+  if (source && (clone_flags & CLONE_FILES))
+    vfs_share_task(proc, source);
+  else if (source)
     vfs_dup_task(proc, source);
   else
     vfs_init_task(proc);
@@ -152,10 +160,23 @@ static inline task_struct *__alloc_task(task_struct *source,
   proc->parent = parent;
   // Initialize the list_head.
   list_head_init(&proc->run_list);
+  // Initialize the entries of the pid hash tables.
+  for (int type = 0; type < PIDTYPE_MAX; ++type)
+    list_head_init(&proc->pid_links[type]);
+  // Initialize the entry used to sleep on wait queues.
+  init_waitqueue_entry(&proc->wait, proc);
+  list_head_init(&proc->wait.task_list);
+  // Initialize the priority array list_head.
+  list_head_init(&proc->prio_list);
   // Initialize the children list_head.
   list_head_init(&proc->children);
   // Initialize the sibling list_head.
   list_head_init(&proc->sibling);
+  // Initialize the lists of exited children.
+  list_head_init(&proc->zombies);
+  list_head_init(&proc->zombie_node);
+  list_head_init(&proc->wait_chldexit.task_list);
+  spinlock_init(&proc->wait_chldexit.lock);
   // If we have a parent, set the sibling child relation.
   if (parent) {
     // Set the new_process as child of current.
@@ -169,6 +190,7 @@ static inline task_struct *__alloc_task(task_struct *source,
   proc->sid                   = 0;
   proc->pgid                  = 0;
   proc->se.prio               = DEFAULT_PRIO;
+  proc->se.policy             = SCHED_NORMAL;
   proc->se.start_runtime      = timer_get_ticks();
   proc->se.exec_start         = timer_get_ticks();
   proc->se.exec_runtime       = 0;
@@ -183,6 +205,11 @@ static inline task_struct *__alloc_task(task_struct *source,
   proc->se.next_period        = 0;
   proc->se.worst_case_exec    = 0;
   proc->se.utilization_factor = 0;
+  // Initialize the nodes of the scheduler trees.
+  rb_node_init(&proc->se.run_node);
+  rb_node_init(&proc->se.dl_node);
+  // New tasks are time-sharing ones.
+  scheduler_set_sched_class(proc);
   // Initialize the exit code of the process.
   proc->exit_code = 0;
   // Copy the name.
@@ -197,14 +224,12 @@ static inline task_struct *__alloc_task(task_struct *source,
     strcpy(proc->cwd, source->cwd);
   else
     strcpy(proc->cwd, "/");
-  // Clear the signal handler.
-  memset(&proc->sighand, 0x00, sizeof(sighand_t));
-  spinlock_init(&proc->sighand.siglock);
-  atomic_set(&proc->sighand.count, 0);
-  for (int i = 0; i < NSIG; ++i) {
-    proc->sighand.action[i].sa_handler = SIG_DFL;
-    sigemptyset(&proc->sighand.action[i].sa_mask);
-    proc->sighand.action[i].sa_flags = 0;
+  // Share the signal handlers, or start from the default ones.
+  if (source && (clone_flags & CLONE_SIGHAND)) {
+    proc->sighand = source->sighand;
+    ++proc->sighand->count;
+  } else {
+    proc->sighand = sighand_alloc();
   }
   // Clear the masks.
   sigemptyset(&proc->blocked);
@@ -241,33 +266,33 @@ int tasking_init() {
 task_struct *create_task_test(const char *name) {
   dprintf("Building (%s) process...\n", name);
   // Allocate the memory for the process.
-  init_proc = __alloc_task(NULL, NULL, name);
+  init_proc = __alloc_task(NULL, NULL, name, 0);
 
   // == INITIALIZE `/proc/video` ============================================
   // Check that the fd_list is initialized.
-  assert(init_proc->fd_list && "File descriptor list not initialized.");
-  assert((init_proc->max_fd > 3) &&
+  assert(init_proc->files->fd_list && "File descriptor list not initialized.");
+  assert((init_proc->files->max_fd > 3) &&
          "File descriptor list cannot contain the standard IOs.");
 
   // // Create STDIN descriptor.
   // vfs_file_t *stdin = vfs_open("/proc/video", O_RDONLY, 0);
   // stdin->count++;
-  // init_proc->fd_list[STDIN_FILENO].file_struct = stdin;
-  // init_proc->fd_list[STDIN_FILENO].flags_mask  = O_RDONLY;
+  // init_proc->files->fd_list[STDIN_FILENO].file_struct = stdin;
+  // init_proc->files->fd_list[STDIN_FILENO].flags_mask  = O_RDONLY;
   // dprintf("`/proc/video` stdin  : %p\n", stdin);
 
   // // Create STDOUT descriptor.
   // vfs_file_t *stdout = vfs_open("/proc/video", O_WRONLY, 0);
   // stdout->count++;
-  // init_proc->fd_list[STDOUT_FILENO].file_struct = stdout;
-  // init_proc->fd_list[STDOUT_FILENO].flags_mask  = O_WRONLY;
+  // init_proc->files->fd_list[STDOUT_FILENO].file_struct = stdout;
+  // init_proc->files->fd_list[STDOUT_FILENO].flags_mask  = O_WRONLY;
   // dprintf("`/proc/video` stdout : %p\n", stdout);
 
   // // Create STDERR descriptor.
   // vfs_file_t *stderr = vfs_open("/proc/video", O_WRONLY, 0);
   // stderr->count++;
-  // init_proc->fd_list[STDERR_FILENO].file_struct = stderr;
-  // init_proc->fd_list[STDERR_FILENO].flags_mask  = O_WRONLY;
+  // init_proc->files->fd_list[STDERR_FILENO].file_struct = stderr;
+  // init_proc->files->fd_list[STDERR_FILENO].flags_mask  = O_WRONLY;
   // dprintf("`/proc/video` stderr : %p\n", stderr);
   // ------------------------------------------------------------------------
 
@@ -325,33 +350,33 @@ task_struct *create_task_test(const char *name) {
 task_struct *process_create_init(const char *path) {
   dprintf("Building init process...\n");
   // Allocate the memory for the process.
-  init_proc = __alloc_task(NULL, NULL, "init");
+  init_proc = __alloc_task(NULL, NULL, "init", 0);
 
   // == INITIALIZE `/proc/video` ============================================
   // Check that the fd_list is initialized.
-  assert(init_proc->fd_list && "File descriptor list not initialized.");
-  assert((init_proc->max_fd > 3) &&
+  assert(init_proc->files->fd_list && "File descriptor list not initialized.");
+  assert((init_proc->files->max_fd > 3) &&
          "File descriptor list cannot contain the standard IOs.");
 
   // Create STDIN descriptor.
   vfs_file_t *stdin = vfs_open("/proc/video", O_RDONLY, 0);
   stdin->count++;
-  init_proc->fd_list[STDIN_FILENO].file_struct = stdin;
-  init_proc->fd_list[STDIN_FILENO].flags_mask  = O_RDONLY;
+  init_proc->files->fd_list[STDIN_FILENO].file_struct = stdin;
+  init_proc->files->fd_list[STDIN_FILENO].flags_mask  = O_RDONLY;
   dprintf("`/proc/video` stdin  : %p\n", stdin);
 
   // Create STDOUT descriptor.
   vfs_file_t *stdout = vfs_open("/proc/video", O_WRONLY, 0);
   stdout->count++;
-  init_proc->fd_list[STDOUT_FILENO].file_struct = stdout;
-  init_proc->fd_list[STDOUT_FILENO].flags_mask  = O_WRONLY;
+  init_proc->files->fd_list[STDOUT_FILENO].file_struct = stdout;
+  init_proc->files->fd_list[STDOUT_FILENO].flags_mask  = O_WRONLY;
   dprintf("`/proc/video` stdout : %p\n", stdout);
 
   // Create STDERR descriptor.
   vfs_file_t *stderr = vfs_open("/proc/video", O_WRONLY, 0);
   stderr->count++;
-  init_proc->fd_list[STDERR_FILENO].file_struct = stderr;
-  init_proc->fd_list[STDERR_FILENO].flags_mask  = O_WRONLY;
+  init_proc->files->fd_list[STDERR_FILENO].file_struct = stderr;
+  init_proc->files->fd_list[STDERR_FILENO].flags_mask  = O_WRONLY;
   dprintf("`/proc/video` stderr : %p\n", stderr);
   // ------------------------------------------------------------------------
 
@@ -403,6 +428,38 @@ task_struct *process_create_init(const char *path) {
   return init_proc;
 }
 
+/// @brief The body of the idle task, it halts until the next interrupt, which
+/// could make another task runnable.
+static void __idle_loop() {
+  for (;;)
+    __asm__ __volatile__("sti; hlt");
+}
+
+task_struct *process_create_idle() {
+  // The idle task shares the kernel page directory, and it has no user memory.
+  static mm_struct_t idle_mm;
+  task_struct *idle = __alloc_task(NULL, NULL, "idle", 0);
+  if (idle == NULL)
+    return NULL;
+  list_head_init(&idle_mm.mmap_list);
+  list_head_init(&idle_mm.mm_list);
+  idle_mm.pgd = vmm_get_kernel_directory();
+  idle->mm    = &idle_mm;
+  // It runs in the kernel, with interrupts enabled.
+  idle->thread.regs.cs     = 0x08;
+  idle->thread.regs.ds     = 0x10;
+  idle->thread.regs.es     = 0x10;
+  idle->thread.regs.fs     = 0x10;
+  idle->thread.regs.gs     = 0x10;
+  idle->thread.regs.ss     = 0x10;
+  idle->thread.regs.eflags = 0x202;
+  idle->thread.regs.eip    = (uintptr_t)__idle_loop;
+  // Make it the task of the idle class.
+  scheduler_init_idle(idle);
+  dprintf("Created the idle task (pid: %d).\n", idle->pid);
+  return idle;
+}
+
 char *sys_getcwd(char *buf, size_t size) {
   task_struct *current = scheduler_get_current_process();
   if ((current != NULL) && (buf != NULL)) {
@@ -434,10 +491,10 @@ int sys_fchdir(int fd) {
   task_struct *current = scheduler_get_current_process();
   assert(current && "There is no running process.");
   // Check if it is a valid file descriptor.
-  if ((fd < 0) || (fd >= current->max_fd))
+  if ((fd < 0) || (fd >= current->files->max_fd))
     return -EBADF;
   // Get the file descriptor.
-  vfs_file_descriptor_t *vfd = &current->fd_list[fd];
+  vfs_file_descriptor_t *vfd = &current->files->fd_list[fd];
   // Check if the file descriptor file is set.
   if (vfd->file_struct == NULL)
     return -ENOENT;
@@ -450,24 +507,50 @@ int sys_fchdir(int fd) {
   return 0;
 }
 
-pid_t sys_fork(pt_regs *f) {
+/// @brief Creates a child of the current process, the child returns to
+/// userspace with the registers of the parent, except for eax.
+/// @param f           The registers of the parent.
+/// @param clone_flags What the child shares with the parent (CLONE_*).
+/// @param stack       The stack of the child, 0 to keep the one of the parent.
+/// @param tls         The base of the thread-local storage (CLONE_SETTLS).
+/// @return The PID of the child, a negative errno on failure.
+static pid_t __do_fork(pt_regs *f, unsigned long clone_flags, uintptr_t stack,
+                       uintptr_t tls) {
   task_struct *current = scheduler_get_current_process();
   if (current == NULL)
     kernel_panic("There is no current process!");
 
-  dprintf("Forking   '%s' (pid: %d)...\n", current->name, current->pid);
+  dprintf("Forking   '%s' (pid: %d, flags: 0x%x)...\n", current->name,
+          current->pid, (unsigned)clone_flags);
 
   // Update current process registers, they should be equal
   // to the ones of the child process, except for eax.
   scheduler_store_context(f, current);
   // Allocate the memory for the process.
-  task_struct *proc = __alloc_task(current, current, current->name);
-  // Copy the father's stack, memory, heap etc... to the child process
-  proc->mm = mmu_clone_process_image(current->mm);
+  task_struct *proc =
+    __alloc_task(current, current, current->name, clone_flags);
+  if (proc == NULL)
+    return -EAGAIN;
+  if (clone_flags & CLONE_VM) {
+    // Threads share the memory, which is freed by the last of them.
+    proc->mm = current->mm;
+    ++proc->mm->mm_users;
+  } else {
+    // Copy the father's stack, memory, heap etc... to the child process
+    proc->mm = mmu_clone_process_image(current->mm);
+  }
   // Set the eax as 0, to indicate the child process
   proc->thread.regs.eax = 0;
   // Enable the interrupts.
   proc->thread.regs.eflags = proc->thread.regs.eflags | EFLAG_IF;
+  // Move the child on its own stack.
+  if (stack)
+    proc->thread.regs.useresp = stack;
+  // Give the child its thread-local storage, selected by %gs.
+  if (clone_flags & CLONE_SETTLS) {
+    proc->thread.tls     = tls;
+    proc->thread.regs.gs = GDT_TLS_SELECTOR;
+  }
 
   // Copy session and group id of the parent into the child
   proc->sid  = current->sid;
@@ -485,6 +568,27 @@ pid_t sys_fork(pt_regs *f) {
   return proc->pid;
 }
 
+pid_t sys_fork(pt_regs *f) {
+  return __do_fork(f, 0, 0, 0);
+}
+
+pid_t sys_clone(pt_regs *f) {
+  unsigned long clone_flags = f->ebx;
+  uintptr_t stack           = f->ecx;
+  uintptr_t tls             = f->esi;
+  // Check the flags we support.
+  if (clone_flags &
+      ~(CSIGNAL | CLONE_VM | CLONE_FILES | CLONE_SIGHAND | CLONE_SETTLS))
+    return -EINVAL;
+  // The signal handlers live in the memory of the process.
+  if ((clone_flags & CLONE_SIGHAND) && !(clone_flags & CLONE_VM))
+    return -EINVAL;
+  // Two threads cannot run on the same stack.
+  if ((clone_flags & CLONE_VM) && !stack)
+    return -EINVAL;
+  return __do_fork(f, clone_flags, stack, tls);
+}
+
 int sys_execve(pt_regs *f) {
   // Check the current process.
   task_struct *current = scheduler_get_current_process();
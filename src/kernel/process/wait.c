@@ -28,3 +28,14 @@ void remove_wait_queue(wait_queue_head_t *head, wait_queue_entry_t *wq) {
   __remove_wait_queue(head, wq);
   spinlock_unlock(&head->lock);
 }
+
+void wake_up_all(wait_queue_head_t *head) {
+  list_head *it, *store;
+  spinlock_lock(&head->lock);
+  list_for_each_safe (it, store, &head->task_list) {
+    wait_queue_entry_t *entry = list_entry(it, wait_queue_entry_t, task_list);
+    __remove_wait_queue(head, entry);
+    entry->func(entry, 0, 0);
+  }
+  spinlock_unlock(&head->lock);
+}
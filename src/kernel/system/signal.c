@@ -65,17 +65,17 @@ static inline void __clear_siginfo(siginfo_t *info) {
 
 static inline void __lock_task_sighand(struct task_struct *t) {
   assert(t && "Null task struct.");
-  spinlock_lock(&t->sighand.siglock);
+  spinlock_lock(&t->sighand->siglock);
 }
 
 static inline void __unlock_task_sighand(struct task_struct *t) {
   assert(t && "Null task struct.");
-  spinlock_unlock(&t->sighand.siglock);
+  spinlock_unlock(&t->sighand->siglock);
 }
 
 static sighandler_t __get_handler(struct task_struct *t, int sig) {
   assert(t && "Null task struct.");
-  return t->sighand.action[sig - 1].sa_handler;
+  return t->sighand->action[sig - 1].sa_handler;
 }
 
 static int __sig_is_ignored(struct task_struct *t, int sig) {
@@ -121,6 +121,22 @@ static void __sigqueue_free(sigqueue_t *q) {
 /// @param info The signal info
 /// @param t    The process to which we send the signal.
 /// @return
+/// @brief Wakes up the task if it sleeps interruptibly, and the signal is not
+/// blocked. The system call it sleeps in returned -ERESTART, it fails with
+/// -EINTR instead of being issued again.
+/// @param sig The signal.
+/// @param t   The receiving task.
+static inline void __signal_wake_up(int sig, struct task_struct *t) {
+  if ((t->state != TASK_INTERRUPTIBLE) || sigismember(&t->blocked, sig))
+    return;
+  // Leave the wait queue, no event will wake the task up anymore.
+  list_head_remove(&t->wait.task_list);
+  // Skip the `int $0x80` (or `sysenter`) instruction, both 2 bytes long.
+  t->thread.regs.eip += 2;
+  t->thread.regs.eax = -EINTR;
+  t->wait.func(&t->wait, TASK_INTERRUPTIBLE, 0);
+}
+
 static int __send_signal(int sig, siginfo_t *info, struct task_struct *t) {
   // Lock the signal handling for the given task.
   __lock_task_sighand(t);
@@ -154,11 +170,14 @@ static int __send_signal(int sig, siginfo_t *info, struct task_struct *t) {
     memcpy(&q->info, info, sizeof(siginfo_t));
   // Set that there is a signal pending.
   sigaddset(&t->pending.signal, sig);
+  t->sigpending = true;
   dprintf(
     "Added pending signal (%2d)`%s` to task (%2d)`%s`, pending `%d, %d`.\n",
     sig, strsignal(sig), t->pid, t->name, t->pending.signal.sig[0],
     t->pending.signal.sig[1]);
   __unlock_task_sighand(t);
+  // The task must not sleep through the signal.
+  __signal_wake_up(sig, t);
   return 0;
 }
 
@@ -311,6 +330,8 @@ long sys_sigreturn(struct pt_regs *f) {
   *f = current->thread.signal_regs;
   // Restore the previous signal mask.
   memcpy(&current->blocked, &current->saved_sigmask, sizeof(sigset_t));
+  // Signals which were blocked during the handler can be delivered now.
+  current->sigpending = !list_head_empty(&current->pending.list);
   // Switch to process page directory
   vmm_switch_directory(current->mm->pgd);
   dprintf("sys_sigreturn(%p) : done!\n", f);
@@ -353,7 +374,7 @@ static void __do_signal_stop(struct task_struct *current, struct pt_regs *f,
   // The do_signal( ) function also sends a SIGCHLD signal to
   // the parent process of current, unless the parent has set
   // the SA_NOCLDSTOP flag of SIGCHLD.
-  if (!(SA_NOCLDSTOP & current->parent->sighand.action[SIGCHLD - 1].sa_flags))
+  if (!(SA_NOCLDSTOP & current->parent->sighand->action[SIGCHLD - 1].sa_flags))
     if (__notify_parent(current, SIGCHLD) != 0)
       dprintf("Failed to notify parent with signal: %d", signr);
 
@@ -406,12 +427,13 @@ int do_signal(struct pt_regs *f) {
     // handled and do_signal( ) can finish.
     if (signr == 0) {
       dprintf("There are no more signals to handle.\n");
+      current->sigpending = false;
       __unlock_task_sighand(current);
       return 0;
     }
 
     // Get the associated signal action.
-    sigaction_t *ka = &current->sighand.action[signr - 1];
+    sigaction_t *ka = &current->sighand->action[signr - 1];
 
     // The only exception comes when the receiving process is init, in
     // which case the signal is discarded.
@@ -493,6 +515,7 @@ int do_signal(struct pt_regs *f) {
     }
     dprintf("Failed to handle signal.\n");
   }
+  current->sigpending = false;
   __unlock_task_sighand(current);
   return 0;
 }
@@ -507,6 +530,29 @@ int signals_init() {
   return 1;
 }
 
+sighand_t *sighand_alloc(void) {
+  sighand_t *sighand = kmalloc(sizeof(sighand_t));
+  if (!sighand) {
+    dprintf("Failed to allocate memory for the signal handlers.\n");
+    return NULL;
+  }
+  memset(sighand, 0x00, sizeof(sighand_t));
+  spinlock_init(&sighand->siglock);
+  atomic_set(&sighand->count, 1);
+  for (int i = 0; i < NSIG; ++i) {
+    sighand->action[i].sa_handler = SIG_DFL;
+    sigemptyset(&sighand->action[i].sa_mask);
+    sighand->action[i].sa_flags = 0;
+  }
+  return sighand;
+}
+
+void sighand_put(sighand_t *sighand) {
+  // The handlers are freed together with the last task using them.
+  if (sighand && (--sighand->count == 0))
+    kfree(sighand);
+}
+
 /// @brief Checks for some types of signals that might nullify other pending
 /// signals for the destination thread group
 /// @param sig Signal number
@@ -551,9 +597,8 @@ void handle_stop_signal(int sig, siginfo_t *info, struct task_struct *p) {
         // Executed entry's wakeup test function
         int res = entry->func(entry, 0, 0);
         if (res == 1) {
-          // Removes entry from list and memory
+          // Removes entry from list
           remove_wait_queue(&stopped_queue, entry);
-          kfree(entry);
 
           dprintf("Process (pid: %d) restored from stop\n", p->pid);
         }
@@ -653,13 +698,13 @@ sighandler_t sys_signal(int signum, sighandler_t handler,
   // Set the address of the sigreturn.
   current->sigreturn_addr = sigreturn_addr;
   // Get the old sigaction.
-  sigaction_t *old_sigaction = &current->sighand.action[signum - 1];
+  sigaction_t *old_sigaction = &current->sighand->action[signum - 1];
   dprintf("sys_signal(%d, %p): Signal action ptr %p\n", signum, handler,
           old_sigaction);
   dprintf("sys_signal(%d, %p): Old signal handler %p\n", signum, handler,
           old_sigaction->sa_handler);
   // Get the old handler (to return).
-  sighandler_t old_handler = current->sighand.action[signum - 1].sa_handler;
+  sighandler_t old_handler = current->sighand->action[signum - 1].sa_handler;
   // Set the new action.
   memcpy(old_sigaction, &new_sigaction, sizeof(sigaction_t));
   // Unlock the signal handling for the given task.
@@ -693,7 +738,7 @@ int sys_sigaction(int signum, const sigaction_t *act, sigaction_t *oldact,
   // Set the address of the sigreturn.
   current->sigreturn_addr = sigreturn_addr;
   // Get a pointer to the entry in the sighand.action array.
-  sigaction_t *current_sigaction = &current->sighand.action[signum - 1];
+  sigaction_t *current_sigaction = &current->sighand->action[signum - 1];
   dprintf("sys_sigaction(%d, %p, %p): : Signal old action ptr %p\n", signum,
           act, oldact, current_sigaction);
   // If requested, get the old sigaction.
@@ -749,6 +794,8 @@ int sys_sigprocmask(int how, const sigset_t *set, sigset_t *oldset) {
       current->blocked.sig[0] = set->sig[0];
       current->blocked.sig[1] = set->sig[1];
     }
+    // Signals which have been unblocked can be delivered now.
+    current->sigpending = !list_head_empty(&current->pending.list);
   }
   return 0;
 }
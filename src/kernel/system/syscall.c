@@ -71,7 +71,8 @@ void syscall_init() {
   // syscalls[__NR_rmdir]          = (syscall_func)sys_rmdir;
   // syscalls[__NR_creat]          = (syscall_func)sys_creat;
   // syscalls[__NR_unlink]         = (syscall_func)sys_unlink;
-  // syscalls[__NR_getdents]       = (syscall_func)sys_getdents;
+  syscalls[__NR_getdents]       = (syscall_func)sys_getdents;
+  syscalls[__NR_getdentsplus]   = (syscall_func)sys_getdentsplus;
   // syscalls[__NR_lseek]          = (syscall_func)sys_lseek;
   // syscalls[__NR_getpid]         = (syscall_func)sys_getpid;
   // syscalls[__NR_getsid]         = (syscall_func)sys_getsid;
@@ -85,6 +86,7 @@ void syscall_init() {
   // syscalls[__NR_getppid]        = (syscall_func)sys_getppid;
   // syscalls[__NR_sigaction]      = (syscall_func)sys_sigaction;
   // syscalls[__NR_fork]           = (syscall_func)sys_fork;
+  syscalls[__NR_clone]          = (syscall_func)sys_clone;
   // syscalls[__NR_execve]         = (syscall_func)sys_execve;
   // syscalls[__NR_nice]           = (syscall_func)sys_nice;
   // syscalls[__NR_kill]           = (syscall_func)sys_kill;
@@ -157,10 +159,19 @@ void syscall_handler(pt_regs *f) {
     }
     ret = func(arg0, arg1, arg2, arg3, arg4);
   }
-  f->eax = ret;
+  if (ret == -ERESTART) {
+    // The process went to sleep, and it issues the system call again once it
+    // is woken up: eax still holds the number of the system call, and we go
+    // back to the `int $0x80` (or `sysenter`) instruction, both 2 bytes long.
+    f->eip -= 2;
+  } else {
+    f->eax = ret;
+  }
 
-  // Schedule next process.
-  scheduler_run(f);
+  // Enter the signal and scheduling code only when they have work to do.
+  task_struct *current = scheduler_get_current_process();
+  if (scheduler_need_resched() || (current && current->sigpending))
+    scheduler_run(f);
   // // Restore fpu state.
   // unswitch_fpu();
 }
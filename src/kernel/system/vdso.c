@@ -0,0 +1,138 @@
+/// @file vdso.c
+/// @brief Read-only data page shared by the kernel with every process.
+/// @copyright (c) 2014-2022 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <arch/i386/timer.h>
+#include <kernel/system/vdso.h>
+#include <kernel/memory/mmu.h>
+#include <kernel/kernel.h>
+#include <kernel/string.h>
+#include <kernel/system/syscall.h>
+#include <kernel/printf.h>
+
+/// The number of ticks over which the TSC frequency is measured.
+#define VDSO_TSC_CALIBRATION_TICKS 64
+
+/// The CPUID (EAX=1) EDX bit which advertises the TSC.
+#define CPUID_EDX_TSC (1U << 4)
+
+/// The kernel mapping of the data page.
+static vdso_data_t *vdso_data = NULL;
+/// If the CPU has a TSC.
+static int vdso_has_tsc = 0;
+/// The number of ticks seen while calibrating the TSC.
+static uint32_t calibration_ticks = 0;
+/// The TSC at the beginning of the calibration.
+static unsigned long long calibration_tsc = 0;
+
+/// @brief Reads the Time Stamp Counter.
+/// @return The number of cycles since the CPU reset.
+static inline unsigned long long __rdtsc(void) {
+  uint32_t lo, hi;
+  __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+  return ((unsigned long long)hi << 32) | lo;
+}
+
+/// @brief Opens an update of the page, readers retry until it is closed.
+static inline void __vdso_write_begin(void) {
+  ++vdso_data->seq;
+  __asm__ __volatile__("" ::: "memory");
+}
+
+/// @brief Closes an update of the page.
+static inline void __vdso_write_end(void) {
+  __asm__ __volatile__("" ::: "memory");
+  ++vdso_data->seq;
+}
+
+/// @brief Measures the TSC cycles per tick, and derives the scale to
+/// nanoseconds, once enough ticks have been seen.
+/// @param tsc The TSC at this tick.
+static inline void __vdso_calibrate_tsc(unsigned long long tsc) {
+  if (calibration_ticks++ == 0) {
+    calibration_tsc = tsc;
+    return;
+  }
+  if (calibration_ticks <= VDSO_TSC_CALIBRATION_TICKS) {
+    return;
+  }
+  unsigned long long cycles =
+    (tsc - calibration_tsc) / VDSO_TSC_CALIBRATION_TICKS;
+  uint32_t ns = 1000000000U / TICKS_PER_SECOND;
+  if ((cycles == 0) || (cycles >> 32)) {
+    vdso_has_tsc = 0;
+    return;
+  }
+  // The biggest shift which keeps the multiplier inside 32 bits, namely the
+  // quotient of `divl` does not overflow.
+  uint32_t shift = 32;
+  while ((shift > 0) && ((((unsigned long long)ns << shift) >> 32) >= cycles)) {
+    --shift;
+  }
+  unsigned long long dividend = (unsigned long long)ns << shift;
+  uint32_t mult, rem;
+  __asm__("divl %4"
+          : "=a"(mult), "=d"(rem)
+          : "a"((uint32_t)dividend), "d"((uint32_t)(dividend >> 32)),
+            "rm"((uint32_t)cycles));
+  vdso_data->tsc_mult  = mult;
+  vdso_data->tsc_shift = shift;
+  dprintf("vdso: %u TSC cycles per tick, scale %u >> %u\n", (uint32_t)cycles,
+          vdso_data->tsc_mult, vdso_data->tsc_shift);
+}
+
+int vdso_init(void) {
+  uint32_t eax = 1, ebx, ecx = 0, edx;
+
+  vdso_data = kmalloc_align(PAGE_SIZE);
+  if (!vdso_data) {
+    dprintf("vdso: failed to allocate the data page!\n");
+    return 1;
+  }
+  memset(vdso_data, 0, PAGE_SIZE);
+  vdso_data->ticks_per_second = TICKS_PER_SECOND;
+  vdso_data->wall_base        = sys_time(NULL);
+
+  // Every process directory is a copy of the kernel one, so they all get the
+  // user mapping of the page.
+  uintptr_t phy = vmm_r_get_phy_addr((uintptr_t)vdso_data);
+  if (!vmm_map_page(VDSO_DATA_START, phy, PML_USER_READONLY)) {
+    dprintf("vdso: failed to map the data page!\n");
+    kfree(vdso_data);
+    vdso_data = NULL;
+    return 1;
+  }
+
+  __asm__ __volatile__("cpuid" : "+a"(eax), "=b"(ebx), "+c"(ecx), "=d"(edx));
+  vdso_has_tsc = (edx & CPUID_EDX_TSC) != 0;
+  return 0;
+}
+
+void vdso_update_time(void) {
+  if (!vdso_data) {
+    return;
+  }
+  __vdso_write_begin();
+  vdso_data->ticks     = timer_get_ticks();
+  vdso_data->wall_base = sys_time(NULL);
+  if (vdso_has_tsc) {
+    unsigned long long tsc = __rdtsc();
+    vdso_data->tsc_lo      = (uint32_t)tsc;
+    vdso_data->tsc_hi      = (uint32_t)(tsc >> 32);
+    if (!vdso_data->tsc_mult) {
+      __vdso_calibrate_tsc(tsc);
+    }
+  }
+  __vdso_write_end();
+}
+
+void vdso_update_task(task_struct *process) {
+  if (!vdso_data) {
+    return;
+  }
+  __vdso_write_begin();
+  vdso_data->pid  = process->pid;
+  vdso_data->ppid = process->parent ? process->parent->pid : 0;
+  __vdso_write_end();
+}